@@ -3,6 +3,7 @@
 struct PSInput
 {
 	float4 position : SV_POSITION;
+	float3 color : COLOR;
 };
 
 struct PSOutput
@@ -11,12 +12,18 @@ struct PSOutput
 };
 
 ConstantBuffer<ViewProjectionMatrixData> viewProjectionData : register(b0);
-StructuredBuffer<Vertex> points : register(t0);
+StructuredBuffer<PackedPoint> points : register(t0);
+
+float3 UnpackColor(PACKED_RGB10A2_UNORM color)
+{
+	return float3(color & 1023, (color >> 10) & 1023, (color >> 20) & 1023) / 1023.0;
+}
 
 PSInput VSMain(uint id : SV_VertexID)
 {
 	PSInput result;
 	result.position = mul(viewProjectionData.proj, mul(viewProjectionData.view, float4(points[id].position, 1)));
+	result.color = UnpackColor(points[id].color);
 	return result;
 }
 
@@ -24,7 +31,7 @@ PSOutput PSMain(PSInput input) // : SV_TARGET
 {
 	PSOutput output;
 
-	output.Color = float4(1, 1, 1, 1);
+	output.Color = float4(input.color, 1);
 
 	return output;
 }
@@ -0,0 +1,174 @@
+#include "CameraTrace.h"
+
+#include <cmath>
+#include <fstream>
+
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	// Hamilton product, the rotation b followed by a
+	static void MultiplyQuaternions(const float (&a)[4], const float (&b)[4], float (&result)[4])
+	{
+		result[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+		result[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+		result[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+		result[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+	}
+
+	// v + 2w (u x v) + 2u x (u x v), same as XMVector3Rotate
+	static void RotateVector(const float (&rotation)[4], const float (&v)[3], float (&result)[3])
+	{
+		const float t[3] = {
+			2.0f * (rotation[1] * v[2] - rotation[2] * v[1]),
+			2.0f * (rotation[2] * v[0] - rotation[0] * v[2]),
+			2.0f * (rotation[0] * v[1] - rotation[1] * v[0])
+		};
+		result[0] = v[0] + rotation[3] * t[0] + rotation[1] * t[2] - rotation[2] * t[1];
+		result[1] = v[1] + rotation[3] * t[1] + rotation[2] * t[0] - rotation[0] * t[2];
+		result[2] = v[2] + rotation[3] * t[2] + rotation[0] * t[1] - rotation[1] * t[0];
+	}
+
+	static void Normalize(float* v, uint32_t size)
+	{
+		float length = 0.0f;
+		for (uint32_t i = 0; i < size; i++)
+		{
+			length += v[i] * v[i];
+		}
+		length = std::sqrt(length);
+		if (length > 0.0f)
+		{
+			for (uint32_t i = 0; i < size; i++)
+			{
+				v[i] /= length;
+			}
+		}
+	}
+
+	bool CameraTrace::Save(const std::filesystem::path& path) const
+	{
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		const uint32_t magic = MAGIC;
+		const uint32_t version = VERSION;
+		const uint64_t samplesCount = m_samples.size();
+		stream.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+		stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+		stream.write(reinterpret_cast<const char*>(&samplesCount), sizeof(samplesCount));
+		stream.write(reinterpret_cast<const char*>(m_samples.data()), static_cast<std::streamsize>(m_samples.size() * sizeof(CameraTraceSample)));
+		if (stream.fail())
+		{
+			Logger::LogFormat("Can't write camera trace %s\n", path.string().c_str());
+			return false;
+		}
+
+		Logger::LogFormat("Camera trace written to %s, %llu samples\n", path.string().c_str(), samplesCount);
+		return true;
+	}
+
+	bool CameraTrace::Load(const std::filesystem::path& path)
+	{
+		m_samples.clear();
+
+		std::ifstream stream(path, std::ios::binary);
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint64_t samplesCount = 0;
+		stream.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+		stream.read(reinterpret_cast<char*>(&version), sizeof(version));
+		stream.read(reinterpret_cast<char*>(&samplesCount), sizeof(samplesCount));
+		if (stream.fail() || magic != MAGIC || version != VERSION)
+		{
+			Logger::LogFormat("%s is not a camera trace\n", path.string().c_str());
+			return false;
+		}
+
+		m_samples.resize(samplesCount);
+		stream.read(reinterpret_cast<char*>(m_samples.data()), static_cast<std::streamsize>(samplesCount * sizeof(CameraTraceSample)));
+		if (stream.fail())
+		{
+			Logger::LogFormat("Camera trace %s is truncated\n", path.string().c_str());
+			m_samples.clear();
+			return false;
+		}
+		return true;
+	}
+
+	CameraTraceSample CameraTrace::Predict(const CameraTraceSample& sample, float seconds)
+	{
+		CameraTraceSample predicted = sample;
+		predicted.time += seconds;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			predicted.position[axis] += sample.velocity[axis] * seconds;
+		}
+
+		const float angularSpeed = std::sqrt(
+			sample.angularVelocity[0] * sample.angularVelocity[0] +
+			sample.angularVelocity[1] * sample.angularVelocity[1] +
+			sample.angularVelocity[2] * sample.angularVelocity[2]);
+		if (angularSpeed > 0.0f)
+		{
+			// the turn is taken about world axes, so it goes after the current rotation
+			const float halfAngle = 0.5f * angularSpeed * seconds;
+			const float axisScale = std::sin(halfAngle) / angularSpeed;
+			const float turn[4] = {
+				sample.angularVelocity[0] * axisScale,
+				sample.angularVelocity[1] * axisScale,
+				sample.angularVelocity[2] * axisScale,
+				std::cos(halfAngle)
+			};
+			MultiplyQuaternions(turn, sample.rotation, predicted.rotation);
+			Normalize(predicted.rotation, 4);
+		}
+		return predicted;
+	}
+
+	void CameraTrace::GetViewProjection(const float (&position)[3], const float (&rotation)[4], const CameraTraceProjection& projection,
+	                                    float (&viewProjection)[4][4])
+	{
+		constexpr float forwardAxis[3] = {0.0f, 0.0f, 1.0f};
+		constexpr float upAxis[3] = {0.0f, 1.0f, 0.0f};
+		float forward[3];
+		float up[3];
+		RotateVector(rotation, forwardAxis, forward);
+		RotateVector(rotation, upAxis, up);
+		Normalize(forward, 3);
+
+		// orthonormal basis of lookAtLH
+		float right[3] = {
+			up[1] * forward[2] - up[2] * forward[1],
+			up[2] * forward[0] - up[0] * forward[2],
+			up[0] * forward[1] - up[1] * forward[0]
+		};
+		Normalize(right, 3);
+		up[0] = forward[1] * right[2] - forward[2] * right[1];
+		up[1] = forward[2] * right[0] - forward[0] * right[2];
+		up[2] = forward[0] * right[1] - forward[1] * right[0];
+
+		const float yScale = 1.0f / std::tan(projection.fovRadians * 0.5f);
+		const float xScale = yScale / projection.aspect;
+		const float depthScale = projection.farPlane / (projection.farPlane - projection.nearPlane);
+
+		// view rows are the basis components, the last one moves the camera to the origin
+		float view[4][3];
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			view[i][0] = right[i];
+			view[i][1] = up[i];
+			view[i][2] = forward[i];
+		}
+		view[3][0] = -(right[0] * position[0] + right[1] * position[1] + right[2] * position[2]);
+		view[3][1] = -(up[0] * position[0] + up[1] * position[1] + up[2] * position[2]);
+		view[3][2] = -(forward[0] * position[0] + forward[1] * position[1] + forward[2] * position[2]);
+
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			const float viewW = i == 3 ? 1.0f : 0.0f;
+			viewProjection[i][0] = view[i][0] * xScale;
+			viewProjection[i][1] = view[i][1] * yScale;
+			viewProjection[i][2] = view[i][2] * depthScale - viewW * depthScale * projection.nearPlane;
+			viewProjection[i][3] = view[i][2];
+		}
+	}
+}
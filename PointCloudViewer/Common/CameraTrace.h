@@ -0,0 +1,61 @@
+#ifndef CAMERA_TRACE_H
+#define CAMERA_TRACE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace PointCloudViewer
+{
+	// Camera state of one frame in world space
+	struct CameraTraceSample
+	{
+		float time;
+		float position[3];
+		// quaternion, x y z w
+		float rotation[4];
+		// units per second
+		float velocity[3];
+		// world axis scaled by radians per second
+		float angularVelocity[3];
+	};
+
+	// Perspective of the replayed camera, matches CameraUnit
+	struct CameraTraceProjection
+	{
+		float fovRadians;
+		float aspect;
+		float nearPlane;
+		float farPlane;
+	};
+
+	// Camera path recorded frame by frame, so streaming can be replayed offline against a hierarchy.
+	// File layout: magic, version, samples count, then the samples.
+	class CameraTrace
+	{
+	public:
+		static constexpr uint32_t MAGIC = 0x43525443; // "CTRC"
+		static constexpr uint32_t VERSION = 1;
+
+		void AddSample(const CameraTraceSample& sample) { m_samples.push_back(sample); }
+		void Clear() { m_samples.clear(); }
+
+		bool Save(const std::filesystem::path& path) const;
+		bool Load(const std::filesystem::path& path);
+
+		[[nodiscard]] const std::vector<CameraTraceSample>& GetSamples() const noexcept { return m_samples; }
+		[[nodiscard]] bool IsEmpty() const noexcept { return m_samples.empty(); }
+
+		// Pose the camera reaches in the given time if it keeps its velocities
+		[[nodiscard]] static CameraTraceSample Predict(const CameraTraceSample& sample, float seconds);
+
+		// Row vector view-projection of a pose like lookAtLH * perspectiveFovLH_ZO, position already in the target space
+		static void GetViewProjection(const float (&position)[3], const float (&rotation)[4], const CameraTraceProjection& projection,
+		                              float (&viewProjection)[4][4]);
+
+	private:
+		std::vector<CameraTraceSample> m_samples;
+	};
+}
+
+#endif // CAMERA_TRACE_H
@@ -46,4 +46,11 @@ namespace PointCloudViewer
 
 		return math::lookAtLH(position, focus, up);
 	}
+
+	Frustum CameraUnit::GetFrustum(const math::mat4x4& viewMatrix) const
+	{
+		DirectX::XMFLOAT4X4 viewProjection;
+		DirectX::XMStoreFloat4x4(&viewProjection, math::mul(viewMatrix, GetProjMatrix()));
+		return Frustum(viewProjection.m);
+	}
 }
@@ -1,6 +1,7 @@
 #ifndef CAMERA_UNIT_H
 #define CAMERA_UNIT_H
 
+#include "Frustum.h"
 #include "Math/MathTypes.h"
 
 namespace PointCloudViewer
@@ -22,6 +23,8 @@ namespace PointCloudViewer
 
 		[[nodiscard]] virtual math::mat4x4 GetProjMatrix() const;
 		[[nodiscard]] virtual math::mat4x4 GetViewMatrix(math::xvec4 position, math::quat rotation) const;
+		// Frustum in the space the view matrix maps from
+		[[nodiscard]] Frustum GetFrustum(const math::mat4x4& viewMatrix) const;
 
 		[[nodiscard]] float GetNear() const noexcept { return m_near; }
 		[[nodiscard]] float GetFar() const noexcept { return m_far; }
@@ -0,0 +1,93 @@
+#include "Frustum.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+namespace PointCloudViewer
+{
+	Frustum::Frustum(const float (&viewProjection)[4][4])
+	{
+		// clip coordinate k is the dot product of the position with column k
+		const auto column = [&viewProjection](uint32_t k, uint32_t i)
+		{
+			return viewProjection[i][k];
+		};
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			m_planes[0][i] = column(3, i) + column(0, i); // left, -w <= x
+			m_planes[1][i] = column(3, i) - column(0, i); // right, x <= w
+			m_planes[2][i] = column(3, i) + column(1, i); // bottom, -w <= y
+			m_planes[3][i] = column(3, i) - column(1, i); // top, y <= w
+			m_planes[4][i] = column(2, i); // near, 0 <= z
+			m_planes[5][i] = column(3, i) - column(2, i); // far, z <= w
+		}
+
+		for (float (&plane)[4] : m_planes)
+		{
+			const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			if (length > 0.0f)
+			{
+				for (float& value : plane)
+				{
+					value /= length;
+				}
+			}
+		}
+	}
+
+	FrustumTest Frustum::TestBox(const float (&boxMin)[3], const float (&boxMax)[3]) const
+	{
+		bool isInside = true;
+		for (const float (&plane)[4] : m_planes)
+		{
+			float distance = plane[3];
+			float radius = 0.0f;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				distance += plane[axis] * (boxMin[axis] + boxMax[axis]) * 0.5f;
+				radius += std::abs(plane[axis]) * (boxMax[axis] - boxMin[axis]) * 0.5f;
+			}
+			if (distance < -radius)
+			{
+				return FrustumTest::Outside;
+			}
+			isInside &= distance >= radius;
+		}
+		return isInside ? FrustumTest::Inside : FrustumTest::Intersecting;
+	}
+
+	void Frustum::TestBoxes(const FrustumBoxBatch& batch, uint32_t& outsideMask, uint32_t& insideMask) const
+	{
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 minX = _mm_load_ps(batch.minX);
+		const __m128 minY = _mm_load_ps(batch.minY);
+		const __m128 minZ = _mm_load_ps(batch.minZ);
+		const __m128 maxX = _mm_load_ps(batch.maxX);
+		const __m128 maxY = _mm_load_ps(batch.maxY);
+		const __m128 maxZ = _mm_load_ps(batch.maxZ);
+		const __m128 centerX = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+		const __m128 centerY = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+		const __m128 centerZ = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+		const __m128 extentX = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+		const __m128 extentY = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+		const __m128 extentZ = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+		__m128 outside = _mm_setzero_ps();
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const float (&plane)[4] : m_planes)
+		{
+			const __m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane[0])), _mm_mul_ps(centerY, _mm_set1_ps(plane[1]))),
+				_mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+			const __m128 radius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(extentX, _mm_set1_ps(std::abs(plane[0]))), _mm_mul_ps(extentY, _mm_set1_ps(std::abs(plane[1])))),
+				_mm_mul_ps(extentZ, _mm_set1_ps(std::abs(plane[2]))));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, radius));
+		}
+
+		outsideMask = static_cast<uint32_t>(_mm_movemask_ps(outside));
+		insideMask = static_cast<uint32_t>(_mm_movemask_ps(_mm_andnot_ps(outside, inside)));
+	}
+}
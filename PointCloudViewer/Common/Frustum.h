@@ -0,0 +1,51 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <cstdint>
+
+namespace PointCloudViewer
+{
+	enum class FrustumTest
+	{
+		Outside,
+		Intersecting,
+		Inside
+	};
+
+	// Up to four boxes in structure of arrays layout, one SSE lane per box
+	struct FrustumBoxBatch
+	{
+		alignas(16) float minX[4];
+		alignas(16) float minY[4];
+		alignas(16) float minZ[4];
+		alignas(16) float maxX[4];
+		alignas(16) float maxY[4];
+		alignas(16) float maxZ[4];
+	};
+
+	// Six planes of a view-projection matrix, pointing inwards and normalized.
+	// Boxes are tested by their center and half extent: a box is outside when it is behind a plane by more than its
+	// projected radius, inside when it is in front of all planes by at least that much. Boxes near a corner of the frustum
+	// can be reported intersecting while being outside, which only costs a few more points drawn.
+	class Frustum
+	{
+	public:
+		static constexpr uint32_t PLANES_COUNT = 6;
+
+		// Row vector matrix (position * matrix) with clip depth in [0, 1], like the LH_ZO projections
+		explicit Frustum(const float (&viewProjection)[4][4]);
+
+		[[nodiscard]] FrustumTest TestBox(const float (&boxMin)[3], const float (&boxMax)[3]) const;
+
+		// Bit i of the masks is set when box i is outside or inside, lanes past the boxes in use are garbage
+		void TestBoxes(const FrustumBoxBatch& batch, uint32_t& outsideMask, uint32_t& insideMask) const;
+
+		[[nodiscard]] const float* GetPlane(uint32_t planeIndex) const noexcept { return m_planes[planeIndex]; }
+
+	private:
+		// a, b, c, d of a x + b y + c z + d >= 0
+		float m_planes[PLANES_COUNT][4];
+	};
+}
+
+#endif // FRUSTUM_H
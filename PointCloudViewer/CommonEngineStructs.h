@@ -135,6 +135,15 @@ struct Vertex
 	VEC3 color;
 };
 
+// Point cloud record, 20 bytes
+struct PackedPoint
+{
+	VEC3 position;
+	PACKED_RGB10A2_UNORM color;
+	// unorm16 in the low half, high half is reserved
+	UINT1 intensity;
+};
+
 typedef UINT1 Index;
 
 struct ViewProjectionMatrixData
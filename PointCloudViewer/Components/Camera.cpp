@@ -44,11 +44,24 @@ namespace PointCloudViewer
 		);
 	}
 
+	math::mat4x4 Camera::GetViewMatrix(const math::vec3& position) const
+	{
+		return m_cameraUnit.GetViewMatrix(
+			math::loadPosition(position),
+			m_gameObject.GetTransform().GetRotation()
+		);
+	}
+
 	math::mat4x4 Camera::GetProjMatrix() const
 	{
 		return m_cameraUnit.GetProjMatrix();
 	}
 
+	Frustum Camera::GetFrustum(const math::mat4x4& viewMatrix) const
+	{
+		return m_cameraUnit.GetFrustum(viewMatrix);
+	}
+
 	float Camera::GetFovRadians() const
 	{
 		return m_cameraUnit.GetFOVRadians();
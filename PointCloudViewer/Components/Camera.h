@@ -18,7 +18,10 @@ namespace PointCloudViewer
 		void Disable() override;
 		void Update() override;
 		[[nodiscard]] math::mat4x4 GetViewMatrix() const;
+		// Camera rotation at a position given in another space, e.g. relative to the point cloud origin
+		[[nodiscard]] math::mat4x4 GetViewMatrix(const math::vec3& position) const;
 		[[nodiscard]] math::mat4x4 GetProjMatrix() const;
+		[[nodiscard]] Frustum GetFrustum(const math::mat4x4& viewMatrix) const;
 
 		[[nodiscard]] float GetFovRadians() const;
 		[[nodiscard]] float GetNear() const;
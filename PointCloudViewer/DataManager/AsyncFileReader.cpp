@@ -0,0 +1,214 @@
+#include "AsyncFileReader.h"
+
+#include <algorithm>
+
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	// Blocking reads of the fallback only need to cover the device latency, not the whole queue
+	static constexpr uint32_t FALLBACK_READ_THREADS_COUNT = 4;
+
+	AsyncFileReader::AsyncFileReader(const std::string& filename, uint32_t queueDepth) :
+		m_filename(filename)
+	{
+		m_file = CreateFileA(
+			filename.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED,
+			nullptr);
+		if (m_file != INVALID_HANDLE_VALUE)
+		{
+			m_port = CreateIoCompletionPort(m_file, nullptr, 0, 1);
+			if (m_port == nullptr)
+			{
+				CloseHandle(m_file);
+				m_file = INVALID_HANDLE_VALUE;
+			}
+		}
+
+		if (m_file == INVALID_HANDLE_VALUE)
+		{
+			// plain handle only for the size, every fallback thread opens its own
+			m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+			{
+				Logger::LogFormat("Can't open %s\n", filename.c_str());
+				return;
+			}
+			Logger::LogFormat("Unbuffered reads aren't available for %s, using %s\n", filename.c_str(), GetBackendName());
+		}
+
+		LARGE_INTEGER fileSize = {};
+		const BOOL hasSize = GetFileSizeEx(m_file, &fileSize);
+		ASSERT(hasSize);
+		m_size = fileSize.QuadPart;
+
+		m_requests.resize(std::max(queueDepth, 1u));
+		for (Request& request : m_requests)
+		{
+			m_freeRequests.push_back(&request);
+		}
+	}
+
+	AsyncFileReader::~AsyncFileReader()
+	{
+		// kernel writes into the buffers until the reads complete
+		uint64_t tag;
+		uint64_t bytesRead;
+		while (WaitCompletion(tag, bytesRead))
+		{
+		}
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_isStopping = true;
+		}
+		m_requestSubmitted.notify_all();
+		for (std::thread& thread : m_readThreads)
+		{
+			thread.join();
+		}
+
+		if (m_port != nullptr)
+		{
+			CloseHandle(m_port);
+		}
+		if (m_file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_file);
+		}
+	}
+
+	AlignedBuffer AsyncFileReader::AllocateBuffer(uint64_t size)
+	{
+		const uint64_t alignedSize = (std::max<uint64_t>(size, 1) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+		return AlignedBuffer(static_cast<char*>(_aligned_malloc(alignedSize, ALIGNMENT)));
+	}
+
+	void AsyncFileReader::Submit(uint64_t offset, uint64_t size, char* buffer, uint64_t tag)
+	{
+		ASSERT(!m_freeRequests.empty());
+		ASSERT(offset % ALIGNMENT == 0 && size % ALIGNMENT == 0 && reinterpret_cast<uintptr_t>(buffer) % ALIGNMENT == 0);
+		ASSERT(size <= MAXDWORD);
+
+		Request* request = m_freeRequests.back();
+		m_freeRequests.pop_back();
+		*request = {};
+		request->overlapped.Offset = static_cast<DWORD>(offset);
+		request->overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		request->buffer = buffer;
+		request->size = size;
+		request->tag = tag;
+		m_requestsInFlight++;
+
+		if (IsUnbuffered())
+		{
+			if (!ReadFile(m_file, buffer, static_cast<DWORD>(size), nullptr, &request->overlapped) && GetLastError() != ERROR_IO_PENDING)
+			{
+				// reads starting at the end fail with ERROR_HANDLE_EOF, any failure completes empty and queues nothing on its own
+				const DWORD error = GetLastError();
+				if (error != ERROR_HANDLE_EOF)
+				{
+					Logger::LogFormat("Read of %s at %llu failed with error %lu\n", m_filename.c_str(), offset, error);
+				}
+				PostQueuedCompletionStatus(m_port, 0, 0, &request->overlapped);
+			}
+			return;
+		}
+
+		if (m_readThreads.empty())
+		{
+			for (uint32_t threadIndex = 0; threadIndex < FALLBACK_READ_THREADS_COUNT; threadIndex++)
+			{
+				m_readThreads.emplace_back(&AsyncFileReader::ReadRequests, this);
+			}
+		}
+		{
+			std::lock_guard lock(m_mutex);
+			m_submittedRequests.push_back(request);
+		}
+		m_requestSubmitted.notify_one();
+	}
+
+	bool AsyncFileReader::WaitCompletion(uint64_t& tag, uint64_t& bytesRead)
+	{
+		if (m_requestsInFlight == 0)
+		{
+			return false;
+		}
+
+		Request* request;
+		if (IsUnbuffered())
+		{
+			DWORD bytesTransferred = 0;
+			ULONG_PTR key = 0;
+			OVERLAPPED* overlapped = nullptr;
+			// failed reads dequeue their packet too, with FALSE and zero bytes
+			const BOOL isSuccessful = GetQueuedCompletionStatus(m_port, &bytesTransferred, &key, &overlapped, INFINITE);
+			if (overlapped == nullptr)
+			{
+				Logger::LogFormat("Completion port of %s failed with error %lu\n", m_filename.c_str(), GetLastError());
+				return false;
+			}
+			request = reinterpret_cast<Request*>(overlapped);
+			request->bytesRead = isSuccessful ? bytesTransferred : 0;
+		}
+		else
+		{
+			std::unique_lock lock(m_mutex);
+			m_requestCompleted.wait(lock, [this] { return !m_completedRequests.empty(); });
+			request = m_completedRequests.front();
+			m_completedRequests.pop_front();
+		}
+
+		m_requestsInFlight--;
+		tag = request->tag;
+		bytesRead = request->bytesRead;
+		m_freeRequests.push_back(request);
+		return true;
+	}
+
+	void AsyncFileReader::ReadRequests()
+	{
+		// handle of its own, positional reads through one synchronous handle are serialized by the I/O manager
+		const HANDLE file = CreateFileA(m_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		while (true)
+		{
+			Request* request;
+			{
+				std::unique_lock lock(m_mutex);
+				m_requestSubmitted.wait(lock, [this] { return !m_submittedRequests.empty() || m_isStopping; });
+				if (m_submittedRequests.empty())
+				{
+					break;
+				}
+				request = m_submittedRequests.front();
+				m_submittedRequests.pop_front();
+			}
+
+			// offset in the OVERLAPPED of a synchronous handle makes it a blocking pread
+			DWORD bytesTransferred = 0;
+			if (file == INVALID_HANDLE_VALUE || !ReadFile(file, request->buffer, static_cast<DWORD>(request->size), &bytesTransferred, &request->overlapped))
+			{
+				bytesTransferred = 0;
+			}
+			request->bytesRead = bytesTransferred;
+
+			{
+				std::lock_guard lock(m_mutex);
+				m_completedRequests.push_back(request);
+			}
+			m_requestCompleted.notify_one();
+		}
+
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+		}
+	}
+}
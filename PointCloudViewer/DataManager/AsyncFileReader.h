@@ -0,0 +1,92 @@
+#ifndef ASYNC_FILE_READER_H
+#define ASYNC_FILE_READER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "windows.h"
+
+namespace PointCloudViewer
+{
+	struct AlignedBufferDeleter
+	{
+		void operator()(char* buffer) const { _aligned_free(buffer); }
+	};
+
+	using AlignedBuffer = std::unique_ptr<char[], AlignedBufferDeleter>;
+
+	// Many positional reads in flight at once, bypassing the page cache, the O_DIRECT + io_uring analog.
+	// The file is opened unbuffered and overlapped, completions are collected from an I/O completion port.
+	// Where the file can't be opened unbuffered (some network shares and filter drivers refuse it)
+	// a few threads issue blocking positional reads instead, the pread fallback.
+	// Submit and WaitCompletion are meant for a single thread that drives the reads.
+	class AsyncFileReader
+	{
+	public:
+		// sector size of every drive in use is a divisor of the page size
+		static constexpr uint64_t ALIGNMENT = 4096;
+		static constexpr uint32_t DEFAULT_QUEUE_DEPTH = 32;
+
+		AsyncFileReader() = delete;
+		AsyncFileReader(const AsyncFileReader& other) = delete;
+		AsyncFileReader(AsyncFileReader&& other) = delete;
+
+		explicit AsyncFileReader(const std::string& filename, uint32_t queueDepth = DEFAULT_QUEUE_DEPTH);
+		~AsyncFileReader();
+
+		// Offset, size and buffer of every read have to be multiples of ALIGNMENT
+		[[nodiscard]] static AlignedBuffer AllocateBuffer(uint64_t size);
+
+		// Queues a read of [offset, offset + size) into buffer, tag comes back with its completion.
+		// At most GetQueueDepth reads can be in flight.
+		void Submit(uint64_t offset, uint64_t size, char* buffer, uint64_t tag);
+		// Waits for any read in flight, reads past the end of the file complete with fewer bytes.
+		// Returns false when nothing is in flight.
+		bool WaitCompletion(uint64_t& tag, uint64_t& bytesRead);
+
+		[[nodiscard]] bool IsValid() const noexcept { return m_file != INVALID_HANDLE_VALUE; }
+		[[nodiscard]] bool IsUnbuffered() const noexcept { return m_port != nullptr; }
+		[[nodiscard]] const char* GetBackendName() const noexcept { return IsUnbuffered() ? "unbuffered overlapped" : "positional read threads"; }
+		[[nodiscard]] uint64_t GetSize() const noexcept { return m_size; }
+		[[nodiscard]] uint32_t GetQueueDepth() const noexcept { return static_cast<uint32_t>(m_requests.size()); }
+
+	private:
+		struct Request
+		{
+			// first member, completions hand back the OVERLAPPED pointer
+			OVERLAPPED overlapped;
+			char* buffer;
+			uint64_t size;
+			uint64_t tag;
+			uint64_t bytesRead;
+		};
+
+		void ReadRequests();
+
+		std::string m_filename;
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_port = nullptr;
+		uint64_t m_size = 0;
+
+		std::vector<Request> m_requests;
+		std::vector<Request*> m_freeRequests;
+		uint32_t m_requestsInFlight = 0;
+
+		// fallback backend, threads start with the first read
+		std::vector<std::thread> m_readThreads;
+		std::mutex m_mutex;
+		std::condition_variable m_requestSubmitted;
+		std::condition_variable m_requestCompleted;
+		std::deque<Request*> m_submittedRequests;
+		std::deque<Request*> m_completedRequests;
+		bool m_isStopping = false;
+	};
+}
+
+#endif // ASYNC_FILE_READER_H
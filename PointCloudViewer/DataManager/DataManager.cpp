@@ -26,9 +26,24 @@ namespace PointCloudViewer
 		}
 	}
 
+	std::unique_ptr<MappedFile> DataManager::MapData(const std::string& path, bool shouldReadRawData) const
+	{
+		return std::make_unique<MappedFile>(GetFilePath(path, shouldReadRawData).generic_string());
+	}
+
+	std::unique_ptr<AsyncFileReader> DataManager::OpenAsyncData(const std::string& path, bool shouldReadRawData) const
+	{
+		return std::make_unique<AsyncFileReader>(GetFilePath(path, shouldReadRawData).generic_string());
+	}
+
 	bool DataManager::HasRawData(const std::string& path) const
 	{
-		return std::filesystem::exists(m_dataPath / (path + ".data"));
+		return std::filesystem::exists(GetFilePath(path, true));
+	}
+
+	std::filesystem::path DataManager::GetFilePath(const std::string& path, bool shouldReadRawData) const
+	{
+		return m_dataPath / (shouldReadRawData ? path + ".data" : path);
 	}
 
 	void DataManager::GetWFilename(const std::string& path, std::wstring& filename)
@@ -2,8 +2,11 @@
 #define DATA_MANAGER_H
 
 #include <string>
+#include <memory>
 #include <filesystem>
 
+#include "AsyncFileReader.h"
+#include "MappedFile.h"
 #include "Utils/FileUtils.h"
 #include "Common/Singleton.h"
 
@@ -17,7 +20,11 @@ namespace PointCloudViewer
 		~DataManager() = default;
 
 		[[nodiscard]] std::vector<char> GetData(const std::string& path, bool shouldReadRawData = false, uint32_t offset = 0) const;
+		[[nodiscard]] std::unique_ptr<MappedFile> MapData(const std::string& path, bool shouldReadRawData = false) const;
+		// Reader of many aligned reads in flight, for sources streamed once where the page cache only gets in the way
+		[[nodiscard]] std::unique_ptr<AsyncFileReader> OpenAsyncData(const std::string& path, bool shouldReadRawData = false) const;
 		bool HasRawData(const std::string& path) const;
+		[[nodiscard]] std::filesystem::path GetFilePath(const std::string& path, bool shouldReadRawData = false) const;
 		void GetWFilename(const std::string& path, std::wstring& filename);
 		[[nodiscard]] std::ifstream GetFileStream(const std::string& path, bool shouldReadRawData = false) const;
 	private:
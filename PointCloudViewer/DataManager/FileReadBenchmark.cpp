@@ -0,0 +1,159 @@
+#include "FileReadBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#include "AsyncFileReader.h"
+#include "DataManager.h"
+#include "MappedFile.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	// Same order of magnitude as the text loader chunks
+	static constexpr uint64_t BENCHMARK_READ_SIZE = 4ull * 1024ull * 1024ull;
+	static constexpr uint64_t PAGE_SIZE = 4096;
+
+	enum class FileReadMethod
+	{
+		Async,
+		Fread,
+		Mapped
+	};
+
+	struct FileReadResult
+	{
+		const char* name;
+		uint64_t bytesCount;
+		uint64_t checksum;
+		// read past the page cache, the numbers are the disk's whatever ran before
+		bool isUnbuffered;
+	};
+
+	// Sum of a word per page keeps the reads from being optimized away
+	static uint64_t TouchPages(const char* data, uint64_t size)
+	{
+		uint64_t checksum = 0;
+		for (uint64_t offset = 0; offset < size; offset += PAGE_SIZE)
+		{
+			checksum += static_cast<unsigned char>(data[offset]);
+		}
+		return checksum;
+	}
+
+	static FileReadResult ReadAsync(const std::string& filename)
+	{
+		AsyncFileReader reader(filename);
+		if (!reader.IsValid())
+		{
+			return {reader.GetBackendName(), 0, 0, false};
+		}
+
+		std::vector<AlignedBuffer> buffers(reader.GetQueueDepth());
+		for (AlignedBuffer& buffer : buffers)
+		{
+			buffer = AsyncFileReader::AllocateBuffer(BENCHMARK_READ_SIZE);
+		}
+
+		FileReadResult result = {reader.GetBackendName(), 0, 0, reader.IsUnbuffered()};
+		uint64_t offset = 0;
+		for (uint32_t bufferIndex = 0; bufferIndex < buffers.size() && offset < reader.GetSize(); bufferIndex++, offset += BENCHMARK_READ_SIZE)
+		{
+			reader.Submit(offset, BENCHMARK_READ_SIZE, buffers[bufferIndex].get(), bufferIndex);
+		}
+		// every completed buffer goes straight back to the queue with the next read
+		uint64_t bufferIndex;
+		uint64_t bytesRead;
+		while (reader.WaitCompletion(bufferIndex, bytesRead))
+		{
+			result.checksum += TouchPages(buffers[bufferIndex].get(), bytesRead);
+			result.bytesCount += bytesRead;
+			if (offset < reader.GetSize())
+			{
+				reader.Submit(offset, BENCHMARK_READ_SIZE, buffers[bufferIndex].get(), bufferIndex);
+				offset += BENCHMARK_READ_SIZE;
+			}
+		}
+		return result;
+	}
+
+	static FileReadResult ReadFread(const std::string& filename)
+	{
+		FileReadResult result = {"fread", 0, 0, false};
+		FILE* file = nullptr;
+		fopen_s(&file, filename.c_str(), "rb");
+		if (file == nullptr)
+		{
+			return result;
+		}
+
+		std::vector<char> buffer(BENCHMARK_READ_SIZE);
+		size_t bytesRead;
+		while ((bytesRead = fread(buffer.data(), 1, buffer.size(), file)) != 0)
+		{
+			result.checksum += TouchPages(buffer.data(), bytesRead);
+			result.bytesCount += bytesRead;
+		}
+		fclose(file);
+		return result;
+	}
+
+	static FileReadResult ReadMapped(const std::string& path)
+	{
+		FileReadResult result = {"mapped", 0, 0, false};
+		const std::unique_ptr<MappedFile> file = DataManager::Get()->MapData(path);
+		for (uint64_t offset = 0; offset < file->GetSize(); offset += BENCHMARK_READ_SIZE)
+		{
+			const uint64_t size = std::min(BENCHMARK_READ_SIZE, file->GetSize() - offset);
+			file->PrefetchRange(offset + BENCHMARK_READ_SIZE, BENCHMARK_READ_SIZE);
+			result.checksum += TouchPages(file->GetData() + offset, size);
+			file->ReleaseRange(offset, size);
+		}
+		result.bytesCount = file->GetSize();
+		return result;
+	}
+
+	void RunFileReadBenchmark(const std::string& path, uint32_t roundsCount)
+	{
+		const std::string filename = DataManager::Get()->GetFilePath(path).generic_string();
+		std::error_code error;
+		const uint64_t fileSize = std::filesystem::file_size(filename, error);
+		if (error)
+		{
+			Logger::LogFormat("Can't open %s for the benchmark\n", filename.c_str());
+			return;
+		}
+
+		MEMORYSTATUSEX memoryStatus = {.dwLength = sizeof(MEMORYSTATUSEX)};
+		GlobalMemoryStatusEx(&memoryStatus);
+		// the cache can't keep a file this large, each buffered pass evicts what the previous one read
+		const bool isLargerThanRam = fileSize > memoryStatus.ullTotalPhys;
+		Logger::LogFormat("Reading %s, %.3f GB, %.3f GB of RAM, %u rounds\n", filename.c_str(), static_cast<double>(fileSize) / 1e9,
+		                  static_cast<double>(memoryStatus.ullTotalPhys) / 1e9, roundsCount);
+
+		std::mt19937 generator(std::random_device{}());
+		FileReadMethod methods[] = {FileReadMethod::Async, FileReadMethod::Fread, FileReadMethod::Mapped};
+		bool hasBufferedPass = false;
+		for (uint32_t roundIndex = 0; roundIndex < roundsCount; roundIndex++)
+		{
+			std::shuffle(std::begin(methods), std::end(methods), generator);
+			for (const FileReadMethod method : methods)
+			{
+				const auto startTime = std::chrono::steady_clock::now();
+				const FileReadResult result = method == FileReadMethod::Async ? ReadAsync(filename) :
+					method == FileReadMethod::Fread ? ReadFread(filename) : ReadMapped(path);
+				const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+				const char* cacheState = result.isUnbuffered ? "uncached" : isLargerThanRam ? "cold, over RAM" :
+					!hasBufferedPass ? "cold unless cached before" : "warm, page cache";
+				hasBufferedPass |= !result.isUnbuffered;
+				Logger::LogFormat("Round %u %-24s %8.3f s %8.3f GB/s %-26s (checksum %llu)\n", roundIndex, result.name, time,
+				                  static_cast<double>(result.bytesCount) / time / 1e9, cacheState, result.checksum);
+			}
+		}
+	}
+}
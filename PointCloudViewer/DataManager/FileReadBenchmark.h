@@ -0,0 +1,17 @@
+#ifndef FILE_READ_BENCHMARK_H
+#define FILE_READ_BENCHMARK_H
+
+#include <cstdint>
+#include <string>
+
+namespace PointCloudViewer
+{
+	// Reads the whole file through the async reader, fread and the mapping and logs throughput of each.
+	// Every round runs the three in a random order, so no method always reads after the others.
+	// Unbuffered reads always measure the disk. Buffered ones only do while the file isn't in the page cache,
+	// which is the first buffered pass of the run at best, unless the file is larger than RAM.
+	// Each logged pass says which of these it was. Path is relative to the data folder.
+	void RunFileReadBenchmark(const std::string& path, uint32_t roundsCount = 3);
+}
+
+#endif // FILE_READ_BENCHMARK_H
@@ -0,0 +1,89 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	MappedFile::MappedFile(const std::string& filename)
+	{
+		// FILE_FLAG_SEQUENTIAL_SCAN makes the cache manager read ahead aggressively and drop pages behind the reader
+		m_file = CreateFileA(
+			filename.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+		{
+			Logger::LogFormat("Can't open %s\n", filename.c_str());
+			return;
+		}
+
+		LARGE_INTEGER fileSize = {};
+		const BOOL hasSize = GetFileSizeEx(m_file, &fileSize);
+		ASSERT(hasSize);
+		m_size = fileSize.QuadPart;
+
+		// empty files can't be mapped
+		if (m_size == 0)
+		{
+			return;
+		}
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		ASSERT(m_mapping != nullptr);
+		if (m_mapping == nullptr)
+		{
+			return;
+		}
+
+		m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		ASSERT(m_data != nullptr);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data != nullptr)
+		{
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping != nullptr)
+		{
+			CloseHandle(m_mapping);
+		}
+		if (m_file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_file);
+		}
+	}
+
+	void MappedFile::PrefetchRange(uint64_t offset, uint64_t size) const
+	{
+		if (m_data == nullptr || offset >= m_size)
+		{
+			return;
+		}
+
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = const_cast<char*>(m_data + offset);
+		range.NumberOfBytes = static_cast<SIZE_T>(std::min(size, m_size - offset));
+		// only a hint, failure just means pages are faulted in on access
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+
+	void MappedFile::ReleaseRange(uint64_t offset, uint64_t size) const
+	{
+		if (m_data == nullptr || offset >= m_size)
+		{
+			return;
+		}
+
+		// unlocking pages that were never locked removes them from the working set
+		VirtualUnlock(const_cast<char*>(m_data + offset), static_cast<SIZE_T>(std::min(size, m_size - offset)));
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <string>
+
+#include "windows.h"
+
+namespace PointCloudViewer
+{
+	// Read-only view of a whole file backed by the page cache, nothing is copied into process memory.
+	// Pages are faulted in on first access, so workers can start parsing their ranges right away.
+	class MappedFile
+	{
+	public:
+		MappedFile() = delete;
+		MappedFile(const MappedFile& other) = delete;
+		MappedFile(MappedFile&& other) = delete;
+
+		explicit MappedFile(const std::string& filename);
+		~MappedFile();
+
+		// Sequential read-ahead hint for [offset, offset + size), the closest thing to madvise(MADV_SEQUENTIAL).
+		// Safe to call from any thread, ranges are clamped to the file.
+		void PrefetchRange(uint64_t offset, uint64_t size) const;
+		// Drops pages of [offset, offset + size) from the working set once they are consumed, madvise(MADV_DONTNEED) analog.
+		// Pages stay in the page cache, touching them again is a soft fault.
+		void ReleaseRange(uint64_t offset, uint64_t size) const;
+
+		[[nodiscard]] const char* GetData() const noexcept { return m_data; }
+		[[nodiscard]] uint64_t GetSize() const noexcept { return m_size; }
+		[[nodiscard]] bool IsValid() const noexcept { return m_data != nullptr || (m_file != INVALID_HANDLE_VALUE && m_size == 0); }
+
+	private:
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+		const char* m_data = nullptr;
+		uint64_t m_size = 0;
+	};
+}
+
+#endif // MAPPED_FILE_H
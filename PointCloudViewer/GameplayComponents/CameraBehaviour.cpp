@@ -6,6 +6,8 @@
 #include "SceneManager/Transform.h"
 #include "Utils/TimeCounter.h"
 
+#include <filesystem>
+
 namespace PointCloudViewer
 {
 	CameraBehaviour::CameraBehaviour(GameObject& go)
@@ -60,10 +62,54 @@ namespace PointCloudViewer
 			m_gameObject.GetTransform().GetXPosition() + math::mul(m_speed, vecWorld)
 		);
 
+		const math::vec3 right = math::toVec3(m_gameObject.GetTransform().GetXRight());
+
 		m_gameObject.GetTransform().SetRotation(
 			math::mul(m_gameObject.GetTransform().GetRotation(),
 			           math::mul(math::angleAxis(m_gameObject.GetTransform().GetXRight(), deltaXRotation),
 			                      math::angleAxis(math::xup, deltaYRotation)))
 		);
+
+		// the deltas are already scaled by the frame time
+		const float inverseDeltaTime = deltaTime > 0.0f ? 1.0f / deltaTime : 0.0f;
+		m_velocity = math::toVec3(vecWorld) * (m_speed * inverseDeltaTime);
+		m_angularVelocity = right * (deltaXRotation * inverseDeltaTime) + math::vec3(0.0f, deltaYRotation * inverseDeltaTime, 0.0f);
+
+		UpdateTraceRecording();
+	}
+
+	void CameraBehaviour::UpdateTraceRecording()
+	{
+		const bool isRecordKeyDown = InputManager::Get()->GetKeyDown(KeyCode::KEYCODE_R);
+		if (isRecordKeyDown && !m_wasRecordKeyDown)
+		{
+			m_isRecordingTrace = !m_isRecordingTrace;
+			if (m_isRecordingTrace)
+			{
+				m_trace.Clear();
+			}
+			else
+			{
+				m_trace.Save(std::filesystem::current_path() / "camera_trace.bin");
+			}
+		}
+		m_wasRecordKeyDown = isRecordKeyDown;
+
+		if (!m_isRecordingTrace)
+		{
+			return;
+		}
+
+		const Transform& transform = m_gameObject.GetTransform();
+		const math::vec3 position = transform.GetPosition();
+		DirectX::XMFLOAT4 rotation;
+		DirectX::XMStoreFloat4(&rotation, transform.GetRotation());
+		m_trace.AddSample({
+			.time = Time::GetTime(),
+			.position = {position.x, position.y, position.z},
+			.rotation = {rotation.x, rotation.y, rotation.z, rotation.w},
+			.velocity = {m_velocity.x, m_velocity.y, m_velocity.z},
+			.angularVelocity = {m_angularVelocity.x, m_angularVelocity.y, m_angularVelocity.z}
+		});
 	}
 }
@@ -2,6 +2,8 @@
 #define CAMERA_BEHAVIOUR_H
 
 #include "Components/Component.h"
+#include "Common/CameraTrace.h"
+#include "Common/Math/MathTypes.h"
 
 namespace PointCloudViewer
 {
@@ -16,7 +18,23 @@ namespace PointCloudViewer
 
 		void Update() final;
 
+		// Motion of the last update, what streaming extrapolates the pose with
+		[[nodiscard]] const math::vec3& GetVelocity() const noexcept { return m_velocity; }
+		[[nodiscard]] const math::vec3& GetAngularVelocity() const noexcept { return m_angularVelocity; }
+
 		float m_speed = 8.0;
+
+	private:
+		void UpdateTraceRecording();
+
+		math::vec3 m_velocity = math::vec3(0.0f, 0.0f, 0.0f);
+		// world axis scaled by radians per second
+		math::vec3 m_angularVelocity = math::vec3(0.0f, 0.0f, 0.0f);
+
+		// R starts and stops recording, the trace is saved when it stops
+		CameraTrace m_trace;
+		bool m_isRecordingTrace = false;
+		bool m_wasRecordKeyDown = false;
 	};
 }
 
@@ -29,6 +29,14 @@ namespace PointCloudViewer
 
 	D3D12_PLACED_SUBRESOURCE_FOOTPRINT g_subresourceFootprints[24];
 
+	// Buffers in the common state are promoted to copy destination by the copy itself and decay back once the queue
+	// finishes it. The state is tracked per queue, so other queues keep reading the ranges the copy doesn't write.
+	// Buffers kept in any other state are transitioned explicitly, which no other queue may overlap.
+	static bool NeedsCopyBarriers(D3D12_RESOURCE_STATES state)
+	{
+		return state != D3D12_RESOURCE_STATE_COMMON;
+	}
+
 	std::string ParseByteNumber(uint64_t bytes)
 	{
 		if (bytes == 0) return "0 b";
@@ -161,7 +169,7 @@ namespace PointCloudViewer
 	//	LoadDataToBufferInternal(bufferSize, gpuBuffer, 0);
 	//}
 
-	void MemoryManager::LoadDataToBuffer(const std::vector<BufferUploadPayload>& payloads, const Buffer* gpuBuffer) const
+	void MemoryManager::LoadDataToBuffer(const std::vector<BufferCopyRegion>& regions, const Buffer* gpuBuffer, uint64_t bufferOffset) const
 	{
 		m_queue->ResetForFrame();
 
@@ -169,31 +177,80 @@ namespace PointCloudViewer
 
 		const D3D12_RESOURCE_STATES state = gpuBuffer->GetCurrentResourceState();
 
-		GraphicsUtils::Barrier(
-			commandList,
-			gpuBuffer->GetBufferResource().Get(),
-			state,
-			D3D12_RESOURCE_STATE_COPY_DEST);
-
-		uint64_t bufferOffset = 0;
+		if (NeedsCopyBarriers(state))
+		{
+			GraphicsUtils::Barrier(
+				commandList,
+				gpuBuffer->GetBufferResource().Get(),
+				state,
+				D3D12_RESOURCE_STATE_COPY_DEST);
+		}
 
-		for (int i = 0; i < payloads.size(); i++)
+		for (const BufferCopyRegion& region : regions)
 		{
 			commandList->CopyBufferRegion(
 				gpuBuffer->GetBufferResource().Get(),
 				bufferOffset,
-				payloads[i].m_stagingBuffer->GetBufferResource().Get(),
-				0,
-				payloads[i].m_dataSize);
+				region.source->GetBufferResource().Get(),
+				region.sourceOffset,
+				region.size);
 
-			bufferOffset += payloads[i].m_dataSize;
+			bufferOffset += region.size;
 		}
 
-		GraphicsUtils::Barrier(
-			commandList,
-			gpuBuffer->GetBufferResource().Get(),
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			state);
+		if (NeedsCopyBarriers(state))
+		{
+			GraphicsUtils::Barrier(
+				commandList,
+				gpuBuffer->GetBufferResource().Get(),
+				D3D12_RESOURCE_STATE_COPY_DEST,
+				state);
+		}
+
+		ASSERT_SUCC(commandList->Close());
+
+		m_queue->Execute(0);
+
+		m_queue->WaitQueueIdle();
+	}
+
+	void MemoryManager::CopyBufferRegion(
+		const Buffer* source,
+		uint64_t sourceOffset,
+		const Buffer* destination,
+		uint64_t destinationOffset,
+		uint64_t size) const
+	{
+		m_queue->ResetForFrame();
+
+		const auto commandList = m_queue->GetCommandList(0);
+
+		const D3D12_RESOURCE_STATES state = destination->GetCurrentResourceState();
+
+		if (NeedsCopyBarriers(state))
+		{
+			GraphicsUtils::Barrier(
+				commandList,
+				destination->GetBufferResource().Get(),
+				state,
+				D3D12_RESOURCE_STATE_COPY_DEST);
+		}
+
+		commandList->CopyBufferRegion(
+			destination->GetBufferResource().Get(),
+			destinationOffset,
+			source->GetBufferResource().Get(),
+			sourceOffset,
+			size);
+
+		if (NeedsCopyBarriers(state))
+		{
+			GraphicsUtils::Barrier(
+				commandList,
+				destination->GetBufferResource().Get(),
+				D3D12_RESOURCE_STATE_COPY_DEST,
+				state);
+		}
 
 		ASSERT_SUCC(commandList->Close());
 
@@ -13,20 +13,11 @@
 
 namespace PointCloudViewer
 {
-	struct BufferUploadPayload
+	struct BufferCopyRegion
 	{
-		BufferUploadPayload():
-			m_stagingBuffer(std::make_unique<Buffer>(
-				m_bufferSize,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				D3D12_HEAP_TYPE_UPLOAD))
-
-		{
-		}
-
-		const uint64_t m_bufferSize = 64ull * 1024ull * 1024ull;
-		std::unique_ptr<Buffer> m_stagingBuffer;
-		uint64_t m_dataSize = 0;
+		const Buffer* source = nullptr;
+		uint64_t sourceOffset = 0;
+		uint64_t size = 0;
 	};
 
 	class MemoryManager : public Singleton<MemoryManager>
@@ -42,7 +33,17 @@ namespace PointCloudViewer
 		//	uint64_t bufferSize,
 		//	const Buffer* gpuBuffer) const;
 
-		void LoadDataToBuffer(const std::vector<BufferUploadPayload>& payloads, const Buffer* gpuBuffer) const;
+		// Regions are copied back to back starting at bufferOffset with one command list.
+		// A buffer created in the common state gets no barriers, frames on other queues may read it during the copy.
+		void LoadDataToBuffer(const std::vector<BufferCopyRegion>& regions, const Buffer* gpuBuffer, uint64_t bufferOffset = 0) const;
+		// Copies size bytes between buffers and waits for the copy, source has to be readable by copy (upload, generic read or common).
+		// Same as LoadDataToBuffer, a destination in the common state gets no barriers.
+		void CopyBufferRegion(
+			const Buffer* source,
+			uint64_t sourceOffset,
+			const Buffer* destination,
+			uint64_t destinationOffset,
+			uint64_t size) const;
 
 		ComPtr<ID3D12Resource> CreateResource(
 			D3D12_HEAP_TYPE heapType,
@@ -0,0 +1,362 @@
+#include "DecimalConverter.h"
+
+#include <bit>
+#include <charconv>
+#include <vector>
+#include <intrin.h>
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		constexpr int64_t SMALLEST_POWER_OF_TEN = -342;
+		constexpr int64_t LARGEST_POWER_OF_TEN = 308;
+
+		struct UInt128
+		{
+			uint64_t low;
+			uint64_t high;
+		};
+
+		UInt128 FullMultiplication(uint64_t a, uint64_t b)
+		{
+#if defined(_M_X64)
+			UInt128 result;
+			result.low = _umul128(a, b, &result.high);
+			return result;
+#else
+			const uint64_t aLow = a & 0xFFFFFFFF;
+			const uint64_t aHigh = a >> 32;
+			const uint64_t bLow = b & 0xFFFFFFFF;
+			const uint64_t bHigh = b >> 32;
+
+			const uint64_t lowLow = aLow * bLow;
+			const uint64_t lowHigh = aLow * bHigh;
+			const uint64_t highLow = aHigh * bLow;
+			const uint64_t highHigh = aHigh * bHigh;
+
+			const uint64_t middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFF) + (highLow & 0xFFFFFFFF);
+			return {
+				(middle << 32) | (lowLow & 0xFFFFFFFF),
+				highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32)
+			};
+#endif
+		}
+
+		// Minimal arbitrary precision unsigned integer, only used to build the powers of five table on startup
+		class BigInteger
+		{
+		public:
+			static BigInteger PowerOfTwo(uint32_t power)
+			{
+				BigInteger result;
+				result.m_limbs.resize(power / 32 + 1, 0);
+				result.m_limbs.back() = 1u << (power % 32);
+				return result;
+			}
+
+			explicit BigInteger(uint32_t value = 0) : m_limbs{value}
+			{
+			}
+
+			void MultiplySmall(uint32_t value)
+			{
+				uint64_t carry = 0;
+				for (uint32_t& limb : m_limbs)
+				{
+					const uint64_t product = static_cast<uint64_t>(limb) * value + carry;
+					limb = static_cast<uint32_t>(product);
+					carry = product >> 32;
+				}
+				if (carry != 0)
+				{
+					m_limbs.push_back(static_cast<uint32_t>(carry));
+				}
+			}
+
+			void DivideSmall(uint32_t value)
+			{
+				uint64_t remainder = 0;
+				for (size_t i = m_limbs.size(); i-- > 0;)
+				{
+					const uint64_t current = (remainder << 32) | m_limbs[i];
+					m_limbs[i] = static_cast<uint32_t>(current / value);
+					remainder = current % value;
+				}
+				Trim();
+			}
+
+			void AddOne()
+			{
+				for (uint32_t& limb : m_limbs)
+				{
+					if (++limb != 0)
+					{
+						return;
+					}
+				}
+				m_limbs.push_back(1);
+			}
+
+			[[nodiscard]] BigInteger ShiftRight(uint32_t bits) const
+			{
+				BigInteger result;
+				const uint32_t bitLength = BitLength();
+				if (bits >= bitLength)
+				{
+					return result;
+				}
+				result.m_limbs.resize((bitLength - bits + 31) / 32, 0);
+				for (uint32_t i = 0; i < result.m_limbs.size(); i++)
+				{
+					result.m_limbs[i] = static_cast<uint32_t>(GetBits64(static_cast<int64_t>(i) * 32 + bits));
+				}
+				result.Trim();
+				return result;
+			}
+
+			[[nodiscard]] uint32_t BitLength() const
+			{
+				return static_cast<uint32_t>(m_limbs.size() - 1) * 32 + std::bit_width(m_limbs.back());
+			}
+
+			// Most significant 128 bits, numbers shorter than 128 bits are shifted left
+			[[nodiscard]] UInt128 GetTop128() const
+			{
+				const int64_t bitLength = BitLength();
+				return {GetBits64(bitLength - 128), GetBits64(bitLength - 64)};
+			}
+
+		private:
+			// Bits [lowBit, lowBit + 64), bits with negative index or beyond the number are zeros
+			[[nodiscard]] uint64_t GetBits64(int64_t lowBit) const
+			{
+				uint64_t result = 0;
+				for (int64_t bit = 0; bit < 64; bit += 32)
+				{
+					const int64_t position = lowBit + bit;
+					const uint64_t part = GetBits32(position);
+					result |= part << bit;
+				}
+				return result;
+			}
+
+			[[nodiscard]] uint64_t GetBits32(int64_t lowBit) const
+			{
+				uint64_t result = 0;
+				for (int64_t limbIndex = lowBit >> 5; limbIndex <= (lowBit + 31) >> 5; limbIndex++)
+				{
+					if (limbIndex < 0 || limbIndex >= static_cast<int64_t>(m_limbs.size()))
+					{
+						continue;
+					}
+					const int64_t shift = limbIndex * 32 - lowBit;
+					const uint64_t limb = m_limbs[limbIndex];
+					result |= shift >= 0 ? limb << shift : limb >> -shift;
+				}
+				return result & 0xFFFFFFFF;
+			}
+
+			void Trim()
+			{
+				while (m_limbs.size() > 1 && m_limbs.back() == 0)
+				{
+					m_limbs.pop_back();
+				}
+			}
+
+			std::vector<uint32_t> m_limbs;
+		};
+
+		// Truncated 128 bit normalized 5^q for q in [SMALLEST_POWER_OF_TEN, LARGEST_POWER_OF_TEN].
+		// Negative powers are 2^b / 5^-q rounded the same way as in the Eisel-Lemire reference tables.
+		std::vector<UInt128> BuildPowersOfFiveTable()
+		{
+			std::vector<UInt128> table(LARGEST_POWER_OF_TEN - SMALLEST_POWER_OF_TEN + 1);
+
+			// floor(2^B / 5^k) for every k is obtained by repeated division, B covers the biggest b needed below
+			constexpr uint32_t reciprocalBits = 1760;
+			BigInteger reciprocal = BigInteger::PowerOfTwo(reciprocalBits);
+			BigInteger powerOfFive(1);
+			for (int64_t k = 1; k <= -SMALLEST_POWER_OF_TEN; k++)
+			{
+				reciprocal.DivideSmall(5);
+				powerOfFive.MultiplySmall(5);
+
+				const uint32_t z = powerOfFive.BitLength();
+				const uint32_t b = k <= 27 ? z + 127 : 2 * z + 128;
+
+				BigInteger value = reciprocal.ShiftRight(reciprocalBits - b);
+				value.AddOne();
+				table[-k - SMALLEST_POWER_OF_TEN] = value.GetTop128();
+			}
+
+			powerOfFive = BigInteger(1);
+			for (int64_t q = 0; q <= LARGEST_POWER_OF_TEN; q++)
+			{
+				table[q - SMALLEST_POWER_OF_TEN] = powerOfFive.GetTop128();
+				powerOfFive.MultiplySmall(5);
+			}
+
+			return table;
+		}
+
+		const std::vector<UInt128> g_powersOfFive = BuildPowersOfFiveTable();
+
+		template <typename T>
+		struct BinaryFormat;
+
+		template <>
+		struct BinaryFormat<double>
+		{
+			using Bits = uint64_t;
+			static constexpr int32_t MANTISSA_BITS = 52;
+			static constexpr int32_t MINIMUM_EXPONENT = -1023;
+			static constexpr int32_t INFINITE_POWER = 0x7FF;
+			static constexpr int32_t SIGN_BIT = 63;
+			static constexpr int64_t SMALLEST_POWER = -342;
+			static constexpr int64_t LARGEST_POWER = 308;
+			static constexpr int64_t MIN_ROUND_TO_EVEN = -4;
+			static constexpr int64_t MAX_ROUND_TO_EVEN = 23;
+		};
+
+		template <>
+		struct BinaryFormat<float>
+		{
+			using Bits = uint32_t;
+			static constexpr int32_t MANTISSA_BITS = 23;
+			static constexpr int32_t MINIMUM_EXPONENT = -127;
+			static constexpr int32_t INFINITE_POWER = 0xFF;
+			static constexpr int32_t SIGN_BIT = 31;
+			static constexpr int64_t SMALLEST_POWER = -65;
+			static constexpr int64_t LARGEST_POWER = 38;
+			static constexpr int64_t MIN_ROUND_TO_EVEN = -17;
+			static constexpr int64_t MAX_ROUND_TO_EVEN = 10;
+		};
+
+		struct AdjustedMantissa
+		{
+			uint64_t mantissa = 0;
+			int32_t power2 = 0;
+
+			bool operator==(const AdjustedMantissa&) const = default;
+		};
+
+		// floor(log2(10^q)) + 63 for q in the table range
+		int32_t Power(int32_t q)
+		{
+			return (((152170 + 65536) * q) >> 16) + 63;
+		}
+
+		template <typename T>
+		AdjustedMantissa ComputeFloat(int64_t q, uint64_t w)
+		{
+			using Format = BinaryFormat<T>;
+			AdjustedMantissa answer;
+
+			if (w == 0 || q < Format::SMALLEST_POWER)
+			{
+				return answer;
+			}
+			if (q > Format::LARGEST_POWER)
+			{
+				answer.power2 = Format::INFINITE_POWER;
+				return answer;
+			}
+
+			const int32_t leadingZeros = std::countl_zero(w);
+			w <<= leadingZeros;
+
+			// w * 5^q is needed only up to mantissa + 3 bits, the low half of the power is used when the
+			// bits right after them are all ones and could still be changed by a carry
+			const UInt128& power = g_powersOfFive[q - SMALLEST_POWER_OF_TEN];
+			UInt128 product = FullMultiplication(w, power.high);
+			constexpr uint64_t precisionMask = 0xFFFFFFFFFFFFFFFFull >> (Format::MANTISSA_BITS + 3);
+			if ((product.high & precisionMask) == precisionMask)
+			{
+				const UInt128 secondProduct = FullMultiplication(w, power.low);
+				product.low += secondProduct.high;
+				if (secondProduct.high > product.low)
+				{
+					product.high++;
+				}
+			}
+
+			const int32_t upperBit = static_cast<int32_t>(product.high >> 63);
+			const int32_t shift = upperBit + 64 - Format::MANTISSA_BITS - 3;
+			answer.mantissa = product.high >> shift;
+			answer.power2 = Power(static_cast<int32_t>(q)) + upperBit - leadingZeros - Format::MINIMUM_EXPONENT;
+
+			if (answer.power2 <= 0)
+			{
+				// subnormal result
+				if (-answer.power2 + 1 >= 64)
+				{
+					return {};
+				}
+				answer.mantissa >>= -answer.power2 + 1;
+				answer.mantissa += answer.mantissa & 1;
+				answer.mantissa >>= 1;
+				answer.power2 = answer.mantissa < (1ull << Format::MANTISSA_BITS) ? 0 : 1;
+				return answer;
+			}
+
+			// exactly halfway between two floats, only possible for small powers
+			if (product.low <= 1 &&
+				q >= Format::MIN_ROUND_TO_EVEN && q <= Format::MAX_ROUND_TO_EVEN &&
+				(answer.mantissa & 3) == 1 &&
+				(answer.mantissa << shift) == product.high)
+			{
+				answer.mantissa &= ~1ull;
+			}
+
+			answer.mantissa += answer.mantissa & 1;
+			answer.mantissa >>= 1;
+			if (answer.mantissa >= (2ull << Format::MANTISSA_BITS))
+			{
+				answer.mantissa = 1ull << Format::MANTISSA_BITS;
+				answer.power2++;
+			}
+			answer.mantissa &= ~(1ull << Format::MANTISSA_BITS);
+
+			if (answer.power2 >= Format::INFINITE_POWER)
+			{
+				answer.power2 = Format::INFINITE_POWER;
+				answer.mantissa = 0;
+			}
+			return answer;
+		}
+
+		template <typename T>
+		T ToBinary(const Decimal& decimal, const char* numberBegin, const char* numberEnd)
+		{
+			using Format = BinaryFormat<T>;
+			AdjustedMantissa adjusted = ComputeFloat<T>(decimal.exponent, decimal.mantissa);
+			if (decimal.truncated && adjusted != ComputeFloat<T>(decimal.exponent, decimal.mantissa + 1))
+			{
+				// dropped digits can change rounding, let the standard library look at all of them
+				T value = 0;
+				std::from_chars(numberBegin, numberEnd, value);
+				return decimal.negative ? -value : value;
+			}
+
+			typename Format::Bits bits = static_cast<typename Format::Bits>(
+				adjusted.mantissa | static_cast<uint64_t>(adjusted.power2) << Format::MANTISSA_BITS);
+			if (decimal.negative)
+			{
+				bits |= static_cast<typename Format::Bits>(1) << Format::SIGN_BIT;
+			}
+			return std::bit_cast<T>(bits);
+		}
+	}
+
+	double DecimalConverter::ToDoubleSlow(const Decimal& decimal, const char* numberBegin, const char* numberEnd)
+	{
+		return ToBinary<double>(decimal, numberBegin, numberEnd);
+	}
+
+	float DecimalConverter::ToFloatSlow(const Decimal& decimal, const char* numberBegin, const char* numberEnd)
+	{
+		return ToBinary<float>(decimal, numberBegin, numberEnd);
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef DECIMAL_CONVERTER_H
+#define DECIMAL_CONVERTER_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace PointCloudViewer
+{
+	// Number in the form of mantissa * 10^exponent, mantissa holds at most 19 significant digits
+	struct Decimal
+	{
+		uint64_t mantissa = 0;
+		int64_t exponent = 0;
+		bool negative = false;
+		// some significant digits didn't fit in the mantissa and were dropped
+		bool truncated = false;
+	};
+
+	// Correctly rounded decimal -> binary conversion, results are bit exact with strtod/strtof.
+	// Exact cases use Clinger's fast path which is inlined since it covers nearly every number of a scanner export,
+	// the rest goes through Eisel-Lemire with 128 bit powers of five.
+	// Text of the number (without sign) is needed only for truncated mantissas Eisel-Lemire can't round unambiguously.
+	class DecimalConverter
+	{
+	public:
+		[[nodiscard]] static double ToDouble(const Decimal& decimal, const char* numberBegin, const char* numberEnd)
+		{
+			if (!decimal.truncated && decimal.exponent >= -22 && decimal.exponent <= 22 && decimal.mantissa <= (1ull << 53))
+			{
+				// mantissa and powers of ten are exact and one of the powers is 1, so the result is rounded once.
+				// Sign is applied with bits, random signs of coordinates are a guaranteed misprediction otherwise.
+				const double value = static_cast<double>(decimal.mantissa) *
+					DOUBLE_POWERS_OF_TEN[std::max<int64_t>(decimal.exponent, 0)] /
+					DOUBLE_POWERS_OF_TEN[std::max<int64_t>(-decimal.exponent, 0)];
+				return std::bit_cast<double>(std::bit_cast<uint64_t>(value) | static_cast<uint64_t>(decimal.negative) << 63);
+			}
+			return ToDoubleSlow(decimal, numberBegin, numberEnd);
+		}
+
+		[[nodiscard]] static float ToFloat(const Decimal& decimal, const char* numberBegin, const char* numberEnd)
+		{
+			if (!decimal.truncated && decimal.exponent >= -10 && decimal.exponent <= 10 && decimal.mantissa <= (1ull << 24))
+			{
+				const float value = static_cast<float>(decimal.mantissa) *
+					FLOAT_POWERS_OF_TEN[std::max<int64_t>(decimal.exponent, 0)] /
+					FLOAT_POWERS_OF_TEN[std::max<int64_t>(-decimal.exponent, 0)];
+				return std::bit_cast<float>(std::bit_cast<uint32_t>(value) | static_cast<uint32_t>(decimal.negative) << 31);
+			}
+			return ToFloatSlow(decimal, numberBegin, numberEnd);
+		}
+
+	private:
+		static double ToDoubleSlow(const Decimal& decimal, const char* numberBegin, const char* numberEnd);
+		static float ToFloatSlow(const Decimal& decimal, const char* numberBegin, const char* numberEnd);
+
+		static constexpr double DOUBLE_POWERS_OF_TEN[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		static constexpr float FLOAT_POWERS_OF_TEN[] = {
+			1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+		};
+	};
+}
+
+#endif // DECIMAL_CONVERTER_H
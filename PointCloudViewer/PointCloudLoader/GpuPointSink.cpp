@@ -0,0 +1,106 @@
+#include "GpuPointSink.h"
+
+#include <algorithm>
+
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	// Amount of blocks uploaded with one copy when points are overwritten
+	static constexpr uint64_t OVERWRITE_BATCH_BLOCKS_COUNT = 64;
+
+	GpuPointSink::GpuPointSink() :
+		m_blockPool(PointBlockMemory::Upload)
+	{
+	}
+
+	void GpuPointSink::Begin(uint64_t estimatedPointsCount, const PointOrigin& origin)
+	{
+		m_origin = origin;
+		Reserve(std::max<uint64_t>(estimatedPointsCount, 1));
+	}
+
+	void GpuPointSink::Consume(const PointBlock* blocks, uint64_t count)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		m_copyRegions.clear();
+		for (const PointBlock* block = blocks; block != nullptr; block = block->next)
+		{
+			ASSERT(block->buffer != nullptr);
+			m_copyRegions.push_back({block->buffer, 0, block->count * sizeof(PackedPoint)});
+		}
+
+		// only this thread writes the count
+		const uint64_t pointsCount = m_pointsCount.load(std::memory_order_relaxed);
+		Reserve(pointsCount + count);
+		// range past the count isn't drawn yet and the buffer stays in the common state the render queue reads it in,
+		// so neither the bytes nor the resource state race with frames in flight
+		MemoryManager::Get()->LoadDataToBuffer(m_copyRegions, m_gpuBuffer->GetBuffer(), pointsCount * sizeof(PackedPoint));
+		m_pointsCount.store(pointsCount + count, std::memory_order_release);
+	}
+
+	void GpuPointSink::End(const PointCloudStats& stats)
+	{
+	}
+
+	void GpuPointSink::OverwritePoints(const std::vector<PackedPoint>& points)
+	{
+		ASSERT(points.size() == m_pointsCount.load(std::memory_order_relaxed));
+
+		// a second buffer of the whole cloud wouldn't fit the linear GPU heap
+		const uint64_t batchSize = m_blockPool.GetPointsPerBlock() * OVERWRITE_BATCH_BLOCKS_COUNT;
+		for (uint64_t batchBegin = 0; batchBegin < points.size(); batchBegin += batchSize)
+		{
+			PointBlockWriter writer(&m_blockPool);
+			writer.Append(points.data() + batchBegin, std::min<uint64_t>(batchSize, points.size() - batchBegin));
+
+			m_copyRegions.clear();
+			for (const PointBlock* block = writer.GetHead(); block != nullptr; block = block->next)
+			{
+				m_copyRegions.push_back({block->buffer, 0, block->count * sizeof(PackedPoint)});
+			}
+			MemoryManager::Get()->LoadDataToBuffer(m_copyRegions, m_gpuBuffer->GetBuffer(), batchBegin * sizeof(PackedPoint));
+			m_blockPool.Release(writer.GetHead());
+		}
+	}
+
+	void GpuPointSink::Reserve(uint64_t pointsCount)
+	{
+		if (pointsCount <= m_capacity)
+		{
+			return;
+		}
+
+		const uint64_t capacity = std::max(pointsCount, m_capacity + m_capacity / 2);
+		ASSERT(capacity <= UINT32_MAX);
+		if (m_gpuBuffer != nullptr)
+		{
+			// linear GPU heap doesn't reuse the old allocation, so a good estimate matters
+			Logger::LogFormat("Point buffer estimate exceeded, growing from %llu to %llu points\n", m_capacity, capacity);
+		}
+
+		std::unique_ptr<UAVGpuBuffer> gpuBuffer = std::make_unique<UAVGpuBuffer>(
+			static_cast<uint32_t>(capacity), sizeof(PackedPoint), D3D12_RESOURCE_STATE_COMMON);
+		const uint64_t committedCount = m_pointsCount.load(std::memory_order_relaxed);
+		if (committedCount > 0)
+		{
+			MemoryManager::Get()->CopyBufferRegion(
+				m_gpuBuffer->GetBuffer(), 0,
+				gpuBuffer->GetBuffer(), 0,
+				committedCount * sizeof(PackedPoint));
+		}
+
+		if (m_gpuBuffer != nullptr)
+		{
+			m_retiredBuffers.push_back(std::move(m_gpuBuffer));
+		}
+		m_gpuBuffer = std::move(gpuBuffer);
+		m_publishedBuffer.store(m_gpuBuffer.get(), std::memory_order_release);
+		m_capacity = capacity;
+	}
+}
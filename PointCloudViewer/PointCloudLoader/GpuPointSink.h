@@ -0,0 +1,58 @@
+#ifndef GPU_POINT_SINK_H
+#define GPU_POINT_SINK_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "PointSink.h"
+#include "MemoryManager/MemoryManager.h"
+#include "ResourceManager/Buffers/UAVGpuBuffer.h"
+
+namespace PointCloudViewer
+{
+	// Parsers write straight into upload heap blocks, every batch is copied to the GPU buffer block by block.
+	// GPU buffer is sized by the estimate and reallocated if the file has more points than expected.
+	// Buffer and points count are published as batches are committed, so the renderer can draw while loading:
+	// the count is stored after the batch is copied and after any reallocation it needs, read it before the buffer.
+	// Buffers replaced by a reallocation stay alive with the sink, frames in flight may still read them.
+	// Buffers are kept in the common state: uploads on the memory manager queue and draws on the render queue each promote it
+	// implicitly, nothing transitions it under the other queue.
+	class GpuPointSink : public IPointSink
+	{
+	public:
+		GpuPointSink();
+
+		[[nodiscard]] PointBlockPool* GetBlockPool() override { return &m_blockPool; }
+
+		void Begin(uint64_t estimatedPointsCount, const PointOrigin& origin) override;
+		void Consume(const PointBlock* blocks, uint64_t count) override;
+		void End(const PointCloudStats& stats) override;
+
+		// Uploads the same points in another order over the committed ones, count and buffer stay as they are.
+		// The whole drawn range is rewritten, no frame may read the buffer until it returns.
+		void OverwritePoints(const std::vector<PackedPoint>& points);
+
+		// Safe to call from any thread
+		[[nodiscard]] uint64_t GetPointsCount() const noexcept { return m_pointsCount.load(std::memory_order_acquire); }
+		// Safe to call from any thread, holds at least GetPointsCount points read before it
+		[[nodiscard]] UAVGpuBuffer* GetBuffer() const noexcept { return m_publishedBuffer.load(std::memory_order_acquire); }
+		// Valid once GetPointsCount isn't zero
+		[[nodiscard]] const PointOrigin& GetOrigin() const noexcept { return m_origin; }
+
+	private:
+		void Reserve(uint64_t pointsCount);
+
+		PointBlockPool m_blockPool;
+		std::vector<BufferCopyRegion> m_copyRegions;
+
+		std::unique_ptr<UAVGpuBuffer> m_gpuBuffer;
+		std::vector<std::unique_ptr<UAVGpuBuffer>> m_retiredBuffers;
+		std::atomic<UAVGpuBuffer*> m_publishedBuffer = nullptr;
+		uint64_t m_capacity = 0;
+		std::atomic<uint64_t> m_pointsCount = 0;
+		PointOrigin m_origin;
+	};
+}
+
+#endif // GPU_POINT_SINK_H
@@ -0,0 +1,184 @@
+#include "LasLoader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "PointPacking.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	static constexpr uint64_t LAS_MIN_HEADER_SIZE = 227;
+	static constexpr uint64_t LAS_14_HEADER_SIZE = 375;
+
+	// Records checked to tell 8-bit colours from 16-bit ones
+	static constexpr uint64_t COLOR_SAMPLE_RECORDS_COUNT = 64 * 1024;
+
+	template <typename T>
+	static T ReadValue(const char* data)
+	{
+		T value;
+		std::memcpy(&value, data, sizeof(T));
+		return value;
+	}
+
+	LasLoader::LasLoader(const MappedFile* file, IPointSink* sink) :
+		m_file(file),
+		m_sink(sink)
+	{
+		m_isValid = ReadHeader();
+	}
+
+	bool LasLoader::ReadHeader()
+	{
+		const char* data = m_file->GetData();
+		const uint64_t fileSize = m_file->GetSize();
+		if (fileSize < LAS_MIN_HEADER_SIZE || std::memcmp(data, "LASF", 4) != 0)
+		{
+			Logger::Log("Not a LAS file\n");
+			return false;
+		}
+
+		m_header.versionMajor = ReadValue<uint8_t>(data + 24);
+		m_header.versionMinor = ReadValue<uint8_t>(data + 25);
+		if (m_header.versionMajor != 1 || m_header.versionMinor < 2 || m_header.versionMinor > 4)
+		{
+			Logger::LogFormat("LAS %u.%u isn't supported\n", m_header.versionMajor, m_header.versionMinor);
+			return false;
+		}
+
+		const uint16_t headerSize = ReadValue<uint16_t>(data + 94);
+		m_header.pointDataOffset = ReadValue<uint32_t>(data + 96);
+		m_header.pointFormat = ReadValue<uint8_t>(data + 104);
+		m_header.pointRecordLength = ReadValue<uint16_t>(data + 105);
+		m_header.pointsCount = ReadValue<uint32_t>(data + 107);
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			m_header.scale[axis] = ReadValue<double>(data + 131 + axis * sizeof(double));
+			m_header.offset[axis] = ReadValue<double>(data + 155 + axis * sizeof(double));
+			// stored as max x, min x, max y, min y, max z, min z
+			m_header.boundsMax[axis] = ReadValue<double>(data + 179 + axis * 2 * sizeof(double));
+			m_header.boundsMin[axis] = ReadValue<double>(data + 187 + axis * 2 * sizeof(double));
+		}
+		// 1.4 keeps the legacy 32-bit count only for files that fit it
+		if (m_header.versionMinor >= 4 && headerSize >= LAS_14_HEADER_SIZE && fileSize >= LAS_14_HEADER_SIZE)
+		{
+			const uint64_t pointsCount = ReadValue<uint64_t>(data + 247);
+			m_header.pointsCount = pointsCount != 0 ? pointsCount : m_header.pointsCount;
+		}
+
+		// two high bits of the format are set by LASzip
+		if ((m_header.pointFormat & 0xC0) != 0)
+		{
+			Logger::Log("Compressed LAS isn't supported\n");
+			return false;
+		}
+
+		static constexpr RecordLayout RECORD_LAYOUTS[] = {
+			{20, 0}, // 0
+			{28, 0}, // 1: + GPS time
+			{26, 20}, // 2: + RGB
+			{34, 28}, // 3: + GPS time, RGB
+			{}, // 4: waveform
+			{}, // 5: waveform
+			{30, 0}, // 6: extended returns, GPS time
+			{36, 30}, // 7: + RGB
+			{38, 30}, // 8: + RGB, NIR
+		};
+		if (m_header.pointFormat >= std::size(RECORD_LAYOUTS) || RECORD_LAYOUTS[m_header.pointFormat].minRecordLength == 0)
+		{
+			Logger::LogFormat("LAS point format %u isn't supported\n", m_header.pointFormat);
+			return false;
+		}
+		m_layout = RECORD_LAYOUTS[m_header.pointFormat];
+
+		// records may carry extra bytes after the standard fields
+		if (m_header.pointRecordLength < m_layout.minRecordLength || m_header.pointDataOffset > fileSize)
+		{
+			Logger::Log("Corrupted LAS header\n");
+			return false;
+		}
+
+		const uint64_t storedPointsCount = (fileSize - m_header.pointDataOffset) / m_header.pointRecordLength;
+		if (storedPointsCount < m_header.pointsCount)
+		{
+			Logger::LogFormat("LAS file is truncated, %llu of %llu points are present\n", storedPointsCount, m_header.pointsCount);
+			m_header.pointsCount = storedPointsCount;
+		}
+
+		// header bounds are written by every LAS producer, the quantization offset is the fallback for broken or empty ones
+		bool hasBounds = false;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			if (m_header.boundsMin[axis] > m_header.boundsMax[axis])
+			{
+				hasBounds = false;
+				break;
+			}
+			hasBounds |= m_header.boundsMin[axis] < m_header.boundsMax[axis];
+		}
+		m_origin = hasBounds
+			           ? PointOrigin{
+				           (m_header.boundsMin[0] + m_header.boundsMax[0]) * 0.5,
+				           (m_header.boundsMin[1] + m_header.boundsMax[1]) * 0.5,
+				           (m_header.boundsMin[2] + m_header.boundsMax[2]) * 0.5
+			           }
+			           : PointOrigin{m_header.offset[0], m_header.offset[1], m_header.offset[2]};
+		m_positionOffset[0] = m_header.offset[0] - m_origin.x;
+		m_positionOffset[1] = m_header.offset[1] - m_origin.y;
+		m_positionOffset[2] = m_header.offset[2] - m_origin.z;
+
+		if (m_layout.colorOffset != 0)
+		{
+			const char* records = data + m_header.pointDataOffset;
+			uint16_t maxChannel = 0;
+			for (uint64_t i = 0; i < std::min(m_header.pointsCount, COLOR_SAMPLE_RECORDS_COUNT); i++)
+			{
+				const char* color = records + i * m_header.pointRecordLength + m_layout.colorOffset;
+				maxChannel = std::max({maxChannel, ReadValue<uint16_t>(color), ReadValue<uint16_t>(color + 2), ReadValue<uint16_t>(color + 4)});
+			}
+			m_colorScale = maxChannel <= 255 ? 1.0f / 255.0f : 1.0f / 65535.0f;
+		}
+
+		return true;
+	}
+
+	uint64_t LasLoader::Load()
+	{
+		if (!m_isValid)
+		{
+			m_sink->Begin(0, m_origin);
+			m_sink->End(m_stats);
+			return 0;
+		}
+
+		m_stats = LoadPointRecords(m_file, m_sink, m_origin, m_header.pointDataOffset, m_header.pointRecordLength, m_header.pointsCount,
+		                           [this](const char* records, uint64_t recordsCount, PointBlockWriter& writer)
+		                           {
+			                           DecodeRecords(records, recordsCount, writer);
+		                           });
+		return m_stats.pointsCount;
+	}
+
+	void LasLoader::DecodeRecords(const char* record, uint64_t recordsCount, PointBlockWriter& writer) const
+	{
+		for (uint64_t i = 0; i < recordsCount; i++, record += m_header.pointRecordLength)
+		{
+			const double x = ReadValue<int32_t>(record) * m_header.scale[0] + m_positionOffset[0];
+			const double y = ReadValue<int32_t>(record + 4) * m_header.scale[1] + m_positionOffset[1];
+			const double z = ReadValue<int32_t>(record + 8) * m_header.scale[2] + m_positionOffset[2];
+			const float intensity = ReadValue<uint16_t>(record + 12) / 65535.0f;
+
+			float r = 1.0f, g = 1.0f, b = 1.0f;
+			if (m_layout.colorOffset != 0)
+			{
+				const char* color = record + m_layout.colorOffset;
+				r = ReadValue<uint16_t>(color) * m_colorScale;
+				g = ReadValue<uint16_t>(color + 2) * m_colorScale;
+				b = ReadValue<uint16_t>(color + 4) * m_colorScale;
+			}
+
+			writer.Append(PackPoint(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z), r, g, b, intensity));
+		}
+	}
+}
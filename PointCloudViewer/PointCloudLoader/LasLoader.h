@@ -0,0 +1,68 @@
+#ifndef LAS_LOADER_H
+#define LAS_LOADER_H
+
+#include <cstdint>
+
+#include "PointLoader.h"
+#include "PointSink.h"
+#include "DataManager/MappedFile.h"
+
+namespace PointCloudViewer
+{
+	// Part of the LAS public header the loader needs, the same for 1.2 - 1.4
+	struct LasHeader
+	{
+		uint8_t versionMajor = 0;
+		uint8_t versionMinor = 0;
+		uint32_t pointDataOffset = 0;
+		uint8_t pointFormat = 0;
+		uint16_t pointRecordLength = 0;
+		uint64_t pointsCount = 0;
+		double scale[3] = {};
+		double offset[3] = {};
+		double boundsMin[3] = {};
+		double boundsMax[3] = {};
+	};
+
+	// Reader of uncompressed LAS 1.2 - 1.4 with point data record formats 0-3 and 6-8.
+	// Records have a fixed stride and are decoded in parallel straight into sink blocks, see LoadPointRecords.
+	class LasLoader : public IPointLoader
+	{
+	public:
+		LasLoader(const MappedFile* file, IPointSink* sink);
+
+		// Invalid files are reported on construction and load zero points
+		[[nodiscard]] bool IsValid() const noexcept { return m_isValid; }
+		[[nodiscard]] const LasHeader& GetHeader() const noexcept { return m_header; }
+
+		uint64_t Load() override;
+		[[nodiscard]] PointOrigin GetOrigin() const override { return m_origin; }
+		[[nodiscard]] const PointCloudStats& GetStats() const override { return m_stats; }
+
+	private:
+		struct RecordLayout
+		{
+			uint32_t minRecordLength;
+			// offset of the three 16-bit colour channels, 0 when the format has no colour
+			uint32_t colorOffset;
+		};
+
+		bool ReadHeader();
+		void DecodeRecords(const char* record, uint64_t recordsCount, PointBlockWriter& writer) const;
+
+		const MappedFile* m_file;
+		IPointSink* m_sink;
+
+		LasHeader m_header;
+		RecordLayout m_layout = {};
+		// colours are specified as 16-bit, but plenty of writers store 8-bit values
+		float m_colorScale = 1.0f / 65535.0f;
+		// center of the header bounds, positions are dequantized straight into origin-relative ones
+		PointOrigin m_origin;
+		double m_positionOffset[3] = {};
+		PointCloudStats m_stats;
+		bool m_isValid = false;
+	};
+}
+
+#endif // LAS_LOADER_H
@@ -0,0 +1,191 @@
+#include "MortonSort.h"
+
+#include <cstring>
+#include <limits>
+
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Assert.h"
+
+namespace PointCloudViewer
+{
+	// Ranges shorter than this aren't worth a task
+	static constexpr uint64_t MORTON_MIN_RANGE_SIZE = 64 * 1024;
+	// Entries a bucket gathers before they are written out, two cache lines
+	static constexpr uint32_t WRITE_COMBINING_ENTRIES_COUNT = 128 / sizeof(MortonEntry);
+
+	static_assert((1 << RADIX) == BUCKET_SIZE);
+
+	static uint64_t GetRangesCount(uint64_t count)
+	{
+		return std::clamp<uint64_t>(count / MORTON_MIN_RANGE_SIZE, 1, ThreadManager::Get()->GetWorkersCount());
+	}
+
+	static uint64_t GetRangeBoundary(uint64_t count, uint64_t rangesCount, uint64_t rangeIndex)
+	{
+		return count * rangeIndex / rangesCount;
+	}
+
+	MortonQuantizer::MortonQuantizer(const float (&boundsMin)[3], const float (&boundsMax)[3], uint32_t bitsPerAxis) :
+		m_bitsPerAxis(bitsPerAxis),
+		m_maxCell((1u << bitsPerAxis) - 1)
+	{
+		ASSERT(bitsPerAxis >= 1 && bitsPerAxis <= MAX_BITS_PER_AXIS);
+
+		float extent = 0.0f;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			m_boundsMin[axis] = boundsMin[axis];
+			extent = std::max(extent, boundsMax[axis] - boundsMin[axis]);
+		}
+		// a point or an empty cloud is a single cell
+		m_scale = extent > 0.0f ? static_cast<float>(m_maxCell + 1) / extent : 0.0f;
+	}
+
+	MortonQuantizer MortonQuantizer::FromPoints(const std::vector<PackedPoint>& points, uint32_t bitsPerAxis)
+	{
+		const uint64_t count = points.size();
+		const uint64_t rangesCount = GetRangesCount(count);
+
+		std::vector<float> rangeBounds(rangesCount * 6);
+		ThreadManager::Get()->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			float* bounds = &rangeBounds[rangeIndex * 6];
+			std::fill_n(bounds, 3, std::numeric_limits<float>::max());
+			std::fill_n(bounds + 3, 3, std::numeric_limits<float>::lowest());
+			for (uint64_t i = GetRangeBoundary(count, rangesCount, rangeIndex); i < GetRangeBoundary(count, rangesCount, rangeIndex + 1); i++)
+			{
+				const float position[3] = {points[i].position.x, points[i].position.y, points[i].position.z};
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					bounds[axis] = std::min(bounds[axis], position[axis]);
+					bounds[axis + 3] = std::max(bounds[axis + 3], position[axis]);
+				}
+			}
+		});
+
+		float boundsMin[3] = {};
+		float boundsMax[3] = {};
+		for (uint32_t axis = 0; axis < 3 && count != 0; axis++)
+		{
+			boundsMin[axis] = std::numeric_limits<float>::max();
+			boundsMax[axis] = std::numeric_limits<float>::lowest();
+			for (uint64_t rangeIndex = 0; rangeIndex < rangesCount; rangeIndex++)
+			{
+				boundsMin[axis] = std::min(boundsMin[axis], rangeBounds[rangeIndex * 6 + axis]);
+				boundsMax[axis] = std::max(boundsMax[axis], rangeBounds[rangeIndex * 6 + axis + 3]);
+			}
+		}
+		return MortonQuantizer(boundsMin, boundsMax, bitsPerAxis);
+	}
+
+	std::vector<MortonEntry> ComputeMortonEntries(const std::vector<PackedPoint>& points, const MortonQuantizer& quantizer)
+	{
+		ASSERT(points.size() <= std::numeric_limits<uint32_t>::max());
+
+		const uint64_t count = points.size();
+		const uint64_t rangesCount = GetRangesCount(count);
+		std::vector<MortonEntry> entries(count);
+		ThreadManager::Get()->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			for (uint64_t i = GetRangeBoundary(count, rangesCount, rangeIndex); i < GetRangeBoundary(count, rangesCount, rangeIndex + 1); i++)
+			{
+				entries[i] = {quantizer.Encode(points[i]), static_cast<uint32_t>(i)};
+			}
+		});
+		return entries;
+	}
+
+	void RadixSortMortonEntries(std::vector<MortonEntry>& entries, uint32_t keyBits)
+	{
+		ASSERT(keyBits <= 64);
+
+		const uint64_t count = entries.size();
+		if (count < 2)
+		{
+			return;
+		}
+
+		ThreadManager* threadManager = ThreadManager::Get();
+		const uint64_t rangesCount = GetRangesCount(count);
+
+		std::vector<MortonEntry> sortedEntries(count);
+		// bucket counts of every range, turned into the range's write offsets in place
+		std::vector<uint64_t> rangeOffsets(rangesCount * BUCKET_SIZE);
+		for (uint32_t shift = 0; shift < keyBits; shift += RADIX)
+		{
+			const uint64_t digitMask = (1ull << std::min<uint32_t>(RADIX, keyBits - shift)) - 1;
+
+			std::fill(rangeOffsets.begin(), rangeOffsets.end(), 0);
+			threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+			{
+				uint64_t* counts = &rangeOffsets[rangeIndex * BUCKET_SIZE];
+				for (uint64_t i = GetRangeBoundary(count, rangesCount, rangeIndex); i < GetRangeBoundary(count, rangesCount, rangeIndex + 1); i++)
+				{
+					counts[entries[i].code >> shift & digitMask]++;
+				}
+			});
+
+			// bucket by bucket, ranges in order inside a bucket, so the pass is stable
+			bool isSingleBucket = false;
+			uint64_t offset = 0;
+			for (uint32_t bucket = 0; bucket < BUCKET_SIZE && !isSingleBucket; bucket++)
+			{
+				const uint64_t bucketBegin = offset;
+				for (uint64_t rangeIndex = 0; rangeIndex < rangesCount; rangeIndex++)
+				{
+					const uint64_t bucketCount = rangeOffsets[rangeIndex * BUCKET_SIZE + bucket];
+					rangeOffsets[rangeIndex * BUCKET_SIZE + bucket] = offset;
+					offset += bucketCount;
+				}
+				isSingleBucket = offset - bucketBegin == count;
+			}
+			if (isSingleBucket)
+			{
+				continue;
+			}
+
+			threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+			{
+				uint64_t* offsets = &rangeOffsets[rangeIndex * BUCKET_SIZE];
+				std::vector<MortonEntry> buffers(BUCKET_SIZE * WRITE_COMBINING_ENTRIES_COUNT);
+				uint32_t bufferedCounts[BUCKET_SIZE] = {};
+				for (uint64_t i = GetRangeBoundary(count, rangesCount, rangeIndex); i < GetRangeBoundary(count, rangesCount, rangeIndex + 1); i++)
+				{
+					const uint64_t bucket = entries[i].code >> shift & digitMask;
+					MortonEntry* buffer = &buffers[bucket * WRITE_COMBINING_ENTRIES_COUNT];
+					buffer[bufferedCounts[bucket]++] = entries[i];
+					if (bufferedCounts[bucket] == WRITE_COMBINING_ENTRIES_COUNT)
+					{
+						std::memcpy(&sortedEntries[offsets[bucket]], buffer, sizeof(MortonEntry) * WRITE_COMBINING_ENTRIES_COUNT);
+						offsets[bucket] += WRITE_COMBINING_ENTRIES_COUNT;
+						bufferedCounts[bucket] = 0;
+					}
+				}
+				for (uint32_t bucket = 0; bucket < BUCKET_SIZE; bucket++)
+				{
+					std::memcpy(&sortedEntries[offsets[bucket]], &buffers[bucket * WRITE_COMBINING_ENTRIES_COUNT], sizeof(MortonEntry) * bufferedCounts[bucket]);
+				}
+			});
+			entries.swap(sortedEntries);
+		}
+	}
+
+	std::vector<MortonEntry> SortPointsByMorton(std::vector<PackedPoint>& points, const MortonQuantizer& quantizer)
+	{
+		std::vector<MortonEntry> entries = ComputeMortonEntries(points, quantizer);
+		RadixSortMortonEntries(entries, quantizer.GetCodeBits());
+
+		const uint64_t count = points.size();
+		const uint64_t rangesCount = GetRangesCount(count);
+		std::vector<PackedPoint> sortedPoints(count);
+		ThreadManager::Get()->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			for (uint64_t i = GetRangeBoundary(count, rangesCount, rangeIndex); i < GetRangeBoundary(count, rangesCount, rangeIndex + 1); i++)
+			{
+				sortedPoints[i] = points[entries[i].index];
+			}
+		});
+		points.swap(sortedPoints);
+		return entries;
+	}
+}
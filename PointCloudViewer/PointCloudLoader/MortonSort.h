@@ -0,0 +1,83 @@
+#ifndef MORTON_SORT_H
+#define MORTON_SORT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace PointCloudViewer
+{
+	// Quantizes origin-relative positions against the cloud bounds into Morton codes, bits of x, y and z interleaved from bit 0.
+	// Cells are cubic, a flat scan keeps its aspect instead of being stretched across the grid.
+	class MortonQuantizer
+	{
+	public:
+		// 63-bit codes, the most a 64-bit key holds for three axes
+		static constexpr uint32_t MAX_BITS_PER_AXIS = 21;
+
+		MortonQuantizer(const float (&boundsMin)[3], const float (&boundsMax)[3], uint32_t bitsPerAxis = MAX_BITS_PER_AXIS);
+
+		// Bounds of the points themselves, reduced on the thread manager workers
+		[[nodiscard]] static MortonQuantizer FromPoints(const std::vector<PackedPoint>& points, uint32_t bitsPerAxis = MAX_BITS_PER_AXIS);
+
+		[[nodiscard]] uint64_t Encode(const PackedPoint& point) const
+		{
+			const float position[3] = {point.position.x, point.position.y, point.position.z};
+			uint64_t code = 0;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				// NaN and anything out of bounds is clamped to the border cells
+				const float cell = (position[axis] - m_boundsMin[axis]) * m_scale;
+				code |= SpreadBits(cell > 0.0f ? static_cast<uint32_t>(std::min(cell, static_cast<float>(m_maxCell))) : 0) << axis;
+			}
+			return code;
+		}
+
+		[[nodiscard]] const float* GetBoundsMin() const noexcept { return m_boundsMin; }
+		[[nodiscard]] uint32_t GetBitsPerAxis() const noexcept { return m_bitsPerAxis; }
+		[[nodiscard]] uint32_t GetCodeBits() const noexcept { return m_bitsPerAxis * 3; }
+		// Edge of a cell of the finest level
+		[[nodiscard]] float GetCellSize() const noexcept { return m_scale > 0.0f ? 1.0f / m_scale : 0.0f; }
+
+	private:
+		// Spreads the low 21 bits so two zero bits follow each of them
+		static uint64_t SpreadBits(uint64_t value)
+		{
+			value &= 0x1FFFFF;
+			value = (value | value << 32) & 0x1F00000000FFFFull;
+			value = (value | value << 16) & 0x1F0000FF0000FFull;
+			value = (value | value << 8) & 0x100F00F00F00F00Full;
+			value = (value | value << 4) & 0x10C30C30C30C30C3ull;
+			value = (value | value << 2) & 0x1249249249249249ull;
+			return value;
+		}
+
+		float m_boundsMin[3];
+		float m_scale;
+		uint32_t m_bitsPerAxis;
+		uint32_t m_maxCell;
+	};
+
+	struct MortonEntry
+	{
+		uint64_t code;
+		uint32_t index;
+	};
+
+	// Code of every point with its index, in point order
+	[[nodiscard]] std::vector<MortonEntry> ComputeMortonEntries(const std::vector<PackedPoint>& points, const MortonQuantizer& quantizer);
+
+	// Stable LSD radix sort by the low keyBits of the code, RADIX bits per pass.
+	// Every worker histograms and scatters a contiguous range, scatter goes through per-bucket write combining buffers
+	// so a worker writes whole cache lines instead of touching BUCKET_SIZE of them per element.
+	// Passes where every key has the same digit are skipped.
+	void RadixSortMortonEntries(std::vector<MortonEntry>& entries, uint32_t keyBits);
+
+	// Reorders points along the Z-order curve, neighbours in the buffer are neighbours in space.
+	// Returns the sorted entries, entry i has the code of the point now at i and its index before the sort.
+	std::vector<MortonEntry> SortPointsByMorton(std::vector<PackedPoint>& points, const MortonQuantizer& quantizer);
+}
+
+#endif // MORTON_SORT_H
@@ -0,0 +1,558 @@
+#include "PlyLoader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+
+#include "PointPacking.h"
+#include "PointTextLoader.h"
+#include "PointTextParser.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	struct PlyTypeInfo
+	{
+		const char* names[2];
+		uint32_t size;
+		// largest value of integer types, colour and intensity are normalized by it
+		double maxValue;
+	};
+
+	static constexpr PlyTypeInfo PLY_TYPES[] = {
+		{{"char", "int8"}, 1, std::numeric_limits<int8_t>::max()},
+		{{"uchar", "uint8"}, 1, std::numeric_limits<uint8_t>::max()},
+		{{"short", "int16"}, 2, std::numeric_limits<int16_t>::max()},
+		{{"ushort", "uint16"}, 2, std::numeric_limits<uint16_t>::max()},
+		{{"int", "int32"}, 4, std::numeric_limits<int32_t>::max()},
+		{{"uint", "uint32"}, 4, std::numeric_limits<uint32_t>::max()},
+		{{"float", "float32"}, 4, 1.0},
+		{{"double", "float64"}, 8, 1.0},
+	};
+
+	// Layout of a PLY vertex that is byte for byte PackedPoint
+	static const PlyProperty PACKED_POINT_SCHEMA[] = {
+		{"x", PlyType::Float32, 0},
+		{"y", PlyType::Float32, 4},
+		{"z", PlyType::Float32, 8},
+		{"color", PlyType::UInt32, 12},
+		{"intensity", PlyType::UInt32, 16},
+	};
+
+	static_assert(sizeof(PackedPoint) == 20);
+
+	// Origin pre-pass reads this many vertices at evenly spaced places of the body
+	static constexpr uint64_t ORIGIN_SAMPLES_COUNT = 64;
+	static constexpr uint64_t ORIGIN_SAMPLE_VERTICES_COUNT = 256;
+
+	template <typename T>
+	static T ReadValue(const char* data)
+	{
+		T value;
+		std::memcpy(&value, data, sizeof(T));
+		return value;
+	}
+
+	static double ReadPlyValue(const char* data, PlyType type, bool swapBytes)
+	{
+		char bytes[8];
+		const uint32_t size = PLY_TYPES[static_cast<uint32_t>(type)].size;
+		if (swapBytes)
+		{
+			std::reverse_copy(data, data + size, bytes);
+		}
+		else
+		{
+			std::memcpy(bytes, data, size);
+		}
+
+		switch (type)
+		{
+		case PlyType::Int8:
+			return ReadValue<int8_t>(bytes);
+		case PlyType::UInt8:
+			return ReadValue<uint8_t>(bytes);
+		case PlyType::Int16:
+			return ReadValue<int16_t>(bytes);
+		case PlyType::UInt16:
+			return ReadValue<uint16_t>(bytes);
+		case PlyType::Int32:
+			return ReadValue<int32_t>(bytes);
+		case PlyType::UInt32:
+			return ReadValue<uint32_t>(bytes);
+		case PlyType::Float32:
+			return ReadValue<float>(bytes);
+		case PlyType::Float64:
+			return ReadValue<double>(bytes);
+		default:
+			return 0.0;
+		}
+	}
+
+	static bool ParsePlyType(const std::string& name, PlyType& type)
+	{
+		for (uint32_t i = 0; i < std::size(PLY_TYPES); i++)
+		{
+			if (name == PLY_TYPES[i].names[0] || name == PLY_TYPES[i].names[1])
+			{
+				type = static_cast<PlyType>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static std::string ToLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+
+	PlyLoader::PlyLoader(const MappedFile* file, IPointSink* sink) :
+		m_file(file),
+		m_sink(sink)
+	{
+		m_isValid = ReadHeader() && FindVertexElement();
+		if (m_isValid)
+		{
+			m_decodeFunction = SelectDecoder();
+		}
+	}
+
+	bool PlyLoader::ReadHeader()
+	{
+		const char* data = m_file->GetData();
+		const uint64_t fileSize = m_file->GetSize();
+
+		bool hasFormat = false;
+		uint64_t lineBegin = 0;
+		for (uint32_t lineIndex = 0; lineBegin < fileSize; lineIndex++)
+		{
+			const char* lineEnd = static_cast<const char*>(std::memchr(data + lineBegin, '\n', fileSize - lineBegin));
+			if (lineEnd == nullptr)
+			{
+				break;
+			}
+			std::string line(data + lineBegin, lineEnd);
+			lineBegin = lineEnd - data + 1;
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.pop_back();
+			}
+
+			if (lineIndex == 0)
+			{
+				if (line != "ply")
+				{
+					Logger::Log("Not a PLY file\n");
+					return false;
+				}
+				continue;
+			}
+
+			std::istringstream tokens(line);
+			std::string keyword;
+			tokens >> keyword;
+			if (keyword == "format")
+			{
+				std::string format;
+				tokens >> format;
+				if (format == "ascii")
+				{
+					m_format = PlyFormat::Ascii;
+				}
+				else if (format == "binary_little_endian")
+				{
+					m_format = PlyFormat::BinaryLittleEndian;
+				}
+				else if (format == "binary_big_endian")
+				{
+					m_format = PlyFormat::BinaryBigEndian;
+				}
+				else
+				{
+					Logger::LogFormat("Unknown PLY format %s\n", format.c_str());
+					return false;
+				}
+				hasFormat = true;
+			}
+			else if (keyword == "element")
+			{
+				PlyElement element = {};
+				tokens >> element.name >> element.count;
+				if (tokens.fail())
+				{
+					Logger::LogFormat("Corrupted PLY element: %s\n", line.c_str());
+					return false;
+				}
+				m_elements.push_back(std::move(element));
+			}
+			else if (keyword == "property")
+			{
+				std::string typeName;
+				tokens >> typeName;
+				PlyProperty property = {};
+				if (typeName == "list")
+				{
+					std::string countType, itemType;
+					tokens >> countType >> itemType >> property.name;
+					property.type = PlyType::List;
+				}
+				else if (ParsePlyType(typeName, property.type))
+				{
+					tokens >> property.name;
+				}
+				else
+				{
+					Logger::LogFormat("Unknown PLY property type %s\n", typeName.c_str());
+					return false;
+				}
+
+				if (m_elements.empty() || tokens.fail())
+				{
+					Logger::LogFormat("Corrupted PLY property: %s\n", line.c_str());
+					return false;
+				}
+				m_elements.back().properties.push_back(std::move(property));
+			}
+			else if (keyword == "end_header")
+			{
+				if (!hasFormat)
+				{
+					Logger::Log("PLY header has no format\n");
+					return false;
+				}
+				m_bodyOffset = lineBegin;
+
+				for (PlyElement& element : m_elements)
+				{
+					uint32_t offset = 0;
+					for (PlyProperty& property : element.properties)
+					{
+						if (property.type == PlyType::List)
+						{
+							offset = 0;
+							break;
+						}
+						property.offset = offset;
+						offset += PLY_TYPES[static_cast<uint32_t>(property.type)].size;
+					}
+					element.stride = offset;
+				}
+				return true;
+			}
+			// comment, obj_info and unknown keywords are skipped
+		}
+
+		Logger::Log("PLY header has no end\n");
+		return false;
+	}
+
+	bool PlyLoader::FindVertexElement()
+	{
+		const char* data = m_file->GetData();
+		const uint64_t fileSize = m_file->GetSize();
+
+		m_vertexOffset = m_bodyOffset;
+		for (const PlyElement& element : m_elements)
+		{
+			if (element.name == "vertex")
+			{
+				m_vertexElement = &element;
+				break;
+			}
+
+			// elements before vertices are skipped
+			if (m_format == PlyFormat::Ascii)
+			{
+				for (uint64_t i = 0; i < element.count && m_vertexOffset < fileSize; i++)
+				{
+					m_vertexOffset = PointTextParser::FindLineEnd(data + m_vertexOffset, data + fileSize) - data + 1;
+				}
+				m_vertexOffset = std::min(m_vertexOffset, fileSize);
+			}
+			else if (element.stride != 0)
+			{
+				m_vertexOffset += element.count * element.stride;
+			}
+			else
+			{
+				Logger::LogFormat("PLY element %s with lists before vertices isn't supported\n", element.name.c_str());
+				return false;
+			}
+		}
+
+		if (m_vertexElement == nullptr)
+		{
+			Logger::Log("PLY file has no vertices\n");
+			return false;
+		}
+		if (m_vertexElement->stride == 0)
+		{
+			Logger::Log("PLY vertices with list properties aren't supported\n");
+			return false;
+		}
+
+		const auto findAttribute = [this](std::initializer_list<const char*> names, AttributeSource& attribute)
+		{
+			const std::vector<PlyProperty>& properties = m_vertexElement->properties;
+			for (uint32_t propertyIndex = 0; propertyIndex < properties.size(); propertyIndex++)
+			{
+				const std::string name = ToLower(properties[propertyIndex].name);
+				if (std::find_if(names.begin(), names.end(), [&name](const char* candidate) { return name == candidate; }) != names.end())
+				{
+					const PlyType type = properties[propertyIndex].type;
+					attribute = {
+						static_cast<int32_t>(propertyIndex),
+						type,
+						properties[propertyIndex].offset,
+						static_cast<float>(1.0 / PLY_TYPES[static_cast<uint32_t>(type)].maxValue)
+					};
+					return;
+				}
+			}
+		};
+		findAttribute({"x"}, m_position[0]);
+		findAttribute({"y"}, m_position[1]);
+		findAttribute({"z"}, m_position[2]);
+		findAttribute({"red", "r", "diffuse_red"}, m_color[0]);
+		findAttribute({"green", "g", "diffuse_green"}, m_color[1]);
+		findAttribute({"blue", "b", "diffuse_blue"}, m_color[2]);
+		findAttribute({"intensity", "scalar_intensity", "i"}, m_intensity);
+
+		if (m_position[0].propertyIndex < 0 || m_position[1].propertyIndex < 0 || m_position[2].propertyIndex < 0)
+		{
+			Logger::Log("PLY vertices have no position\n");
+			return false;
+		}
+		// a partial colour is as good as none
+		if (m_color[0].propertyIndex < 0 || m_color[1].propertyIndex < 0 || m_color[2].propertyIndex < 0)
+		{
+			m_color[0] = m_color[1] = m_color[2] = {};
+		}
+
+		if (m_format != PlyFormat::Ascii && m_vertexOffset + m_vertexElement->count * m_vertexElement->stride > fileSize)
+		{
+			Logger::Log("PLY file is truncated\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool PlyLoader::IsZeroCopy() const
+	{
+		if (!m_isValid || m_format != PlyFormat::BinaryLittleEndian || m_vertexElement->stride != sizeof(PackedPoint))
+		{
+			return false;
+		}
+		return std::equal(std::begin(PACKED_POINT_SCHEMA), std::end(PACKED_POINT_SCHEMA),
+		                  m_vertexElement->properties.begin(), m_vertexElement->properties.end(),
+		                  [](const PlyProperty& expected, const PlyProperty& property)
+		                  {
+			                  return expected.name == ToLower(property.name) && expected.type == property.type && expected.offset == property.offset;
+		                  });
+	}
+
+	uint64_t PlyLoader::Load()
+	{
+		if (!m_isValid)
+		{
+			m_sink->Begin(0, m_origin);
+			m_sink->End(m_stats);
+			return 0;
+		}
+
+		return m_format == PlyFormat::Ascii ? LoadAscii() : LoadBinary();
+	}
+
+	uint64_t PlyLoader::LoadAscii()
+	{
+		PointTextLoaderSettings settings;
+		settings.valuesPerPoint = static_cast<uint32_t>(m_vertexElement->properties.size());
+		settings.columns = {
+			m_position[0].propertyIndex,
+			m_position[1].propertyIndex,
+			m_position[2].propertyIndex,
+			m_intensity.propertyIndex,
+			m_color[0].propertyIndex,
+			m_color[1].propertyIndex,
+			m_color[2].propertyIndex
+		};
+		settings.colorMax = 1.0 / m_color[0].scale;
+		settings.intensityMin = 0.0;
+		settings.intensityMax = 1.0 / m_intensity.scale;
+		settings.dataOffset = m_vertexOffset;
+		// elements after vertices are parsed as well, but never reach the sink, which holds only in file order
+		settings.maxPointsCount = m_vertexElement->count;
+		settings.isProgressive = false;
+
+		for (const int32_t column : {settings.columns.x, settings.columns.y, settings.columns.z, settings.columns.intensity, settings.columns.red, settings.columns.green, settings.columns.blue})
+		{
+			if (column >= static_cast<int32_t>(PointTextParser::MAX_VALUES_PER_LINE))
+			{
+				Logger::LogFormat("PLY vertex properties past %u aren't supported in ascii files\n", PointTextParser::MAX_VALUES_PER_LINE);
+				m_sink->Begin(0, m_origin);
+				m_sink->End(m_stats);
+				return 0;
+			}
+		}
+
+		PointTextLoader loader(m_file, m_sink, settings);
+		const uint64_t pointsCount = loader.Load();
+		m_origin = loader.GetOrigin();
+		m_stats = loader.GetStats();
+		return pointsCount;
+	}
+
+	uint64_t PlyLoader::LoadBinary()
+	{
+		if (IsZeroCopy())
+		{
+			m_stats = LoadPointRecords(m_file, m_sink, m_origin, m_vertexOffset, sizeof(PackedPoint), m_vertexElement->count,
+			                           [](const char* vertices, uint64_t verticesCount, PointBlockWriter& writer)
+			                           {
+				                           writer.Append(reinterpret_cast<const PackedPoint*>(vertices), verticesCount);
+			                           });
+			return m_stats.pointsCount;
+		}
+
+		ComputeOrigin();
+		m_stats = LoadPointRecords(m_file, m_sink, m_origin, m_vertexOffset, m_vertexElement->stride, m_vertexElement->count,
+		                           [this](const char* vertices, uint64_t verticesCount, PointBlockWriter& writer)
+		                           {
+			                           (this->*m_decodeFunction)(vertices, verticesCount, writer);
+		                           });
+		return m_stats.pointsCount;
+	}
+
+	void PlyLoader::ComputeOrigin()
+	{
+		const uint64_t verticesCount = m_vertexElement->count;
+		const bool swapBytes = m_format == PlyFormat::BinaryBigEndian;
+
+		std::vector<PointSourceBounds> samplesBounds(ORIGIN_SAMPLES_COUNT);
+		ThreadManager::Get()->ParallelFor(ORIGIN_SAMPLES_COUNT, [&](uint64_t sampleIndex, uint32_t)
+		{
+			const uint64_t firstVertex = verticesCount * sampleIndex / ORIGIN_SAMPLES_COUNT;
+			const uint64_t lastVertex = std::min(firstVertex + ORIGIN_SAMPLE_VERTICES_COUNT, verticesCount);
+			for (uint64_t vertexIndex = firstVertex; vertexIndex < lastVertex; vertexIndex++)
+			{
+				const char* vertex = m_file->GetData() + m_vertexOffset + vertexIndex * m_vertexElement->stride;
+				samplesBounds[sampleIndex].Add(ReadPlyValue(vertex + m_position[0].offset, m_position[0].type, swapBytes),
+				                               ReadPlyValue(vertex + m_position[1].offset, m_position[1].type, swapBytes),
+				                               ReadPlyValue(vertex + m_position[2].offset, m_position[2].type, swapBytes));
+			}
+		});
+
+		PointSourceBounds bounds;
+		for (const PointSourceBounds& sampleBounds : samplesBounds)
+		{
+			bounds.Add(sampleBounds);
+		}
+		m_origin = bounds.GetCenter();
+	}
+
+	PlyLoader::DecodeFunction PlyLoader::SelectDecoder() const
+	{
+		const PlyType positionType = m_position[0].type;
+		const bool hasColor = m_color[0].propertyIndex >= 0;
+		const PlyType colorType = m_color[0].type;
+		if (m_format != PlyFormat::BinaryLittleEndian ||
+			m_position[1].type != positionType || m_position[2].type != positionType ||
+			(hasColor && (m_color[1].type != colorType || m_color[2].type != colorType)))
+		{
+			return &PlyLoader::DecodeVertices;
+		}
+
+		const auto selectColor = [hasColor, colorType]<typename POSITION_TYPE>() -> DecodeFunction
+		{
+			if (!hasColor)
+			{
+				return &PlyLoader::DecodeVerticesTyped<POSITION_TYPE, void>;
+			}
+			switch (colorType)
+			{
+			case PlyType::UInt8:
+				return &PlyLoader::DecodeVerticesTyped<POSITION_TYPE, uint8_t>;
+			case PlyType::UInt16:
+				return &PlyLoader::DecodeVerticesTyped<POSITION_TYPE, uint16_t>;
+			case PlyType::Float32:
+				return &PlyLoader::DecodeVerticesTyped<POSITION_TYPE, float>;
+			default:
+				return &PlyLoader::DecodeVertices;
+			}
+		};
+
+		switch (positionType)
+		{
+		case PlyType::Float32:
+			return selectColor.operator()<float>();
+		case PlyType::Float64:
+			return selectColor.operator()<double>();
+		default:
+			return &PlyLoader::DecodeVertices;
+		}
+	}
+
+	void PlyLoader::DecodeVertices(const char* vertex, uint64_t verticesCount, PointBlockWriter& writer) const
+	{
+		const bool swapBytes = m_format == PlyFormat::BinaryBigEndian;
+		const auto readAttribute = [&vertex, swapBytes](const AttributeSource& attribute)
+		{
+			return ReadPlyValue(vertex + attribute.offset, attribute.type, swapBytes);
+		};
+
+		for (uint64_t i = 0; i < verticesCount; i++, vertex += m_vertexElement->stride)
+		{
+			float color[3] = {1.0f, 1.0f, 1.0f};
+			if (m_color[0].propertyIndex >= 0)
+			{
+				for (uint32_t channel = 0; channel < 3; channel++)
+				{
+					color[channel] = static_cast<float>(readAttribute(m_color[channel])) * m_color[channel].scale;
+				}
+			}
+			const float intensity = m_intensity.propertyIndex >= 0 ? static_cast<float>(readAttribute(m_intensity)) * m_intensity.scale : 0.0f;
+
+			writer.Append(PackPoint(static_cast<float>(readAttribute(m_position[0]) - m_origin.x),
+			                        static_cast<float>(readAttribute(m_position[1]) - m_origin.y),
+			                        static_cast<float>(readAttribute(m_position[2]) - m_origin.z),
+			                        color[0], color[1], color[2], intensity));
+		}
+	}
+
+	template <typename POSITION_TYPE, typename COLOR_TYPE>
+	void PlyLoader::DecodeVerticesTyped(const char* vertex, uint64_t verticesCount, PointBlockWriter& writer) const
+	{
+		const uint32_t stride = m_vertexElement->stride;
+		const uint32_t positionOffsets[3] = {m_position[0].offset, m_position[1].offset, m_position[2].offset};
+		const uint32_t colorOffsets[3] = {m_color[0].offset, m_color[1].offset, m_color[2].offset};
+		const float colorScale = m_color[0].scale;
+
+		for (uint64_t i = 0; i < verticesCount; i++, vertex += stride)
+		{
+			float color[3] = {1.0f, 1.0f, 1.0f};
+			if constexpr (!std::is_void_v<COLOR_TYPE>)
+			{
+				for (uint32_t channel = 0; channel < 3; channel++)
+				{
+					color[channel] = static_cast<float>(ReadValue<COLOR_TYPE>(vertex + colorOffsets[channel])) * colorScale;
+				}
+			}
+			// intensity types vary too much between writers to be worth specializing
+			const float intensity = m_intensity.propertyIndex >= 0
+				                        ? static_cast<float>(ReadPlyValue(vertex + m_intensity.offset, m_intensity.type, false)) * m_intensity.scale
+				                        : 0.0f;
+
+			writer.Append(PackPoint(static_cast<float>(static_cast<double>(ReadValue<POSITION_TYPE>(vertex + positionOffsets[0])) - m_origin.x),
+			                        static_cast<float>(static_cast<double>(ReadValue<POSITION_TYPE>(vertex + positionOffsets[1])) - m_origin.y),
+			                        static_cast<float>(static_cast<double>(ReadValue<POSITION_TYPE>(vertex + positionOffsets[2])) - m_origin.z),
+			                        color[0], color[1], color[2], intensity));
+		}
+	}
+}
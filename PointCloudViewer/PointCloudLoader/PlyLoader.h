@@ -0,0 +1,121 @@
+#ifndef PLY_LOADER_H
+#define PLY_LOADER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PointLoader.h"
+#include "PointSink.h"
+#include "DataManager/MappedFile.h"
+
+namespace PointCloudViewer
+{
+	enum class PlyFormat
+	{
+		Ascii,
+		BinaryLittleEndian,
+		BinaryBigEndian
+	};
+
+	enum class PlyType : uint8_t
+	{
+		Int8,
+		UInt8,
+		Int16,
+		UInt16,
+		Int32,
+		UInt32,
+		Float32,
+		Float64,
+		// list properties have a variable size and can't be read with a fixed stride
+		List
+	};
+
+	struct PlyProperty
+	{
+		std::string name;
+		PlyType type;
+		uint32_t offset;
+	};
+
+	struct PlyElement
+	{
+		std::string name;
+		uint64_t count;
+		std::vector<PlyProperty> properties;
+		// 0 when the element has list properties
+		uint32_t stride;
+	};
+
+	// Reader of ascii and binary PLY, only the vertex element is loaded.
+	// Ascii bodies go through PointTextLoader with the columns taken from the header.
+	// Binary bodies are decoded in parallel with a decoder picked by the property types,
+	// a body laid out exactly as PackedPoint (float x, y, z, uint color as RGB10A2, uint intensity as unorm16)
+	// is copied from the mapping without decoding and keeps a zero origin.
+	class PlyLoader : public IPointLoader
+	{
+	public:
+		PlyLoader(const MappedFile* file, IPointSink* sink);
+
+		// Invalid files are reported on construction and load zero points
+		[[nodiscard]] bool IsValid() const noexcept { return m_isValid; }
+		[[nodiscard]] PlyFormat GetFormat() const noexcept { return m_format; }
+		[[nodiscard]] const std::vector<PlyElement>& GetElements() const noexcept { return m_elements; }
+		[[nodiscard]] bool IsZeroCopy() const;
+
+		uint64_t Load() override;
+		[[nodiscard]] PointOrigin GetOrigin() const override { return m_origin; }
+		[[nodiscard]] const PointCloudStats& GetStats() const override { return m_stats; }
+
+	private:
+		// Where a point attribute lives in a vertex, property index is -1 when vertices don't have it
+		struct AttributeSource
+		{
+			int32_t propertyIndex = -1;
+			PlyType type = PlyType::Float32;
+			uint32_t offset = 0;
+			// maps the stored value to [0, 1] for colour and intensity
+			float scale = 1.0f;
+		};
+
+		using DecodeFunction = void (PlyLoader::*)(const char* vertices, uint64_t verticesCount, PointBlockWriter& writer) const;
+
+		bool ReadHeader();
+		bool FindVertexElement();
+		[[nodiscard]] DecodeFunction SelectDecoder() const;
+
+		uint64_t LoadAscii();
+		uint64_t LoadBinary();
+		// Center of the bounds of vertices sampled across the body
+		void ComputeOrigin();
+
+		// Any types and byte order, every value goes through a switch on its type
+		void DecodeVertices(const char* vertices, uint64_t verticesCount, PointBlockWriter& writer) const;
+		// Little endian with position and colour types known at compile time, COLOR_TYPE is void when there is no colour
+		template <typename POSITION_TYPE, typename COLOR_TYPE>
+		void DecodeVerticesTyped(const char* vertices, uint64_t verticesCount, PointBlockWriter& writer) const;
+
+		const MappedFile* m_file;
+		IPointSink* m_sink;
+
+		PlyFormat m_format = PlyFormat::Ascii;
+		std::vector<PlyElement> m_elements;
+		uint64_t m_bodyOffset = 0;
+
+		const PlyElement* m_vertexElement = nullptr;
+		// byte offset of the first vertex, for ascii bodies the offset of its line
+		uint64_t m_vertexOffset = 0;
+		AttributeSource m_position[3];
+		AttributeSource m_color[3];
+		AttributeSource m_intensity;
+		DecodeFunction m_decodeFunction = &PlyLoader::DecodeVertices;
+		PointOrigin m_origin;
+		PointCloudStats m_stats;
+
+		bool m_isValid = false;
+	};
+}
+
+#endif // PLY_LOADER_H
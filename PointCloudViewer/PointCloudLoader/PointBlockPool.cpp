@@ -0,0 +1,63 @@
+#include "PointBlockPool.h"
+
+namespace PointCloudViewer
+{
+	PointBlockPool::PointBlockPool(PointBlockMemory memory, uint32_t pointsPerBlock) :
+		m_memory(memory),
+		m_pointsPerBlock(pointsPerBlock)
+	{
+	}
+
+	PointBlock* PointBlockPool::Acquire()
+	{
+		std::lock_guard lock(m_mutex);
+		if (!m_freeBlocks.empty())
+		{
+			PointBlock* block = m_freeBlocks.back();
+			m_freeBlocks.pop_back();
+			return block;
+		}
+
+		// allocation stays under the lock, device heap allocators aren't thread-safe
+		std::unique_ptr<BlockStorage> storage = std::make_unique<BlockStorage>();
+		if (m_memory == PointBlockMemory::Upload)
+		{
+			storage->uploadBuffer = std::make_unique<Buffer>(
+				m_pointsPerBlock * sizeof(PackedPoint),
+				D3D12_RESOURCE_STATE_GENERIC_READ,
+				D3D12_HEAP_TYPE_UPLOAD);
+			// upload heaps can stay mapped for the whole lifetime of the resource
+			storage->uploadMapping = storage->uploadBuffer->Map();
+			storage->block.points = static_cast<PackedPoint*>(storage->uploadMapping.GetPtr());
+			storage->block.buffer = storage->uploadBuffer.get();
+		}
+		else
+		{
+			storage->systemMemory = std::make_unique<PackedPoint[]>(m_pointsPerBlock);
+			storage->block.points = storage->systemMemory.get();
+		}
+
+		PointBlock* block = &storage->block;
+		m_storage.push_back(std::move(storage));
+		return block;
+	}
+
+	void PointBlockPool::Release(PointBlock* block)
+	{
+		std::lock_guard lock(m_mutex);
+		while (block != nullptr)
+		{
+			PointBlock* next = block->next;
+			block->count = 0;
+			block->next = nullptr;
+			m_freeBlocks.push_back(block);
+			block = next;
+		}
+	}
+
+	uint64_t PointBlockPool::GetAllocatedBlocksCount() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_storage.size();
+	}
+}
@@ -0,0 +1,133 @@
+#ifndef POINT_BLOCK_POOL_H
+#define POINT_BLOCK_POOL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+#include "PointCloudStats.h"
+#include "ResourceManager/Buffers/Buffer.h"
+
+namespace PointCloudViewer
+{
+	enum class PointBlockMemory
+	{
+		// blocks live in upload heap buffers and are copied to the GPU as they are
+		Upload,
+		// plain system memory, for consumers that never touch the GPU
+		System
+	};
+
+	// Fixed-size piece of parser output. Blocks of one chunk are chained in file order.
+	struct PointBlock
+	{
+		PackedPoint* points = nullptr;
+		uint32_t count = 0;
+		PointBlock* next = nullptr;
+
+		// upload buffer holding the points, nullptr for system memory blocks
+		const Buffer* buffer = nullptr;
+	};
+
+	// Thread-safe pool of recyclable point blocks, new blocks are allocated only when all existing ones are in use.
+	// Upload heap is never freed, so the pool keeps every block it ever allocated.
+	class PointBlockPool
+	{
+	public:
+		static constexpr uint32_t DEFAULT_POINTS_PER_BLOCK = 64 * 1024;
+
+		explicit PointBlockPool(PointBlockMemory memory, uint32_t pointsPerBlock = DEFAULT_POINTS_PER_BLOCK);
+
+		[[nodiscard]] PointBlock* Acquire();
+		// Returns the whole chain starting at block to the pool
+		void Release(PointBlock* block);
+
+		[[nodiscard]] uint32_t GetPointsPerBlock() const noexcept { return m_pointsPerBlock; }
+		[[nodiscard]] uint64_t GetAllocatedBlocksCount() const;
+
+	private:
+		struct BlockStorage
+		{
+			PointBlock block;
+			std::unique_ptr<Buffer> uploadBuffer;
+			MappedAreaHandle uploadMapping;
+			std::unique_ptr<PackedPoint[]> systemMemory;
+		};
+
+		const PointBlockMemory m_memory;
+		const uint32_t m_pointsPerBlock;
+
+		mutable std::mutex m_mutex;
+		std::vector<std::unique_ptr<BlockStorage>> m_storage;
+		std::vector<PointBlock*> m_freeBlocks;
+	};
+
+	// Appends points to a chain of blocks drawn from a pool.
+	// Points are added to the stats accumulator on the way in, blocks may be write-combined memory that is never read back.
+	class PointBlockWriter
+	{
+	public:
+		explicit PointBlockWriter(PointBlockPool* pool, PointStatsAccumulator* stats = nullptr) :
+			m_pool(pool),
+			m_stats(stats)
+		{
+		}
+
+		void Append(const PackedPoint& point)
+		{
+			if (m_stats != nullptr)
+			{
+				m_stats->Add(point);
+			}
+			ReserveTail();
+			m_pointsCount++;
+			m_tail->points[m_tail->count++] = point;
+		}
+
+		// Bulk copy, fills the tail block up and chains new ones as needed
+		void Append(const PackedPoint* points, uint64_t count)
+		{
+			if (m_stats != nullptr)
+			{
+				m_stats->Add(points, count);
+			}
+			while (count != 0)
+			{
+				ReserveTail();
+				const uint32_t copyCount = static_cast<uint32_t>(std::min<uint64_t>(count, m_pool->GetPointsPerBlock() - m_tail->count));
+				std::memcpy(m_tail->points + m_tail->count, points, copyCount * sizeof(PackedPoint));
+				m_tail->count += copyCount;
+				m_pointsCount += copyCount;
+				points += copyCount;
+				count -= copyCount;
+			}
+		}
+
+		[[nodiscard]] PointBlock* GetHead() const noexcept { return m_head; }
+		[[nodiscard]] uint64_t GetPointsCount() const noexcept { return m_pointsCount; }
+
+	private:
+		// Chains a new block when the tail is full
+		void ReserveTail()
+		{
+			if (m_tail == nullptr || m_tail->count == m_pool->GetPointsPerBlock())
+			{
+				PointBlock* block = m_pool->Acquire();
+				(m_tail != nullptr ? m_tail->next : m_head) = block;
+				m_tail = block;
+			}
+		}
+
+		PointBlockPool* m_pool;
+		PointStatsAccumulator* m_stats;
+		PointBlock* m_head = nullptr;
+		PointBlock* m_tail = nullptr;
+		uint64_t m_pointsCount = 0;
+	};
+}
+
+#endif // POINT_BLOCK_POOL_H
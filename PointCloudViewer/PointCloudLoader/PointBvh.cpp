@@ -0,0 +1,273 @@
+#include "PointBvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <utility>
+
+#include "MortonSort.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Assert.h"
+#include "Utils/TimeCounter.h"
+
+namespace PointCloudViewer
+{
+	// Work is split into a few ranges per worker so stealing evens out uneven ranges
+	static constexpr uint32_t BVH_RANGES_PER_WORKER = 4;
+	// Ranges shorter than this aren't worth a task
+	static constexpr uint64_t BVH_MIN_RANGE_SIZE = 4 * 1024;
+	// Parent of the root
+	static constexpr uint32_t NO_PARENT = MAX_UINT;
+
+	static uint64_t GetRangesCount(uint64_t count)
+	{
+		return std::clamp<uint64_t>(count / BVH_MIN_RANGE_SIZE, 1, ThreadManager::Get()->GetWorkersCount() * BVH_RANGES_PER_WORKER);
+	}
+
+	static uint64_t GetRangeBoundary(uint64_t count, uint64_t rangesCount, uint64_t rangeIndex)
+	{
+		return count * rangeIndex / rangesCount;
+	}
+
+	// Length of the common prefix of two leaf keys, -1 outside of the leaves.
+	// Equal keys fall back to the prefix of the indices, so every key is distinct and the tree stays binary.
+	static int32_t GetCommonPrefix(const std::vector<uint64_t>& keys, int64_t i, int64_t j)
+	{
+		if (j < 0 || j >= static_cast<int64_t>(keys.size()))
+		{
+			return -1;
+		}
+		if (keys[i] == keys[j])
+		{
+			return 64 + std::countl_zero(static_cast<uint32_t>(i ^ j));
+		}
+		return std::countl_zero(keys[i] ^ keys[j]);
+	}
+
+	static AABB GetEmptyBounds()
+	{
+		AABB bounds = {};
+		bounds.min = VEC3(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+		bounds.max = VEC3(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+		return bounds;
+	}
+
+	static AABB MergeBounds(const AABB& a, const AABB& b)
+	{
+		AABB bounds = {};
+		bounds.min = VEC3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z));
+		bounds.max = VEC3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z));
+		return bounds;
+	}
+
+	// Children of internal node i, the node covers the leaves from i to j and splits them where their common prefix changes
+	static InternalNode CreateInternalNode(const std::vector<uint64_t>& keys, int64_t i)
+	{
+		// the node extends towards the neighbour with the longer common prefix
+		const int64_t direction = GetCommonPrefix(keys, i, i + 1) > GetCommonPrefix(keys, i, i - 1) ? 1 : -1;
+		const int32_t minPrefix = GetCommonPrefix(keys, i, i - direction);
+
+		int64_t maxLength = 2;
+		while (GetCommonPrefix(keys, i, i + maxLength * direction) > minPrefix)
+		{
+			maxLength *= 2;
+		}
+		int64_t length = 0;
+		for (int64_t step = maxLength / 2; step >= 1; step /= 2)
+		{
+			if (GetCommonPrefix(keys, i, i + (length + step) * direction) > minPrefix)
+			{
+				length += step;
+			}
+		}
+		const int64_t j = i + length * direction;
+
+		// last leaf that shares more than the node prefix with leaf i
+		const int32_t nodePrefix = GetCommonPrefix(keys, i, j);
+		int64_t split = 0;
+		for (int64_t step = length; step > 1;)
+		{
+			step = (step + 1) / 2;
+			if (GetCommonPrefix(keys, i, i + (split + step) * direction) > nodePrefix)
+			{
+				split += step;
+			}
+		}
+		const int64_t gamma = i + split * direction + std::min<int64_t>(direction, 0);
+
+		InternalNode node = {};
+		node.leftNode = static_cast<uint32_t>(gamma);
+		node.leftNodeType = std::min(i, j) == gamma ? LEAF_NODE : INTERNAL_NODE;
+		node.rightNode = static_cast<uint32_t>(gamma + 1);
+		node.rightNodeType = std::max(i, j) == gamma + 1 ? LEAF_NODE : INTERNAL_NODE;
+		node.parent = NO_PARENT;
+		node.index = static_cast<uint32_t>(i);
+		return node;
+	}
+
+	PointBvh PointBvh::Build(std::vector<PackedPoint>& points, uint32_t leafPointsCount)
+	{
+		ASSERT(leafPointsCount != 0);
+		TIME_PERF("Building point BVH");
+
+		PointBvh bvh;
+		bvh.m_leafPointsCount = leafPointsCount;
+		bvh.m_pointsCount = points.size();
+		if (points.empty())
+		{
+			return bvh;
+		}
+
+		ThreadManager* threadManager = ThreadManager::Get();
+
+		std::vector<MortonEntry> entries;
+		{
+			TIME_PERF("BVH Morton sort");
+			entries = SortPointsByMorton(points, MortonQuantizer::FromPoints(points));
+		}
+
+		const uint64_t leavesCount = (points.size() + leafPointsCount - 1) / leafPointsCount;
+		ASSERT(leavesCount <= std::numeric_limits<uint32_t>::max());
+
+		// a leaf is keyed by its first point, keys are sorted as the points are
+		std::vector<uint64_t> keys(leavesCount);
+		for (uint64_t leafIndex = 0; leafIndex < leavesCount; leafIndex++)
+		{
+			keys[leafIndex] = entries[leafIndex * leafPointsCount].code;
+		}
+
+		{
+			TIME_PERF("BVH leaf order");
+			// entries hold the input index of every sorted point, sorting a leaf by them restores the input order inside it
+			const uint64_t rangesCount = GetRangesCount(leavesCount);
+			threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+			{
+				std::vector<std::pair<uint32_t, PackedPoint>> leafPoints;
+				for (uint64_t leafIndex = GetRangeBoundary(leavesCount, rangesCount, rangeIndex); leafIndex < GetRangeBoundary(leavesCount, rangesCount, rangeIndex + 1); leafIndex++)
+				{
+					const uint64_t pointsBegin = leafIndex * leafPointsCount;
+					const uint64_t pointsEnd = std::min<uint64_t>(pointsBegin + leafPointsCount, points.size());
+					leafPoints.clear();
+					for (uint64_t i = pointsBegin; i < pointsEnd; i++)
+					{
+						leafPoints.emplace_back(entries[i].index, points[i]);
+					}
+					std::sort(leafPoints.begin(), leafPoints.end(), [](const auto& a, const auto& b)
+					{
+						return a.first < b.first;
+					});
+					for (uint64_t i = pointsBegin; i < pointsEnd; i++)
+					{
+						points[i] = leafPoints[i - pointsBegin].second;
+					}
+				}
+			});
+		}
+		entries = {};
+
+		bvh.m_leafNodes.resize(leavesCount);
+		bvh.m_leafBounds.resize(leavesCount);
+		bvh.m_internalNodes.resize(leavesCount - 1);
+		bvh.m_internalBounds.resize(leavesCount - 1);
+
+		{
+			TIME_PERF("BVH hierarchy");
+			const uint64_t internalCount = leavesCount - 1;
+			const uint64_t rangesCount = GetRangesCount(internalCount);
+			threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+			{
+				for (uint64_t i = GetRangeBoundary(internalCount, rangesCount, rangeIndex); i < GetRangeBoundary(internalCount, rangesCount, rangeIndex + 1); i++)
+				{
+					bvh.m_internalNodes[i] = CreateInternalNode(keys, static_cast<int64_t>(i));
+				}
+			});
+
+			// every node has exactly one parent, so these writes never collide
+			threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+			{
+				for (uint64_t i = GetRangeBoundary(internalCount, rangesCount, rangeIndex); i < GetRangeBoundary(internalCount, rangesCount, rangeIndex + 1); i++)
+				{
+					const InternalNode& node = bvh.m_internalNodes[i];
+					(node.leftNodeType == LEAF_NODE ? bvh.m_leafNodes[node.leftNode].parent : bvh.m_internalNodes[node.leftNode].parent) = static_cast<uint32_t>(i);
+					(node.rightNodeType == LEAF_NODE ? bvh.m_leafNodes[node.rightNode].parent : bvh.m_internalNodes[node.rightNode].parent) = static_cast<uint32_t>(i);
+				}
+			});
+		}
+
+		{
+			TIME_PERF("BVH bounds");
+			if (leavesCount == 1)
+			{
+				bvh.m_leafNodes[0].parent = NO_PARENT;
+			}
+
+			// The second child to arrive at a node merges both bounds and goes on to the parent, the first one stops there.
+			// The counter is acquire-release, so the first child's bounds are visible to the second.
+			std::vector<std::atomic<uint32_t>> arrivals(leavesCount - 1);
+			const uint64_t rangesCount = GetRangesCount(leavesCount);
+			threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+			{
+				for (uint64_t leafIndex = GetRangeBoundary(leavesCount, rangesCount, rangeIndex); leafIndex < GetRangeBoundary(leavesCount, rangesCount, rangeIndex + 1); leafIndex++)
+				{
+					AABB bounds = GetEmptyBounds();
+					const uint64_t pointsEnd = std::min<uint64_t>((leafIndex + 1) * leafPointsCount, points.size());
+					for (uint64_t pointIndex = leafIndex * leafPointsCount; pointIndex < pointsEnd; pointIndex++)
+					{
+						const auto& position = points[pointIndex].position;
+						bounds.min = VEC3(std::min(bounds.min.x, position.x), std::min(bounds.min.y, position.y), std::min(bounds.min.z, position.z));
+						bounds.max = VEC3(std::max(bounds.max.x, position.x), std::max(bounds.max.y, position.y), std::max(bounds.max.z, position.z));
+					}
+					bvh.m_leafBounds[leafIndex] = bounds;
+					bvh.m_leafNodes[leafIndex].index = static_cast<uint32_t>(leafIndex);
+
+					for (uint32_t parent = bvh.m_leafNodes[leafIndex].parent; parent != NO_PARENT; parent = bvh.m_internalNodes[parent].parent)
+					{
+						if (arrivals[parent].fetch_add(1, std::memory_order_acq_rel) == 0)
+						{
+							break;
+						}
+						const InternalNode& node = bvh.m_internalNodes[parent];
+						const AABB& leftBounds = node.leftNodeType == LEAF_NODE ? bvh.m_leafBounds[node.leftNode] : bvh.m_internalBounds[node.leftNode];
+						const AABB& rightBounds = node.rightNodeType == LEAF_NODE ? bvh.m_leafBounds[node.rightNode] : bvh.m_internalBounds[node.rightNode];
+						bvh.m_internalBounds[parent] = MergeBounds(leftBounds, rightBounds);
+					}
+				}
+			});
+		}
+
+		Logger::LogFormat("Point BVH: %llu points, %llu leaves of up to %u points\n", bvh.m_pointsCount, leavesCount, leafPointsCount);
+		return bvh;
+	}
+
+	void PointBvh::GetSubtreeLeaves(uint32_t internalIndex, uint32_t& firstLeaf, uint32_t& lastLeaf) const
+	{
+		const InternalNode* node = &m_internalNodes[internalIndex];
+		while (node->leftNodeType != LEAF_NODE)
+		{
+			node = &m_internalNodes[node->leftNode];
+		}
+		firstLeaf = node->leftNode;
+
+		node = &m_internalNodes[internalIndex];
+		while (node->rightNodeType != LEAF_NODE)
+		{
+			node = &m_internalNodes[node->rightNode];
+		}
+		lastLeaf = node->rightNode;
+	}
+
+	void PointBvh::QueryBox(const float (&boxMin)[3], const float (&boxMax)[3], std::vector<uint32_t>& leaves) const
+	{
+		Traverse([&](const AABB& bounds)
+		         {
+			         return bounds.min.x <= boxMax[0] && bounds.max.x >= boxMin[0] &&
+				         bounds.min.y <= boxMax[1] && bounds.max.y >= boxMin[1] &&
+				         bounds.min.z <= boxMax[2] && bounds.max.z >= boxMin[2];
+		         },
+		         [&](uint32_t leafIndex)
+		         {
+			         leaves.push_back(leafIndex);
+		         });
+	}
+}
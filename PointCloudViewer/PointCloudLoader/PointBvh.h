@@ -0,0 +1,104 @@
+#ifndef POINT_BVH_H
+#define POINT_BVH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace PointCloudViewer
+{
+	// Linear BVH over clusters of Morton-sorted points, built after Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees".
+	// Leaves are runs of up to leafPointsCount consecutive points, so leaf i covers points [i * leafPointsCount, (i + 1) * leafPointsCount).
+	// Points inside a leaf keep their input order, leaves of a shuffled cloud have prefixes that are subsamples of the leaf.
+	// Every subtree covers a run of consecutive leaves and so a single range of points.
+	// Nodes and bounds are kept in the InternalNode, LeafNode and AABB layout of the shaders, each array is uploaded as it is.
+	// With more than one leaf the root is internal node 0, otherwise it is leaf 0.
+	class PointBvh
+	{
+	public:
+		static constexpr uint32_t DEFAULT_LEAF_POINTS_COUNT = 256;
+
+		PointBvh() = default;
+
+		// Sorts the points along the Morton curve in place and builds the hierarchy over them
+		[[nodiscard]] static PointBvh Build(std::vector<PackedPoint>& points, uint32_t leafPointsCount = DEFAULT_LEAF_POINTS_COUNT);
+
+		[[nodiscard]] bool IsEmpty() const noexcept { return m_leafNodes.empty(); }
+		[[nodiscard]] uint32_t GetRootType() const noexcept { return m_internalNodes.empty() ? LEAF_NODE : INTERNAL_NODE; }
+
+		[[nodiscard]] const std::vector<InternalNode>& GetInternalNodes() const noexcept { return m_internalNodes; }
+		[[nodiscard]] const std::vector<AABB>& GetInternalBounds() const noexcept { return m_internalBounds; }
+		[[nodiscard]] const std::vector<LeafNode>& GetLeafNodes() const noexcept { return m_leafNodes; }
+		[[nodiscard]] const std::vector<AABB>& GetLeafBounds() const noexcept { return m_leafBounds; }
+
+		[[nodiscard]] uint32_t GetLeafPointsCount() const noexcept { return m_leafPointsCount; }
+		[[nodiscard]] uint64_t GetPointsCount() const noexcept { return m_pointsCount; }
+		[[nodiscard]] uint64_t GetLeafPointsOffset(uint32_t leafIndex) const noexcept { return static_cast<uint64_t>(leafIndex) * m_leafPointsCount; }
+		[[nodiscard]] uint32_t GetLeafPointsCount(uint32_t leafIndex) const noexcept
+		{
+			return static_cast<uint32_t>(std::min<uint64_t>(m_leafPointsCount, m_pointsCount - GetLeafPointsOffset(leafIndex)));
+		}
+
+		// First and last leaf of the subtree of an internal node
+		void GetSubtreeLeaves(uint32_t internalIndex, uint32_t& firstLeaf, uint32_t& lastLeaf) const;
+
+		// Depth-first walk, nodeTest(const AABB&) decides whether to descend, visitLeaf(leafIndex) gets every leaf that passed
+		template <typename NodeTest, typename LeafVisitor>
+		void Traverse(const NodeTest& nodeTest, const LeafVisitor& visitLeaf) const
+		{
+			if (IsEmpty())
+			{
+				return;
+			}
+			if (GetRootType() == LEAF_NODE)
+			{
+				if (nodeTest(m_leafBounds[0]))
+				{
+					visitLeaf(0u);
+				}
+				return;
+			}
+
+			// the tree is at most as deep as the number of key bits plus the bits of the tie-break index
+			uint32_t stack[128];
+			uint32_t stackSize = 0;
+			if (nodeTest(m_internalBounds[0]))
+			{
+				stack[stackSize++] = 0;
+			}
+			while (stackSize != 0)
+			{
+				const InternalNode& node = m_internalNodes[stack[--stackSize]];
+				const uint32_t children[2][2] = {{node.rightNode, node.rightNodeType}, {node.leftNode, node.leftNodeType}};
+				for (const auto& [child, childType] : children)
+				{
+					if (childType == LEAF_NODE)
+					{
+						if (nodeTest(m_leafBounds[child]))
+						{
+							visitLeaf(child);
+						}
+					}
+					else if (nodeTest(m_internalBounds[child]))
+					{
+						stack[stackSize++] = child;
+					}
+				}
+			}
+		}
+
+		// Leaves whose bounds overlap the box
+		void QueryBox(const float (&boxMin)[3], const float (&boxMax)[3], std::vector<uint32_t>& leaves) const;
+
+	private:
+		std::vector<InternalNode> m_internalNodes;
+		std::vector<AABB> m_internalBounds;
+		std::vector<LeafNode> m_leafNodes;
+		std::vector<AABB> m_leafBounds;
+		uint32_t m_leafPointsCount = DEFAULT_LEAF_POINTS_COUNT;
+		uint64_t m_pointsCount = 0;
+	};
+}
+
+#endif // POINT_BVH_H
@@ -0,0 +1,51 @@
+#include "PointBvhBenchmark.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "PointBvh.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	// Points of a range come from a generator of their own, so generation runs on all workers and is reproducible
+	static constexpr uint64_t BENCHMARK_RANGE_SIZE = 1024 * 1024;
+
+	std::vector<PackedPoint> GenerateBenchmarkScan(uint64_t pointsCount)
+	{
+		std::vector<PackedPoint> points(pointsCount);
+		const uint64_t rangesCount = (pointsCount + BENCHMARK_RANGE_SIZE - 1) / BENCHMARK_RANGE_SIZE;
+		ThreadManager::Get()->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			std::mt19937 generator(static_cast<uint32_t>(rangeIndex));
+			std::uniform_real_distribution<float> surface(0.0f, 100.0f);
+			std::normal_distribution<float> noise(0.0f, 0.02f);
+			for (uint64_t i = rangeIndex * BENCHMARK_RANGE_SIZE; i < std::min(pointsCount, (rangeIndex + 1) * BENCHMARK_RANGE_SIZE); i++)
+			{
+				float position[3] = {surface(generator), surface(generator), surface(generator)};
+				// one of the five surfaces: the floor and four walls
+				const uint32_t plane = generator() % 5;
+				const uint32_t axis = plane == 0 ? 2 : plane / 3;
+				position[axis] = (plane == 0 || plane % 2 == 1 ? 0.0f : 100.0f) + noise(generator);
+				points[i].position = VEC3(position[0], position[1], position[2]);
+			}
+		});
+		return points;
+	}
+
+	void RunPointBvhBenchmark(uint64_t pointsCount)
+	{
+		Logger::LogFormat("Point BVH benchmark: generating %llu points\n", pointsCount);
+		std::vector<PackedPoint> points = GenerateBenchmarkScan(pointsCount);
+
+		const auto startTime = std::chrono::steady_clock::now();
+		const PointBvh bvh = PointBvh::Build(points);
+		const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		const uint64_t nodesSize = bvh.GetInternalNodes().size() * (sizeof(InternalNode) + sizeof(AABB)) + bvh.GetLeafNodes().size() * (sizeof(LeafNode) + sizeof(AABB));
+		Logger::LogFormat("Point BVH benchmark: %llu points in %.3f s, %.1f M points/s, %llu leaves, %.1f MB of nodes\n",
+		                  pointsCount, time, static_cast<double>(pointsCount) / time / 1e6, static_cast<uint64_t>(bvh.GetLeafNodes().size()), static_cast<double>(nodesSize) / 1e6);
+	}
+}
@@ -0,0 +1,20 @@
+#ifndef POINT_BVH_BENCHMARK_H
+#define POINT_BVH_BENCHMARK_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace PointCloudViewer
+{
+	// Walls and a floor of a 100m room with a few centimeters of noise, surfaces like a scan has rather than a uniform volume.
+	// Generated on the thread manager workers, the same points for the same count.
+	[[nodiscard]] std::vector<PackedPoint> GenerateBenchmarkScan(uint64_t pointsCount);
+
+	// Builds a PointBvh over a synthetic scan of pointsCount points and logs the build time and throughput.
+	// 100M points take about 7GB at the peak: the points, their sorted copy and two arrays of Morton entries.
+	void RunPointBvhBenchmark(uint64_t pointsCount = 100'000'000);
+}
+
+#endif // POINT_BVH_BENCHMARK_H
@@ -0,0 +1,218 @@
+#include "PointCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "Common/HashDefs.h"
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	static constexpr uint64_t SOURCE_HASH_SAMPLES_COUNT = 4;
+	static constexpr uint64_t SOURCE_HASH_SAMPLE_SIZE = 64 * 1024;
+
+	// Amount of blocks copied from the cache between two sink calls
+	static constexpr uint64_t CACHE_BATCH_BLOCKS_COUNT = 64;
+
+	static uint64_t HashBytes(const char* data, uint64_t size, uint64_t hash)
+	{
+		for (uint64_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ static_cast<uint8_t>(data[i])) * prime_64_const;
+		}
+		return hash;
+	}
+
+	PointCacheSource DescribePointCacheSource(const MappedFile* sourceFile, const std::filesystem::path& sourcePath)
+	{
+		PointCacheSource source;
+		source.size = sourceFile->GetSize();
+
+		std::error_code error;
+		const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(sourcePath, error);
+		source.writeTime = error ? 0 : static_cast<int64_t>(writeTime.time_since_epoch().count());
+
+		// evenly spaced samples, the last one ends at the end of the file
+		uint64_t hash = HashBytes(reinterpret_cast<const char*>(&source.size), sizeof(source.size), val_64_const);
+		const uint64_t sampleSize = std::min(SOURCE_HASH_SAMPLE_SIZE, source.size);
+		for (uint64_t sampleIndex = 0; sampleIndex < SOURCE_HASH_SAMPLES_COUNT && sampleSize != 0; sampleIndex++)
+		{
+			const uint64_t sampleOffset = (source.size - sampleSize) * sampleIndex / (SOURCE_HASH_SAMPLES_COUNT - 1);
+			hash = HashBytes(sourceFile->GetData() + sampleOffset, sampleSize, hash);
+		}
+		source.hash = hash;
+
+		return source;
+	}
+
+	// Moves a complete temporary cache over the cache, the temporary file is removed either way
+	static bool CommitPointCache(const std::filesystem::path& temporaryPath, const std::filesystem::path& cachePath)
+	{
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, cachePath, error);
+		if (error)
+		{
+			Logger::LogFormat("Can't replace point cache %s: %s\n", cachePath.string().c_str(), error.message().c_str());
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		Logger::LogFormat("Point cache written to %s\n", cachePath.string().c_str());
+		return true;
+	}
+
+	bool WritePointCache(const std::filesystem::path& cachePath, const PointCacheHeader& header, const PackedPoint* points)
+	{
+		PointCacheHeader completeHeader = header;
+		completeHeader.magic = PointCacheHeader::MAGIC;
+		completeHeader.version = PointCacheHeader::VERSION;
+		completeHeader.pointStride = sizeof(PackedPoint);
+
+		std::vector<char> headerPage(PointCacheHeader::PAYLOAD_OFFSET, 0);
+		std::memcpy(headerPage.data(), &completeHeader, sizeof(completeHeader));
+
+		const std::filesystem::path temporaryPath = cachePath.string() + ".tmp";
+		std::ofstream cacheStream(temporaryPath, std::ios::binary | std::ios::trunc);
+		cacheStream.write(headerPage.data(), static_cast<std::streamsize>(headerPage.size()));
+		cacheStream.write(reinterpret_cast<const char*>(points), static_cast<std::streamsize>(header.pointsCount * sizeof(PackedPoint)));
+		cacheStream.close();
+		if (cacheStream.fail())
+		{
+			Logger::LogFormat("Can't write point cache %s\n", temporaryPath.string().c_str());
+			std::error_code error;
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+
+		return CommitPointCache(temporaryPath, cachePath);
+	}
+
+	CachingPointSink::CachingPointSink(IPointSink* target, std::filesystem::path cachePath, const PointCacheSource& source) :
+		m_target(target),
+		m_blockPool(PointBlockMemory::System, target->GetBlockPool()->GetPointsPerBlock()),
+		m_cachePath(std::move(cachePath)),
+		m_temporaryPath(m_cachePath.string() + ".tmp")
+	{
+		m_header.pointStride = sizeof(PackedPoint);
+		m_header.source = source;
+	}
+
+	void CachingPointSink::Begin(uint64_t estimatedPointsCount, const PointOrigin& origin)
+	{
+		m_cacheStream.open(m_temporaryPath, std::ios::binary | std::ios::trunc);
+		if (m_cacheStream.is_open())
+		{
+			// header stays zeroed until the payload is complete
+			const std::vector<char> emptyHeader(PointCacheHeader::PAYLOAD_OFFSET, 0);
+			m_cacheStream.write(emptyHeader.data(), static_cast<std::streamsize>(emptyHeader.size()));
+		}
+		else
+		{
+			Logger::LogFormat("Can't create point cache %s\n", m_temporaryPath.string().c_str());
+		}
+
+		m_header.origin = origin;
+		m_target->Begin(estimatedPointsCount, origin);
+	}
+
+	void CachingPointSink::Consume(const PointBlock* blocks, uint64_t count)
+	{
+		PointBlockWriter writer(m_target->GetBlockPool());
+		for (const PointBlock* block = blocks; block != nullptr; block = block->next)
+		{
+			if (m_cacheStream.is_open())
+			{
+				m_cacheStream.write(reinterpret_cast<const char*>(block->points), static_cast<std::streamsize>(block->count * sizeof(PackedPoint)));
+			}
+			writer.Append(block->points, block->count);
+		}
+		m_header.pointsCount += count;
+
+		m_target->Consume(writer.GetHead(), writer.GetPointsCount());
+		m_target->GetBlockPool()->Release(writer.GetHead());
+	}
+
+	void CachingPointSink::End(const PointCloudStats& stats)
+	{
+		m_target->End(stats);
+
+		if (!m_cacheStream.is_open())
+		{
+			return;
+		}
+
+		m_header.stats = stats;
+		m_header.magic = PointCacheHeader::MAGIC;
+		m_header.version = PointCacheHeader::VERSION;
+		m_cacheStream.seekp(0);
+		m_cacheStream.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+		m_cacheStream.close();
+		if (m_cacheStream.fail())
+		{
+			Logger::LogFormat("Can't write point cache %s\n", m_temporaryPath.string().c_str());
+			std::error_code error;
+			std::filesystem::remove(m_temporaryPath, error);
+			return;
+		}
+
+		CommitPointCache(m_temporaryPath, m_cachePath);
+	}
+
+	PointCacheLoader::PointCacheLoader(const MappedFile* cacheFile, IPointSink* sink) :
+		m_file(cacheFile),
+		m_sink(sink)
+	{
+		ASSERT(m_file->GetSize() >= PointCacheHeader::PAYLOAD_OFFSET);
+	}
+
+	bool PointCacheLoader::IsValid(const MappedFile* cacheFile, const PointCacheSource& source)
+	{
+		if (!cacheFile->IsValid() || cacheFile->GetSize() < PointCacheHeader::PAYLOAD_OFFSET)
+		{
+			return false;
+		}
+
+		const PointCacheHeader& header = *reinterpret_cast<const PointCacheHeader*>(cacheFile->GetData());
+		return header.magic == PointCacheHeader::MAGIC &&
+			header.version == PointCacheHeader::VERSION &&
+			header.pointStride == sizeof(PackedPoint) &&
+			header.source.size == source.size &&
+			header.source.writeTime == source.writeTime &&
+			header.source.hash == source.hash &&
+			cacheFile->GetSize() == PointCacheHeader::PAYLOAD_OFFSET + header.pointsCount * header.pointStride;
+	}
+
+	uint64_t PointCacheLoader::Load()
+	{
+		const uint64_t pointsCount = GetHeader().pointsCount;
+		const PackedPoint* points = reinterpret_cast<const PackedPoint*>(m_file->GetData() + PointCacheHeader::PAYLOAD_OFFSET);
+
+		PointBlockPool* pool = m_sink->GetBlockPool();
+		const uint64_t batchSize = pool->GetPointsPerBlock() * CACHE_BATCH_BLOCKS_COUNT;
+
+		m_sink->Begin(pointsCount, GetHeader().origin);
+		m_file->PrefetchRange(PointCacheHeader::PAYLOAD_OFFSET, std::min(batchSize, pointsCount) * sizeof(PackedPoint));
+		for (uint64_t batchBegin = 0; batchBegin < pointsCount; batchBegin += batchSize)
+		{
+			const uint64_t batchPointsCount = std::min(batchSize, pointsCount - batchBegin);
+			const uint64_t batchOffset = PointCacheHeader::PAYLOAD_OFFSET + batchBegin * sizeof(PackedPoint);
+
+			// next batch streams in while this one is copied
+			if (batchBegin + batchSize < pointsCount)
+			{
+				m_file->PrefetchRange(batchOffset + batchSize * sizeof(PackedPoint), std::min(batchSize, pointsCount - batchBegin - batchSize) * sizeof(PackedPoint));
+			}
+
+			PointBlockWriter writer(pool);
+			writer.Append(points + batchBegin, batchPointsCount);
+			m_sink->Consume(writer.GetHead(), writer.GetPointsCount());
+			pool->Release(writer.GetHead());
+
+			m_file->ReleaseRange(batchOffset, batchPointsCount * sizeof(PackedPoint));
+		}
+		m_sink->End(GetHeader().stats);
+
+		return pointsCount;
+	}
+}
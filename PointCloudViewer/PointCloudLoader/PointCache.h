@@ -0,0 +1,104 @@
+#ifndef POINT_CACHE_H
+#define POINT_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+#include "PointLoader.h"
+#include "PointSink.h"
+#include "DataManager/MappedFile.h"
+
+namespace PointCloudViewer
+{
+	// Identity of the source file a cache was built from. Hashing the whole source would cost as much as parsing it,
+	// so the hash covers the size and a few sampled ranges, mtime catches the rest.
+	struct PointCacheSource
+	{
+		uint64_t size = 0;
+		int64_t writeTime = 0;
+		uint64_t hash = 0;
+	};
+
+	enum class PointCacheOrder : uint32_t
+	{
+		// order the loader passed the records in, progressive by chunk rounds
+		Load = 0,
+		// every prefix is a spatially uniform subsample, see ShufflePoints
+		Shuffled = 1
+	};
+
+	// Binary cache layout: header padded to PAYLOAD_OFFSET, then pointsCount raw records of pointStride bytes.
+	// Records are read back in the stored order, the order field tells which one it is.
+	struct PointCacheHeader
+	{
+		static constexpr uint32_t MAGIC = 0x43504350; // "PCPC"
+		static constexpr uint32_t VERSION = 6;
+		static constexpr uint64_t PAYLOAD_OFFSET = 4096;
+
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint32_t pointStride = 0;
+		PointCacheOrder order = PointCacheOrder::Load;
+		uint64_t pointsCount = 0;
+		// payload positions are relative to the origin
+		PointOrigin origin;
+		PointCloudStats stats;
+		PointCacheSource source;
+	};
+
+	static_assert(sizeof(PointCacheHeader) <= PointCacheHeader::PAYLOAD_OFFSET);
+
+	[[nodiscard]] PointCacheSource DescribePointCacheSource(const MappedFile* sourceFile, const std::filesystem::path& sourcePath);
+
+	// Writes a whole cache at once, header fields other than magic, version and stride come from the caller.
+	// Like CachingPointSink it goes through a temporary file, the cache must not be mapped while it is replaced.
+	bool WritePointCache(const std::filesystem::path& cachePath, const PointCacheHeader& header, const PackedPoint* points);
+
+	// Pass-through sink that writes every batch into a cache file on the way to the target sink, stats of the load go to the header.
+	// Parsers fill system memory blocks so the cache is never read back from write-combined upload memory,
+	// batches are copied into the target's blocks afterwards.
+	// The cache is written to a temporary file first and appears under its name only once it is complete.
+	class CachingPointSink : public IPointSink
+	{
+	public:
+		CachingPointSink(IPointSink* target, std::filesystem::path cachePath, const PointCacheSource& source);
+
+		[[nodiscard]] PointBlockPool* GetBlockPool() override { return &m_blockPool; }
+
+		void Begin(uint64_t estimatedPointsCount, const PointOrigin& origin) override;
+		void Consume(const PointBlock* blocks, uint64_t count) override;
+		void End(const PointCloudStats& stats) override;
+
+	private:
+		IPointSink* m_target;
+		PointBlockPool m_blockPool;
+
+		std::filesystem::path m_cachePath;
+		std::filesystem::path m_temporaryPath;
+		std::ofstream m_cacheStream;
+		PointCacheHeader m_header;
+	};
+
+	// Feeds a memory-mapped cache into the sink, the payload is copied straight from the mapping into sink blocks
+	class PointCacheLoader : public IPointLoader
+	{
+	public:
+		PointCacheLoader(const MappedFile* cacheFile, IPointSink* sink);
+
+		// Cache is usable when it is complete, of the current version and was built from this very source
+		[[nodiscard]] static bool IsValid(const MappedFile* cacheFile, const PointCacheSource& source);
+
+		uint64_t Load() override;
+		[[nodiscard]] PointOrigin GetOrigin() const override { return GetHeader().origin; }
+		[[nodiscard]] const PointCloudStats& GetStats() const override { return GetHeader().stats; }
+
+		[[nodiscard]] const PointCacheHeader& GetHeader() const noexcept { return *reinterpret_cast<const PointCacheHeader*>(m_file->GetData()); }
+
+	private:
+		const MappedFile* m_file;
+		IPointSink* m_sink;
+	};
+}
+
+#endif // POINT_CACHE_H
@@ -0,0 +1,66 @@
+#include "PointCloudStats.h"
+
+namespace PointCloudViewer
+{
+	void PointStatsAccumulator::Reset()
+	{
+		m_pointsCount = 0;
+		std::fill_n(m_boundsMin, 3, std::numeric_limits<float>::max());
+		std::fill_n(m_boundsMax, 3, std::numeric_limits<float>::lowest());
+		std::fill_n(m_positionSum, 3, 0.0);
+		m_intensityMin = std::numeric_limits<uint32_t>::max();
+		m_intensityMax = 0;
+		std::fill_n(&m_colorHistogram[0][0], 3 * PointCloudStats::COLOR_HISTOGRAM_BINS, 0);
+	}
+
+	void PointStatsAccumulator::Add(const PackedPoint* points, uint64_t count)
+	{
+		for (uint64_t i = 0; i < count; i++)
+		{
+			Add(points[i]);
+		}
+	}
+
+	void PointStatsAccumulator::Merge(const PointStatsAccumulator& other)
+	{
+		m_pointsCount += other.m_pointsCount;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			m_boundsMin[axis] = std::min(m_boundsMin[axis], other.m_boundsMin[axis]);
+			m_boundsMax[axis] = std::max(m_boundsMax[axis], other.m_boundsMax[axis]);
+			m_positionSum[axis] += other.m_positionSum[axis];
+		}
+		m_intensityMin = std::min(m_intensityMin, other.m_intensityMin);
+		m_intensityMax = std::max(m_intensityMax, other.m_intensityMax);
+		for (uint32_t channel = 0; channel < 3; channel++)
+		{
+			for (uint32_t bin = 0; bin < PointCloudStats::COLOR_HISTOGRAM_BINS; bin++)
+			{
+				m_colorHistogram[channel][bin] += other.m_colorHistogram[channel][bin];
+			}
+		}
+	}
+
+	PointCloudStats PointStatsAccumulator::GetStats(const PointOrigin& origin) const
+	{
+		PointCloudStats stats;
+		if (m_pointsCount == 0)
+		{
+			return stats;
+		}
+
+		const double originPosition[3] = {origin.x, origin.y, origin.z};
+		stats.pointsCount = m_pointsCount;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			stats.boundsMin[axis] = originPosition[axis] + m_boundsMin[axis];
+			stats.boundsMax[axis] = originPosition[axis] + m_boundsMax[axis];
+			stats.centroid[axis] = originPosition[axis] + m_positionSum[axis] / static_cast<double>(m_pointsCount);
+		}
+		stats.intensityMin = static_cast<float>(m_intensityMin) / 65535.0f;
+		stats.intensityMax = static_cast<float>(m_intensityMax) / 65535.0f;
+		std::copy_n(&m_colorHistogram[0][0], 3 * PointCloudStats::COLOR_HISTOGRAM_BINS, &stats.colorHistogram[0][0]);
+
+		return stats;
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef POINT_CLOUD_STATS_H
+#define POINT_CLOUD_STATS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "CommonEngineStructs.h"
+#include "PointOrigin.h"
+
+namespace PointCloudViewer
+{
+	// Summary of a loaded cloud, bounds and centroid are in source coordinates. Zeroed for empty clouds.
+	struct PointCloudStats
+	{
+		static constexpr uint32_t COLOR_HISTOGRAM_BINS = 32;
+
+		uint64_t pointsCount = 0;
+		double boundsMin[3] = {};
+		double boundsMax[3] = {};
+		double centroid[3] = {};
+		// unorm intensity as stored in PackedPoint
+		float intensityMin = 0.0f;
+		float intensityMax = 0.0f;
+		// red, green and blue counts of 10-bit channel values split into equal bins
+		uint64_t colorHistogram[3][COLOR_HISTOGRAM_BINS] = {};
+	};
+
+	// One pass reduction of packed points. Every worker owns one and feeds it the points it produces,
+	// accumulators are merged once the workers are done. Positions are taken origin-relative, as they are stored.
+	class alignas(64) PointStatsAccumulator
+	{
+	public:
+		PointStatsAccumulator() { Reset(); }
+
+		void Reset();
+
+		void Add(const PackedPoint& point)
+		{
+			const float position[3] = {point.position.x, point.position.y, point.position.z};
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				m_boundsMin[axis] = std::min(m_boundsMin[axis], position[axis]);
+				m_boundsMax[axis] = std::max(m_boundsMax[axis], position[axis]);
+				m_positionSum[axis] += position[axis];
+			}
+
+			const uint32_t intensity = point.intensity & 0xFFFF;
+			m_intensityMin = std::min(m_intensityMin, intensity);
+			m_intensityMax = std::max(m_intensityMax, intensity);
+
+			const uint32_t color = point.color.v;
+			for (uint32_t channel = 0; channel < 3; channel++)
+			{
+				m_colorHistogram[channel][(color >> channel * 10 & 1023) * PointCloudStats::COLOR_HISTOGRAM_BINS >> 10]++;
+			}
+			m_pointsCount++;
+		}
+
+		void Add(const PackedPoint* points, uint64_t count);
+		void Merge(const PointStatsAccumulator& other);
+
+		[[nodiscard]] uint64_t GetPointsCount() const noexcept { return m_pointsCount; }
+		[[nodiscard]] PointCloudStats GetStats(const PointOrigin& origin) const;
+
+	private:
+		uint64_t m_pointsCount;
+		float m_boundsMin[3];
+		float m_boundsMax[3];
+		// float sums of millions of points drift, double keeps the centroid exact enough
+		double m_positionSum[3];
+		uint32_t m_intensityMin;
+		uint32_t m_intensityMax;
+		uint64_t m_colorHistogram[3][PointCloudStats::COLOR_HISTOGRAM_BINS];
+	};
+}
+
+#endif // POINT_CLOUD_STATS_H
@@ -0,0 +1,322 @@
+#include "PointDataset.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "DataManager/DataManager.h"
+#include "Utils/Log.h"
+#include "Utils/TimeCounter.h"
+
+namespace PointCloudViewer
+{
+	// Head of the next station read ahead while the current one parses
+	static constexpr uint64_t STATION_PREFETCH_SIZE = 256ull * 1024ull * 1024ull;
+
+	// Smaller sources are likely hot in the page cache already, reading them past it only costs
+	static constexpr uint64_t ASYNC_READ_MIN_SIZE = 1024ull * 1024ull * 1024ull;
+
+	// Registration software writes rotations with a handful of significant digits
+	static constexpr double ROTATION_TOLERANCE = 1e-3;
+
+	static bool IsRotation(const double (&rotation)[3][3])
+	{
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				const double dot = rotation[i][0] * rotation[j][0] + rotation[i][1] * rotation[j][1] + rotation[i][2] * rotation[j][2];
+				if (std::abs(dot - (i == j ? 1.0 : 0.0)) > ROTATION_TOLERANCE)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	std::vector<DatasetStation> ReadPointDataset(const std::string& path)
+	{
+		if (std::filesystem::path(path).extension() != ".dataset")
+		{
+			return {{path, {}}};
+		}
+
+		std::vector<DatasetStation> stations;
+		const std::filesystem::path manifestDirectory = std::filesystem::path(path).parent_path();
+		std::ifstream manifest = DataManager::Get()->GetFileStream(path);
+		std::string line;
+		for (uint32_t lineIndex = 1; std::getline(manifest, line); lineIndex++)
+		{
+			std::istringstream lineStream(line.substr(0, line.find('#')));
+			std::string stationPath;
+			if (!(lineStream >> stationPath))
+			{
+				continue;
+			}
+
+			std::vector<double> values;
+			double value;
+			while (lineStream >> value)
+			{
+				values.push_back(value);
+			}
+			if (!lineStream.eof() || (values.size() != 0 && values.size() != 12 && values.size() != 16))
+			{
+				Logger::LogFormat("%s:%u: expected a path followed by 0, 12 or 16 numbers, station skipped\n", path.c_str(), lineIndex);
+				continue;
+			}
+
+			DatasetStation station = {(manifestDirectory / stationPath).generic_string(), {}};
+			if (!values.empty())
+			{
+				// the last row of a 4x4 matrix is always 0 0 0 1 for rigid transforms
+				for (uint32_t row = 0; row < 3; row++)
+				{
+					for (uint32_t column = 0; column < 3; column++)
+					{
+						station.transform.rotation[row][column] = values[row * 4 + column];
+					}
+					station.transform.translation[row] = values[row * 4 + 3];
+				}
+				if (!IsRotation(station.transform.rotation))
+				{
+					Logger::LogFormat("%s:%u: station transform isn't rigid, points will be distorted\n", path.c_str(), lineIndex);
+				}
+			}
+			stations.push_back(std::move(station));
+		}
+
+		Logger::LogFormat("Dataset %s has %llu stations\n", path.c_str(), stations.size());
+		return stations;
+	}
+
+	PointDatasetLoader::StationPointSink::StationPointSink(PointDatasetLoader* datasetLoader, const StationTransform& transform, uint64_t sourceSize) :
+		m_datasetLoader(datasetLoader),
+		m_transform(transform),
+		m_sourceSize(sourceSize),
+		m_blockPool(PointBlockMemory::System, datasetLoader->m_sink->GetBlockPool()->GetPointsPerBlock())
+	{
+	}
+
+	void PointDatasetLoader::StationPointSink::Begin(uint64_t estimatedPointsCount, const PointOrigin& origin)
+	{
+		const PointOrigin datasetPosition = m_transform.Apply(origin);
+		if (!m_datasetLoader->m_hasBegun)
+		{
+			// the first station's density extrapolated to the whole dataset
+			const double sizeRatio = static_cast<double>(m_datasetLoader->m_sourceSize) / static_cast<double>(std::max<uint64_t>(m_sourceSize, 1));
+			m_datasetLoader->m_origin = datasetPosition;
+			m_datasetLoader->m_sink->Begin(static_cast<uint64_t>(std::ceil(static_cast<double>(estimatedPointsCount) * sizeRatio)), datasetPosition);
+			m_datasetLoader->m_hasBegun = true;
+		}
+
+		// offset is computed in double, stations can be far from each other and from the source coordinate origin
+		const PointOrigin& datasetOrigin = m_datasetLoader->m_origin;
+		m_offset[0] = static_cast<float>(datasetPosition.x - datasetOrigin.x);
+		m_offset[1] = static_cast<float>(datasetPosition.y - datasetOrigin.y);
+		m_offset[2] = static_cast<float>(datasetPosition.z - datasetOrigin.z);
+		for (uint32_t row = 0; row < 3; row++)
+		{
+			for (uint32_t column = 0; column < 3; column++)
+			{
+				m_rotation[row][column] = static_cast<float>(m_transform.rotation[row][column]);
+			}
+		}
+	}
+
+	void PointDatasetLoader::StationPointSink::Consume(const PointBlock* blocks, uint64_t count)
+	{
+		PointBlockPool* targetPool = m_datasetLoader->m_sink->GetBlockPool();
+		PointBlockWriter writer(targetPool, &m_datasetLoader->m_statsAccumulator);
+		for (const PointBlock* block = blocks; block != nullptr; block = block->next)
+		{
+			for (uint32_t i = 0; i < block->count; i++)
+			{
+				PackedPoint point = block->points[i];
+				const float position[3] = {point.position.x, point.position.y, point.position.z};
+				point.position = {
+					m_rotation[0][0] * position[0] + m_rotation[0][1] * position[1] + m_rotation[0][2] * position[2] + m_offset[0],
+					m_rotation[1][0] * position[0] + m_rotation[1][1] * position[1] + m_rotation[1][2] * position[2] + m_offset[1],
+					m_rotation[2][0] * position[0] + m_rotation[2][1] * position[1] + m_rotation[2][2] * position[2] + m_offset[2]
+				};
+				writer.Append(point);
+			}
+		}
+
+		m_datasetLoader->m_sink->Consume(writer.GetHead(), writer.GetPointsCount());
+		targetPool->Release(writer.GetHead());
+	}
+
+	void PointDatasetLoader::StationPointSink::End(const PointCloudStats& stats)
+	{
+		// stations are closed by the dataset loader, the shared sink ends after the last one
+	}
+
+	PointDatasetLoader::PointDatasetLoader(std::vector<DatasetStation> stations, IPointSink* sink) :
+		m_stations(std::move(stations)),
+		m_sink(sink)
+	{
+	}
+
+	bool PointDatasetLoader::IsLoneStation(const std::vector<DatasetStation>& stations)
+	{
+		return stations.size() == 1 && stations[0].transform.IsIdentity();
+	}
+
+	uint64_t PointDatasetLoader::Load()
+	{
+		DataManager* dataManager = DataManager::Get();
+		for (const DatasetStation& station : m_stations)
+		{
+			std::error_code error;
+			const uint64_t size = std::filesystem::file_size(dataManager->GetFilePath(station.path), error);
+			m_sourceSize += error ? 0 : size;
+		}
+
+		OpenedStation openedStation = m_stations.empty() ? OpenedStation() : OpenStation(m_stations[0]);
+		if (IsLoneStation(m_stations) && openedStation.file->IsValid())
+		{
+			m_isLoneStation = true;
+			m_loneStationSource = openedStation.source;
+			return LoadStation(0, openedStation, m_sink, m_origin, m_stats);
+		}
+
+		uint64_t pointsCount = 0;
+		for (uint32_t stationIndex = 0; stationIndex < m_stations.size(); stationIndex++)
+		{
+			OpenedStation currentStation = std::move(openedStation);
+			// next station's pages stream in while this one keeps the workers busy
+			if (stationIndex + 1 < m_stations.size())
+			{
+				openedStation = OpenStation(m_stations[stationIndex + 1]);
+			}
+
+			StationPointSink stationSink(this, m_stations[stationIndex].transform, currentStation.file->GetSize());
+			PointOrigin stationOrigin;
+			PointCloudStats stationStats;
+			pointsCount += LoadStation(stationIndex, currentStation, &stationSink, stationOrigin, stationStats);
+		}
+
+		if (!m_hasBegun)
+		{
+			m_sink->Begin(0, m_origin);
+		}
+		m_stats = m_statsAccumulator.GetStats(m_origin);
+		m_sink->End(m_stats);
+
+		return pointsCount;
+	}
+
+	std::vector<PackedPoint> PointDatasetLoader::ReadLoadedPoints() const
+	{
+		if (!m_isLoneStation)
+		{
+			return {};
+		}
+
+		// unmapped on return, the caller may replace the cache afterwards
+		const std::unique_ptr<MappedFile> cacheFile = DataManager::Get()->MapData(m_stations[0].path, true);
+		if (!PointCacheLoader::IsValid(cacheFile.get(), m_loneStationSource))
+		{
+			return {};
+		}
+
+		const PointCacheHeader& header = *reinterpret_cast<const PointCacheHeader*>(cacheFile->GetData());
+		std::vector<PackedPoint> points(header.pointsCount);
+		std::memcpy(points.data(), cacheFile->GetData() + PointCacheHeader::PAYLOAD_OFFSET, points.size() * sizeof(PackedPoint));
+		return points;
+	}
+
+	void PointDatasetLoader::StoreShuffledPoints(const std::vector<PackedPoint>& points) const
+	{
+		if (!m_isLoneStation)
+		{
+			return;
+		}
+
+		PointCacheHeader header;
+		header.order = PointCacheOrder::Shuffled;
+		header.pointsCount = points.size();
+		header.origin = m_origin;
+		header.stats = m_stats;
+		header.source = m_loneStationSource;
+		WritePointCache(DataManager::Get()->GetFilePath(m_stations[0].path, true), header, points.data());
+	}
+
+	PointDatasetLoader::OpenedStation PointDatasetLoader::OpenStation(const DatasetStation& station) const
+	{
+		DataManager* dataManager = DataManager::Get();
+
+		OpenedStation openedStation;
+		openedStation.file = dataManager->MapData(station.path);
+		if (!openedStation.file->IsValid())
+		{
+			return openedStation;
+		}
+
+		openedStation.source = DescribePointCacheSource(openedStation.file.get(), dataManager->GetFilePath(station.path));
+		if (dataManager->HasRawData(station.path))
+		{
+			openedStation.cacheFile = dataManager->MapData(station.path, true);
+			if (!PointCacheLoader::IsValid(openedStation.cacheFile.get(), openedStation.source))
+			{
+				// stale cache has to be unmapped before it can be replaced
+				openedStation.cacheFile.reset();
+			}
+		}
+
+		if (openedStation.cacheFile == nullptr && openedStation.file->GetSize() >= ASYNC_READ_MIN_SIZE && IsTextPointSource(station.path))
+		{
+			openedStation.reader = dataManager->OpenAsyncData(station.path);
+			if (openedStation.reader->IsValid())
+			{
+				// reads of the station start with its load, nothing to prefetch
+				return openedStation;
+			}
+			openedStation.reader.reset();
+		}
+
+		const MappedFile* readFile = openedStation.cacheFile != nullptr ? openedStation.cacheFile.get() : openedStation.file.get();
+		readFile->PrefetchRange(0, STATION_PREFETCH_SIZE);
+		return openedStation;
+	}
+
+	uint64_t PointDatasetLoader::LoadStation(uint32_t stationIndex, OpenedStation& openedStation, IPointSink* sink, PointOrigin& origin, PointCloudStats& stats)
+	{
+		const DatasetStation& station = m_stations[stationIndex];
+		if (!openedStation.file->IsValid())
+		{
+			Logger::LogFormat("Station %s can't be read, skipped\n", station.path.c_str());
+			return 0;
+		}
+
+		const std::string message = "Station " + std::to_string(stationIndex) + " " + station.path;
+		const TimeCounter counter(message.c_str(), true);
+
+		uint64_t pointsCount;
+		if (openedStation.cacheFile != nullptr)
+		{
+			PointCacheLoader loader(openedStation.cacheFile.get(), sink);
+			pointsCount = loader.Load();
+			origin = loader.GetOrigin();
+			stats = loader.GetStats();
+			// a shuffled station merged with others is shuffled no more
+			m_isShuffled = m_isLoneStation && loader.GetHeader().order == PointCacheOrder::Shuffled;
+		}
+		else
+		{
+			CachingPointSink cachingSink(sink, DataManager::Get()->GetFilePath(station.path, true), openedStation.source);
+			const std::unique_ptr<IPointLoader> loader = CreatePointLoader(station.path, openedStation.file.get(), &cachingSink, openedStation.reader.get());
+			pointsCount = loader->Load();
+			origin = loader->GetOrigin();
+			stats = loader->GetStats();
+		}
+
+		Logger::LogFormat("Station %u: %llu points from %s%s\n", stationIndex, pointsCount, station.path.c_str(), openedStation.cacheFile != nullptr ? " cache" : "");
+		return pointsCount;
+	}
+}
@@ -0,0 +1,136 @@
+#ifndef POINT_DATASET_H
+#define POINT_DATASET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PointCache.h"
+#include "PointLoader.h"
+#include "PointSink.h"
+#include "DataManager/AsyncFileReader.h"
+#include "DataManager/MappedFile.h"
+
+namespace PointCloudViewer
+{
+	// Rigid transform of a scan station into dataset coordinates, p' = rotation * p + translation
+	struct StationTransform
+	{
+		double rotation[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+		double translation[3] = {};
+
+		[[nodiscard]] bool IsIdentity() const
+		{
+			const StationTransform identity;
+			return std::equal(&rotation[0][0], &rotation[0][0] + 9, &identity.rotation[0][0]) && std::equal(translation, translation + 3, identity.translation);
+		}
+
+		[[nodiscard]] PointOrigin Apply(const PointOrigin& position) const
+		{
+			return {
+				rotation[0][0] * position.x + rotation[0][1] * position.y + rotation[0][2] * position.z + translation[0],
+				rotation[1][0] * position.x + rotation[1][1] * position.y + rotation[1][2] * position.z + translation[1],
+				rotation[2][0] * position.x + rotation[2][1] * position.y + rotation[2][2] * position.z + translation[2]
+			};
+		}
+	};
+
+	struct DatasetStation
+	{
+		// relative to the data folder, like any DataManager path
+		std::string path;
+		StationTransform transform;
+	};
+
+	// Stations of a dataset. A .dataset manifest lists one station per line: a path relative to the manifest
+	// followed by nothing for identity, or by 12 (3x4) or 16 (4x4) row-major numbers of the station to dataset matrix.
+	// Anything after # is a comment. Any other file is a dataset of its own with a single station.
+	[[nodiscard]] std::vector<DatasetStation> ReadPointDataset(const std::string& path);
+
+	// Loads every station of a dataset into one sink as a single cloud, points are moved into dataset coordinates on the way.
+	// Each station runs across the whole worker pool, while it parses the next station is opened and its first chunks are prefetched.
+	// Stations keep their own point caches with untransformed points, so editing the manifest doesn't invalidate them.
+	// A lone station without a transform is loaded straight into the sink, its cache can hold the shuffled order.
+	// Progressive rounds are per station, stations themselves come in manifest order.
+	class PointDatasetLoader : public IPointLoader
+	{
+	public:
+		PointDatasetLoader(std::vector<DatasetStation> stations, IPointSink* sink);
+
+		// Stations load straight into the sink and through the station's cache, if that station can be read
+		[[nodiscard]] static bool IsLoneStation(const std::vector<DatasetStation>& stations);
+
+		uint64_t Load() override;
+		[[nodiscard]] PointOrigin GetOrigin() const override { return m_origin; }
+		[[nodiscard]] const PointCloudStats& GetStats() const override { return m_stats; }
+
+		// Size of all station sources, for throughput reporting
+		[[nodiscard]] uint64_t GetSourceSize() const noexcept { return m_sourceSize; }
+
+		// Points came from a cache that is shuffled already, valid after Load
+		[[nodiscard]] bool IsShuffled() const noexcept { return m_isShuffled; }
+		// Points of a lone station in loaded order, read back from its cache. Empty for several stations
+		// or when the cache couldn't be written.
+		[[nodiscard]] std::vector<PackedPoint> ReadLoadedPoints() const;
+		// Replaces the cache of a lone station with the loaded points in shuffled order.
+		// Caches of several stations hold untransformed points, a shuffle of the merged cloud has nowhere to go.
+		void StoreShuffledPoints(const std::vector<PackedPoint>& points) const;
+
+	private:
+		// Files of a station mapped ahead of its load, cacheFile is set only when the cache is up to date
+		struct OpenedStation
+		{
+			std::unique_ptr<MappedFile> file;
+			PointCacheSource source;
+			std::unique_ptr<MappedFile> cacheFile;
+			// large text sources without a cache are streamed, the mapping is only sampled for the origin
+			std::unique_ptr<AsyncFileReader> reader;
+		};
+
+		// Station loader's sink, transforms every batch into the shared sink's blocks and merges the station into the dataset stats.
+		// Begin of the shared sink comes from the first station, its transformed origin becomes the dataset origin.
+		class StationPointSink : public IPointSink
+		{
+		public:
+			StationPointSink(PointDatasetLoader* datasetLoader, const StationTransform& transform, uint64_t sourceSize);
+
+			[[nodiscard]] PointBlockPool* GetBlockPool() override { return &m_blockPool; }
+
+			void Begin(uint64_t estimatedPointsCount, const PointOrigin& origin) override;
+			void Consume(const PointBlock* blocks, uint64_t count) override;
+			void End(const PointCloudStats& stats) override;
+
+		private:
+			PointDatasetLoader* m_datasetLoader;
+			const StationTransform& m_transform;
+			const uint64_t m_sourceSize;
+			PointBlockPool m_blockPool;
+
+			// station-relative float positions go straight to dataset-relative ones
+			float m_rotation[3][3] = {};
+			float m_offset[3] = {};
+		};
+
+		[[nodiscard]] OpenedStation OpenStation(const DatasetStation& station) const;
+		// Runs the station's loader into the sink, from its cache when it is up to date
+		uint64_t LoadStation(uint32_t stationIndex, OpenedStation& openedStation, IPointSink* sink, PointOrigin& origin, PointCloudStats& stats);
+
+		std::vector<DatasetStation> m_stations;
+		IPointSink* m_sink;
+
+		bool m_hasBegun = false;
+		uint64_t m_sourceSize = 0;
+		PointOrigin m_origin;
+		PointStatsAccumulator m_statsAccumulator;
+		PointCloudStats m_stats;
+
+		bool m_isShuffled = false;
+		// set only for a lone station, the one cache the shuffled order can be stored in
+		bool m_isLoneStation = false;
+		PointCacheSource m_loneStationSource;
+	};
+}
+
+#endif // POINT_DATASET_H
@@ -0,0 +1,131 @@
+#include "PointLoader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <vector>
+
+#include "LasLoader.h"
+#include "PlyLoader.h"
+#include "PointTextLoader.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Assert.h"
+
+namespace PointCloudViewer
+{
+	// Runs decoded per worker between two sink calls, each run fills one block
+	static constexpr uint64_t RUNS_PER_WORKER = 2;
+
+	static std::string GetExtension(const std::string& path)
+	{
+		std::string extension = std::filesystem::path(path).extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return extension;
+	}
+
+	std::unique_ptr<IPointLoader> CreatePointLoader(const std::string& path, const MappedFile* file, IPointSink* sink, AsyncFileReader* reader)
+	{
+		const std::string extension = GetExtension(path);
+		if (extension == ".las")
+		{
+			return std::make_unique<LasLoader>(file, sink);
+		}
+		if (extension == ".ply")
+		{
+			return std::make_unique<PlyLoader>(file, sink);
+		}
+		return std::make_unique<PointTextLoader>(file, sink, PointTextLoaderSettings(), reader);
+	}
+
+	std::vector<uint64_t> GetProgressiveOrder(uint64_t chunksCount)
+	{
+		std::vector<uint64_t> order;
+		order.reserve(chunksCount);
+		uint64_t previousStride = 0;
+		for (const uint64_t stride : PROGRESSIVE_ROUND_STRIDES)
+		{
+			for (uint64_t chunkIndex = 0; chunkIndex < chunksCount; chunkIndex += stride)
+			{
+				// taken by the previous round, and so by every round before it
+				if (previousStride != 0 && chunkIndex % previousStride == 0)
+				{
+					continue;
+				}
+				order.push_back(chunkIndex);
+			}
+			previousStride = stride;
+		}
+
+		ASSERT(order.size() == chunksCount);
+		return order;
+	}
+
+	bool IsTextPointSource(const std::string& path)
+	{
+		const std::string extension = GetExtension(path);
+		return extension != ".las" && extension != ".ply";
+	}
+
+	PointCloudStats LoadPointRecords(const MappedFile* file, IPointSink* sink, const PointOrigin& origin,
+	                          uint64_t dataOffset, uint64_t recordSize, uint64_t recordsCount, const PointRecordDecoder& decoder)
+	{
+		ThreadManager* threadManager = ThreadManager::Get();
+		PointBlockPool* pool = sink->GetBlockPool();
+		const uint64_t recordsPerRun = pool->GetPointsPerBlock();
+		const uint64_t runsPerBatch = threadManager->GetWorkersCount() * RUNS_PER_WORKER;
+		const uint64_t runsCount = (recordsCount + recordsPerRun - 1) / recordsPerRun;
+		// fixed-size records are as cheap to reach anywhere in the file as in order
+		const std::vector<uint64_t> runOrder = GetProgressiveOrder(runsCount);
+		const auto getRunRecordsCount = [recordsPerRun, recordsCount](uint64_t runIndex)
+		{
+			return std::min(recordsPerRun, recordsCount - runIndex * recordsPerRun);
+		};
+
+		std::vector<PointBlock*> runBlocks(runsPerBatch);
+		std::vector<PointStatsAccumulator> workerStats(threadManager->GetWorkersCount());
+
+		sink->Begin(recordsCount, origin);
+		for (uint64_t batchBegin = 0; batchBegin < runsCount; batchBegin += runsPerBatch)
+		{
+			const uint64_t batchRunsCount = std::min(runsPerBatch, runsCount - batchBegin);
+			uint64_t batchRecordsCount = 0;
+			for (uint64_t batchRunIndex = 0; batchRunIndex < batchRunsCount; batchRunIndex++)
+			{
+				const uint64_t runIndex = runOrder[batchBegin + batchRunIndex];
+				file->PrefetchRange(dataOffset + runIndex * recordsPerRun * recordSize, getRunRecordsCount(runIndex) * recordSize);
+				batchRecordsCount += getRunRecordsCount(runIndex);
+			}
+
+			threadManager->ParallelFor(batchRunsCount, [&](uint64_t batchRunIndex, uint32_t workerIndex)
+			{
+				const uint64_t runIndex = runOrder[batchBegin + batchRunIndex];
+				PointBlockWriter writer(pool, &workerStats[workerIndex]);
+				decoder(file->GetData() + dataOffset + runIndex * recordsPerRun * recordSize, getRunRecordsCount(runIndex), writer);
+				runBlocks[batchRunIndex] = writer.GetHead();
+			});
+
+			// runs are single blocks, chaining them keeps the whole batch in one sink call
+			for (uint64_t batchRunIndex = 0; batchRunIndex + 1 < batchRunsCount; batchRunIndex++)
+			{
+				runBlocks[batchRunIndex]->next = runBlocks[batchRunIndex + 1];
+			}
+			sink->Consume(runBlocks[0], batchRecordsCount);
+			pool->Release(runBlocks[0]);
+
+			for (uint64_t batchRunIndex = 0; batchRunIndex < batchRunsCount; batchRunIndex++)
+			{
+				const uint64_t runIndex = runOrder[batchBegin + batchRunIndex];
+				file->ReleaseRange(dataOffset + runIndex * recordsPerRun * recordSize, getRunRecordsCount(runIndex) * recordSize);
+			}
+		}
+		PointStatsAccumulator stats;
+		for (const PointStatsAccumulator& statsPart : workerStats)
+		{
+			stats.Merge(statsPart);
+		}
+		const PointCloudStats cloudStats = stats.GetStats(origin);
+		sink->End(cloudStats);
+
+		return cloudStats;
+	}
+}
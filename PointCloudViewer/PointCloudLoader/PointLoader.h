@@ -0,0 +1,58 @@
+#ifndef POINT_LOADER_H
+#define POINT_LOADER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PointCloudStats.h"
+#include "PointOrigin.h"
+#include "PointSink.h"
+
+namespace PointCloudViewer
+{
+	// Source of points for a sink, every file format gets its own loader
+	class IPointLoader
+	{
+	public:
+		virtual ~IPointLoader() = default;
+
+		// Passes every point of the source to the sink in file order, returns amount of points passed
+		virtual uint64_t Load() = 0;
+		// Origin the loaded positions are relative to, final once Load is done
+		[[nodiscard]] virtual PointOrigin GetOrigin() const = 0;
+		// Bounds, centroid, intensity range and colour histogram gathered by the workers while loading, final once Load is done
+		[[nodiscard]] virtual const PointCloudStats& GetStats() const = 0;
+	};
+
+	class AsyncFileReader;
+	class MappedFile;
+
+	// Picks the loader by file extension, ascii text for anything unknown.
+	// Ascii text streams through the reader when there is one, binary formats decode straight from the mapping.
+	[[nodiscard]] std::unique_ptr<IPointLoader> CreatePointLoader(const std::string& path, const MappedFile* file, IPointSink* sink, AsyncFileReader* reader = nullptr);
+
+	// Rounds of progressive loading, each takes every stride-th chunk of the source not taken by an earlier one:
+	// 1% of chunks, then 10%, then the rest. Every stride divides the previous one.
+	static constexpr uint64_t PROGRESSIVE_ROUND_STRIDES[] = {100, 10, 1};
+
+	// Order chunks go to the sink in. Every round covers the whole source evenly,
+	// so the points consumed so far are always a uniform subset of it.
+	[[nodiscard]] std::vector<uint64_t> GetProgressiveOrder(uint64_t chunksCount);
+
+	// Whether CreatePointLoader reads the path as ascii text
+	[[nodiscard]] bool IsTextPointSource(const std::string& path);
+
+	// Appends recordsCount decoded records starting at records to the writer
+	using PointRecordDecoder = std::function<void(const char* records, uint64_t recordsCount, PointBlockWriter& writer)>;
+
+	// Shared part of binary formats with fixed-size records. Records are cut into block-sized runs that workers decode in parallel,
+	// every batch of runs goes to the sink as one chain, runs are taken in progressive order. Calls Begin and End of the sink.
+	// Every worker accumulates stats of the runs it decodes, returns them merged.
+	PointCloudStats LoadPointRecords(const MappedFile* file, IPointSink* sink, const PointOrigin& origin,
+	                          uint64_t dataOffset, uint64_t recordSize, uint64_t recordsCount, const PointRecordDecoder& decoder);
+}
+
+#endif // POINT_LOADER_H
@@ -0,0 +1,68 @@
+#include "PointNeighbourBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "MortonSort.h"
+#include "PointBvhBenchmark.h"
+#include "PointNeighbourIndex.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	static constexpr uint64_t BENCHMARK_QUERIES_COUNT = 1'000'000;
+	static constexpr uint32_t BENCHMARK_NEAREST_COUNT = 16;
+	// A few neighbours per query at the density of 10M points over the 50000 square meters of the scan
+	static constexpr float BENCHMARK_RADIUS = 0.1f;
+
+	static void RunQueries(const PointNeighbourIndex& index, const std::vector<PackedPoint>& queries, const char* order)
+	{
+		std::vector<PointNeighbour> neighbours;
+		auto startTime = std::chrono::steady_clock::now();
+		index.FindNearest(queries, BENCHMARK_NEAREST_COUNT, neighbours);
+		double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		Logger::LogFormat("Point neighbour benchmark: %llu %s queries of %u nearest in %.3f s, %.2f M queries/s\n",
+		                  static_cast<uint64_t>(queries.size()), order, BENCHMARK_NEAREST_COUNT, time, static_cast<double>(queries.size()) / time / 1e6);
+
+		std::vector<uint64_t> offsets;
+		startTime = std::chrono::steady_clock::now();
+		index.FindInRadius(queries, BENCHMARK_RADIUS, offsets, neighbours);
+		time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		Logger::LogFormat("Point neighbour benchmark: %llu %s queries of radius %.2f in %.3f s, %.2f M queries/s, %.1f neighbours on average\n",
+		                  static_cast<uint64_t>(queries.size()), order, BENCHMARK_RADIUS, time, static_cast<double>(queries.size()) / time / 1e6,
+		                  static_cast<double>(neighbours.size()) / static_cast<double>(queries.size()));
+	}
+
+	void RunPointNeighbourBenchmark(uint64_t pointsCount)
+	{
+		Logger::LogFormat("Point neighbour benchmark: generating %llu points\n", pointsCount);
+		const std::vector<PackedPoint> points = GenerateBenchmarkScan(pointsCount);
+
+		const auto startTime = std::chrono::steady_clock::now();
+		const PointNeighbourIndex index = PointNeighbourIndex::Build(points);
+		const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		Logger::LogFormat("Point neighbour benchmark: built over %llu points in %.3f s, %.1f M points/s, %.1f MB\n",
+		                  pointsCount, time, static_cast<double>(pointsCount) / time / 1e6, static_cast<double>(index.GetSize()) / 1e6);
+
+		// generated points are in no spatial order, the worst case for the caches
+		std::vector<PackedPoint> queries;
+		const uint64_t queriesStride = std::max<uint64_t>(pointsCount / BENCHMARK_QUERIES_COUNT, 1);
+		for (uint64_t i = 0; i < pointsCount; i += queriesStride)
+		{
+			queries.push_back(points[i]);
+		}
+		RunQueries(index, queries, "scattered");
+
+		// the same queries in Morton order, as when every point of a cloud looks up its neighbours
+		const MortonQuantizer quantizer = MortonQuantizer::FromPoints(queries);
+		std::vector<MortonEntry> entries = ComputeMortonEntries(queries, quantizer);
+		RadixSortMortonEntries(entries, quantizer.GetCodeBits());
+		std::vector<PackedPoint> sortedQueries(queries.size());
+		for (uint64_t i = 0; i < entries.size(); i++)
+		{
+			sortedQueries[i] = queries[entries[i].index];
+		}
+		RunQueries(index, sortedQueries, "Morton ordered");
+	}
+}
@@ -0,0 +1,14 @@
+#ifndef POINT_NEIGHBOUR_BENCHMARK_H
+#define POINT_NEIGHBOUR_BENCHMARK_H
+
+#include <cstdint>
+
+namespace PointCloudViewer
+{
+	// Builds a PointNeighbourIndex over a synthetic scan of pointsCount points, then runs batches of kNN and radius queries
+	// centered on points of the scan and logs the build time and the queries per second.
+	// 100M points take about 7GB at the peak: the points, two arrays of Morton entries and the index itself.
+	void RunPointNeighbourBenchmark(uint64_t pointsCount = 10'000'000);
+}
+
+#endif // POINT_NEIGHBOUR_BENCHMARK_H
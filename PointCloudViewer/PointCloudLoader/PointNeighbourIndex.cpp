@@ -0,0 +1,382 @@
+#include "PointNeighbourIndex.h"
+
+#include <algorithm>
+#include <bit>
+#include <immintrin.h>
+#include <limits>
+
+#include "MortonSort.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Assert.h"
+#include "Utils/TimeCounter.h"
+
+namespace PointCloudViewer
+{
+	// Ranges shorter than this aren't worth a task
+	static constexpr uint64_t NEIGHBOUR_MIN_RANGE_SIZE = 64 * 1024;
+	// Queries a batch task answers, consecutive queries reuse the nodes in cache
+	static constexpr uint64_t NEIGHBOUR_QUERY_RANGE_SIZE = 1024;
+	// Deeper than the tree of 2^32 buckets, one pending sibling per level
+	static constexpr uint32_t NEIGHBOUR_STACK_SIZE = 64;
+	// Nodes a nearest query usually has pending at once, it can grow past
+	static constexpr uint32_t NEIGHBOUR_PENDING_NODES_COUNT = 128;
+	static constexpr float NEIGHBOUR_FAR_POSITION = std::numeric_limits<float>::max();
+
+	static_assert(PointNeighbourIndex::BUCKET_POINTS_COUNT % 4 == 0);
+
+	static uint64_t GetRangesCount(uint64_t count, uint64_t minRangeSize)
+	{
+		return std::clamp<uint64_t>(count / minRangeSize, 1, ThreadManager::Get()->GetWorkersCount());
+	}
+
+	static uint64_t GetRangeBoundary(uint64_t count, uint64_t rangesCount, uint64_t rangeIndex)
+	{
+		return count * rangeIndex / rangesCount;
+	}
+
+	// Squared distance from the position to the box, 0 inside. Empty bounds are infinitely far.
+	static float GetBoxDistanceSquared(const AABB& bounds, const float (&position)[3])
+	{
+		const float boundsMin[3] = {bounds.min.x, bounds.min.y, bounds.min.z};
+		const float boundsMax[3] = {bounds.max.x, bounds.max.y, bounds.max.z};
+		float distanceSquared = 0.0f;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			const float distance = std::max(std::max(boundsMin[axis] - position[axis], position[axis] - boundsMax[axis]), 0.0f);
+			distanceSquared += distance * distance;
+		}
+		return distanceSquared;
+	}
+
+	// Nearest neighbours found so far, sorted by distance
+	class NearestNeighbours
+	{
+	public:
+		NearestNeighbours(PointNeighbour* neighbours, uint32_t k) :
+			m_neighbours(neighbours),
+			m_k(k)
+		{
+		}
+
+		// Points at this distance or farther can't get in
+		[[nodiscard]] float GetMaxDistanceSquared() const noexcept
+		{
+			return m_count == m_k ? m_neighbours[m_k - 1].distanceSquared : std::numeric_limits<float>::infinity();
+		}
+
+		[[nodiscard]] uint32_t GetCount() const noexcept { return m_count; }
+
+		void Add(uint32_t index, float distanceSquared)
+		{
+			uint32_t position = m_count == m_k ? m_k - 1 : m_count++;
+			while (position != 0 && m_neighbours[position - 1].distanceSquared > distanceSquared)
+			{
+				m_neighbours[position] = m_neighbours[position - 1];
+				position--;
+			}
+			m_neighbours[position] = {index, distanceSquared};
+		}
+
+	private:
+		PointNeighbour* m_neighbours;
+		uint32_t m_k;
+		uint32_t m_count = 0;
+	};
+
+	PointNeighbourIndex PointNeighbourIndex::Build(const std::vector<PackedPoint>& points)
+	{
+		TIME_PERF("Building point neighbour index");
+
+		ASSERT(points.size() <= std::numeric_limits<uint32_t>::max());
+
+		PointNeighbourIndex index;
+		index.m_pointsCount = points.size();
+		if (points.empty())
+		{
+			return index;
+		}
+
+		ThreadManager* threadManager = ThreadManager::Get();
+		const MortonQuantizer quantizer = MortonQuantizer::FromPoints(points);
+		std::vector<MortonEntry> entries = ComputeMortonEntries(points, quantizer);
+		RadixSortMortonEntries(entries, quantizer.GetCodeBits());
+
+		const uint64_t count = points.size();
+		index.m_bucketsCount = (count + BUCKET_POINTS_COUNT - 1) / BUCKET_POINTS_COUNT;
+		index.m_leafNodesCount = 1;
+		while (index.m_leafNodesCount < index.m_bucketsCount)
+		{
+			index.m_leafNodesCount *= 2;
+		}
+
+		const uint64_t paddedCount = index.m_bucketsCount * BUCKET_POINTS_COUNT;
+		index.m_positionsX.resize(paddedCount, NEIGHBOUR_FAR_POSITION);
+		index.m_positionsY.resize(paddedCount, NEIGHBOUR_FAR_POSITION);
+		index.m_positionsZ.resize(paddedCount, NEIGHBOUR_FAR_POSITION);
+		index.m_indices.resize(paddedCount, MAX_UINT);
+
+		const uint64_t rangesCount = GetRangesCount(count, NEIGHBOUR_MIN_RANGE_SIZE);
+		threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			for (uint64_t i = GetRangeBoundary(count, rangesCount, rangeIndex); i < GetRangeBoundary(count, rangesCount, rangeIndex + 1); i++)
+			{
+				const PackedPoint& point = points[entries[i].index];
+				index.m_positionsX[i] = point.position.x;
+				index.m_positionsY[i] = point.position.y;
+				index.m_positionsZ[i] = point.position.z;
+				index.m_indices[i] = entries[i].index;
+			}
+		});
+		entries = {};
+
+		// leaves are the bucket bounds, then every level is the union of the one below
+		const uint32_t leafNodesOffset = index.GetLeafNodesOffset();
+		index.m_nodeBounds.resize(static_cast<size_t>(index.m_leafNodesCount) * 2 - 1);
+		const uint64_t bucketRangesCount = GetRangesCount(index.m_leafNodesCount, NEIGHBOUR_MIN_RANGE_SIZE / BUCKET_POINTS_COUNT);
+		threadManager->ParallelFor(bucketRangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			for (uint64_t bucket = GetRangeBoundary(index.m_leafNodesCount, bucketRangesCount, rangeIndex);
+			     bucket < GetRangeBoundary(index.m_leafNodesCount, bucketRangesCount, rangeIndex + 1); bucket++)
+			{
+				float boundsMin[3] = {NEIGHBOUR_FAR_POSITION, NEIGHBOUR_FAR_POSITION, NEIGHBOUR_FAR_POSITION};
+				float boundsMax[3] = {-NEIGHBOUR_FAR_POSITION, -NEIGHBOUR_FAR_POSITION, -NEIGHBOUR_FAR_POSITION};
+				for (uint64_t i = bucket * BUCKET_POINTS_COUNT; i < std::min(count, (bucket + 1) * BUCKET_POINTS_COUNT); i++)
+				{
+					const float position[3] = {index.m_positionsX[i], index.m_positionsY[i], index.m_positionsZ[i]};
+					for (uint32_t axis = 0; axis < 3; axis++)
+					{
+						boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+						boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+					}
+				}
+				AABB& bounds = index.m_nodeBounds[leafNodesOffset + bucket];
+				bounds.min = VEC3(boundsMin[0], boundsMin[1], boundsMin[2]);
+				bounds.max = VEC3(boundsMax[0], boundsMax[1], boundsMax[2]);
+			}
+		});
+
+		for (uint32_t levelBegin = leafNodesOffset / 2, levelSize = index.m_leafNodesCount / 2; levelSize != 0; levelBegin /= 2, levelSize /= 2)
+		{
+			const uint64_t levelRangesCount = GetRangesCount(levelSize, NEIGHBOUR_MIN_RANGE_SIZE / BUCKET_POINTS_COUNT);
+			threadManager->ParallelFor(levelRangesCount, [&](uint64_t rangeIndex, uint32_t)
+			{
+				for (uint64_t node = levelBegin + GetRangeBoundary(levelSize, levelRangesCount, rangeIndex);
+				     node < levelBegin + GetRangeBoundary(levelSize, levelRangesCount, rangeIndex + 1); node++)
+				{
+					const AABB& left = index.m_nodeBounds[node * 2 + 1];
+					const AABB& right = index.m_nodeBounds[node * 2 + 2];
+					AABB& bounds = index.m_nodeBounds[node];
+					bounds.min = VEC3(std::min(left.min.x, right.min.x), std::min(left.min.y, right.min.y), std::min(left.min.z, right.min.z));
+					bounds.max = VEC3(std::max(left.max.x, right.max.x), std::max(left.max.y, right.max.y), std::max(left.max.z, right.max.z));
+				}
+			});
+		}
+		return index;
+	}
+
+	uint64_t PointNeighbourIndex::GetSize() const noexcept
+	{
+		return m_positionsX.size() * (3 * sizeof(float) + sizeof(uint32_t)) + m_nodeBounds.size() * sizeof(AABB);
+	}
+
+	uint32_t PointNeighbourIndex::FindNearest(const float (&position)[3], uint32_t k, PointNeighbour* neighbours) const
+	{
+		std::vector<PendingNode> pendingNodes;
+		pendingNodes.reserve(NEIGHBOUR_PENDING_NODES_COUNT);
+		return FindNearest(position, k, neighbours, pendingNodes);
+	}
+
+	uint32_t PointNeighbourIndex::FindNearest(const float (&position)[3], uint32_t k, PointNeighbour* neighbours, std::vector<PendingNode>& pendingNodes) const
+	{
+		if (IsEmpty() || k == 0)
+		{
+			return 0;
+		}
+
+		NearestNeighbours nearest(neighbours, k);
+		const __m128 queryX = _mm_set1_ps(position[0]);
+		const __m128 queryY = _mm_set1_ps(position[1]);
+		const __m128 queryZ = _mm_set1_ps(position[2]);
+
+		// Nearest node first. Subtree bounds overlap where the Morton curve jumps, so going depth first into the child
+		// the query is in fills the k slots with far points and visits several times more buckets.
+		const auto isFarther = [](const PendingNode& first, const PendingNode& second)
+		{
+			return first.distanceSquared > second.distanceSquared;
+		};
+		// an early exit leaves nodes behind
+		pendingNodes.clear();
+		pendingNodes.push_back({0, 0.0f});
+		const uint32_t leafNodesOffset = GetLeafNodesOffset();
+		while (!pendingNodes.empty())
+		{
+			std::pop_heap(pendingNodes.begin(), pendingNodes.end(), isFarther);
+			const PendingNode pending = pendingNodes.back();
+			pendingNodes.pop_back();
+			if (pending.distanceSquared >= nearest.GetMaxDistanceSquared())
+			{
+				break;
+			}
+
+			if (pending.node >= leafNodesOffset)
+			{
+				const uint64_t bucketBegin = static_cast<uint64_t>(pending.node - leafNodesOffset) * BUCKET_POINTS_COUNT;
+				__m128 maxDistanceSquared = _mm_set1_ps(nearest.GetMaxDistanceSquared());
+				for (uint64_t i = bucketBegin; i < bucketBegin + BUCKET_POINTS_COUNT; i += 4)
+				{
+					const __m128 offsetX = _mm_sub_ps(_mm_loadu_ps(&m_positionsX[i]), queryX);
+					const __m128 offsetY = _mm_sub_ps(_mm_loadu_ps(&m_positionsY[i]), queryY);
+					const __m128 offsetZ = _mm_sub_ps(_mm_loadu_ps(&m_positionsZ[i]), queryZ);
+					const __m128 distancesSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY)), _mm_mul_ps(offsetZ, offsetZ));
+					uint32_t closerMask = _mm_movemask_ps(_mm_cmplt_ps(distancesSquared, maxDistanceSquared));
+					if (closerMask == 0)
+					{
+						continue;
+					}
+
+					alignas(16) float lanes[4];
+					_mm_store_ps(lanes, distancesSquared);
+					for (; closerMask != 0; closerMask &= closerMask - 1)
+					{
+						const uint32_t lane = static_cast<uint32_t>(std::countr_zero(closerMask));
+						if (lanes[lane] < nearest.GetMaxDistanceSquared())
+						{
+							nearest.Add(m_indices[i + lane], lanes[lane]);
+						}
+					}
+					maxDistanceSquared = _mm_set1_ps(nearest.GetMaxDistanceSquared());
+				}
+				continue;
+			}
+
+			for (const uint32_t child : {pending.node * 2 + 1, pending.node * 2 + 2})
+			{
+				const float distanceSquared = GetBoxDistanceSquared(m_nodeBounds[child], position);
+				if (distanceSquared < nearest.GetMaxDistanceSquared())
+				{
+					pendingNodes.push_back({child, distanceSquared});
+					std::push_heap(pendingNodes.begin(), pendingNodes.end(), isFarther);
+				}
+			}
+		}
+		return nearest.GetCount();
+	}
+
+	void PointNeighbourIndex::FindInRadius(const float (&position)[3], float radius, std::vector<PointNeighbour>& neighbours) const
+	{
+		if (IsEmpty())
+		{
+			return;
+		}
+
+		const float radiusSquared = radius * radius;
+		const __m128 radiusSquaredLanes = _mm_set1_ps(radiusSquared);
+		const __m128 queryX = _mm_set1_ps(position[0]);
+		const __m128 queryY = _mm_set1_ps(position[1]);
+		const __m128 queryZ = _mm_set1_ps(position[2]);
+
+		uint32_t stack[NEIGHBOUR_STACK_SIZE];
+		uint32_t stackSize = 0;
+		if (GetBoxDistanceSquared(m_nodeBounds[0], position) <= radiusSquared)
+		{
+			stack[stackSize++] = 0;
+		}
+		const uint32_t leafNodesOffset = GetLeafNodesOffset();
+		while (stackSize != 0)
+		{
+			const uint32_t node = stack[--stackSize];
+			if (node >= leafNodesOffset)
+			{
+				const uint64_t bucketBegin = static_cast<uint64_t>(node - leafNodesOffset) * BUCKET_POINTS_COUNT;
+				for (uint64_t i = bucketBegin; i < bucketBegin + BUCKET_POINTS_COUNT; i += 4)
+				{
+					const __m128 offsetX = _mm_sub_ps(_mm_loadu_ps(&m_positionsX[i]), queryX);
+					const __m128 offsetY = _mm_sub_ps(_mm_loadu_ps(&m_positionsY[i]), queryY);
+					const __m128 offsetZ = _mm_sub_ps(_mm_loadu_ps(&m_positionsZ[i]), queryZ);
+					const __m128 distancesSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY)), _mm_mul_ps(offsetZ, offsetZ));
+					uint32_t insideMask = _mm_movemask_ps(_mm_cmple_ps(distancesSquared, radiusSquaredLanes));
+					if (insideMask == 0)
+					{
+						continue;
+					}
+
+					alignas(16) float lanes[4];
+					_mm_store_ps(lanes, distancesSquared);
+					for (; insideMask != 0; insideMask &= insideMask - 1)
+					{
+						const uint32_t lane = static_cast<uint32_t>(std::countr_zero(insideMask));
+						neighbours.push_back({m_indices[i + lane], lanes[lane]});
+					}
+				}
+				continue;
+			}
+
+			for (const uint32_t child : {node * 2 + 1, node * 2 + 2})
+			{
+				if (GetBoxDistanceSquared(m_nodeBounds[child], position) <= radiusSquared)
+				{
+					stack[stackSize++] = child;
+				}
+			}
+		}
+	}
+
+	void PointNeighbourIndex::FindNearest(const std::vector<PackedPoint>& queries, uint32_t k, std::vector<PointNeighbour>& neighbours) const
+	{
+		const uint64_t queriesCount = queries.size();
+		neighbours.resize(queriesCount * k);
+
+		const uint64_t rangesCount = (queriesCount + NEIGHBOUR_QUERY_RANGE_SIZE - 1) / NEIGHBOUR_QUERY_RANGE_SIZE;
+		ThreadManager::Get()->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			std::vector<PendingNode> pendingNodes;
+			pendingNodes.reserve(NEIGHBOUR_PENDING_NODES_COUNT);
+			for (uint64_t i = rangeIndex * NEIGHBOUR_QUERY_RANGE_SIZE; i < std::min(queriesCount, (rangeIndex + 1) * NEIGHBOUR_QUERY_RANGE_SIZE); i++)
+			{
+				const float position[3] = {queries[i].position.x, queries[i].position.y, queries[i].position.z};
+				PointNeighbour* queryNeighbours = &neighbours[i * k];
+				const uint32_t foundCount = FindNearest(position, k, queryNeighbours, pendingNodes);
+				std::fill(queryNeighbours + foundCount, queryNeighbours + k, PointNeighbour{MAX_UINT, std::numeric_limits<float>::infinity()});
+			}
+		});
+	}
+
+	void PointNeighbourIndex::FindInRadius(const std::vector<PackedPoint>& queries, float radius, std::vector<uint64_t>& offsets, std::vector<PointNeighbour>& neighbours) const
+	{
+		const uint64_t queriesCount = queries.size();
+		offsets.resize(queriesCount + 1);
+
+		// neighbours of a range are gathered apart, then copied after the ranges before them
+		const uint64_t rangesCount = (queriesCount + NEIGHBOUR_QUERY_RANGE_SIZE - 1) / NEIGHBOUR_QUERY_RANGE_SIZE;
+		std::vector<std::vector<PointNeighbour>> rangeNeighbours(rangesCount);
+		ThreadManager* threadManager = ThreadManager::Get();
+		threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			for (uint64_t i = rangeIndex * NEIGHBOUR_QUERY_RANGE_SIZE; i < std::min(queriesCount, (rangeIndex + 1) * NEIGHBOUR_QUERY_RANGE_SIZE); i++)
+			{
+				const float position[3] = {queries[i].position.x, queries[i].position.y, queries[i].position.z};
+				// range-local offsets for now
+				offsets[i] = rangeNeighbours[rangeIndex].size();
+				FindInRadius(position, radius, rangeNeighbours[rangeIndex]);
+			}
+		});
+
+		std::vector<uint64_t> rangeOffsets(rangesCount + 1, 0);
+		for (uint64_t rangeIndex = 0; rangeIndex < rangesCount; rangeIndex++)
+		{
+			rangeOffsets[rangeIndex + 1] = rangeOffsets[rangeIndex] + rangeNeighbours[rangeIndex].size();
+		}
+		offsets[queriesCount] = rangeOffsets[rangesCount];
+		neighbours.resize(rangeOffsets[rangesCount]);
+
+		threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			for (uint64_t i = rangeIndex * NEIGHBOUR_QUERY_RANGE_SIZE; i < std::min(queriesCount, (rangeIndex + 1) * NEIGHBOUR_QUERY_RANGE_SIZE); i++)
+			{
+				offsets[i] += rangeOffsets[rangeIndex];
+			}
+			std::copy(rangeNeighbours[rangeIndex].begin(), rangeNeighbours[rangeIndex].end(), neighbours.begin() + static_cast<std::ptrdiff_t>(rangeOffsets[rangeIndex]));
+			rangeNeighbours[rangeIndex] = {};
+		});
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef POINT_NEIGHBOUR_INDEX_H
+#define POINT_NEIGHBOUR_INDEX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace PointCloudViewer
+{
+	struct PointNeighbour
+	{
+		// index in the points the index was built from, MAX_UINT in the slots of a query with fewer neighbours than asked
+		uint32_t index;
+		float distanceSquared;
+	};
+
+	// Nearest neighbour and radius queries over a point cloud, for normals, outlier removal, snapping and registration.
+	// Points are sorted by Morton code and cut into buckets of BUCKET_POINTS_COUNT consecutive points, their positions are
+	// kept as structure of arrays so a bucket is scanned four points per SSE instruction.
+	// Over the buckets sits an implicit complete binary tree of bounds: children of node n are 2n + 1 and 2n + 2, leaves are
+	// the buckets in Morton order, so a subtree is a contiguous run of buckets and nothing but bounds is stored per node.
+	// Nearest queries visit the nodes nearest first, radius queries depth first, both skip nodes farther than the current k-th
+	// or radius distance.
+	// Everything is built on the thread manager workers.
+	class PointNeighbourIndex
+	{
+	public:
+		static constexpr uint32_t BUCKET_POINTS_COUNT = 32;
+
+		[[nodiscard]] static PointNeighbourIndex Build(const std::vector<PackedPoint>& points);
+
+		[[nodiscard]] bool IsEmpty() const noexcept { return m_pointsCount == 0; }
+		[[nodiscard]] uint64_t GetPointsCount() const noexcept { return m_pointsCount; }
+		[[nodiscard]] uint64_t GetBucketsCount() const noexcept { return m_bucketsCount; }
+		// Memory taken by the positions, indices and node bounds
+		[[nodiscard]] uint64_t GetSize() const noexcept;
+
+		// Up to k points nearest to the position, nearest first, a point at the position itself included. Returns their count.
+		uint32_t FindNearest(const float (&position)[3], uint32_t k, PointNeighbour* neighbours) const;
+		// Appends the points within the radius of the position, in no particular order
+		void FindInRadius(const float (&position)[3], float radius, std::vector<PointNeighbour>& neighbours) const;
+
+		// Batched on the workers, neighbours of query i are [i * k, i * k + k).
+		// Queries close to each other in the batch share the nodes they touch, Morton ordered queries run fastest.
+		void FindNearest(const std::vector<PackedPoint>& queries, uint32_t k, std::vector<PointNeighbour>& neighbours) const;
+		// Batched on the workers, neighbours of query i are [offsets[i], offsets[i + 1])
+		void FindInRadius(const std::vector<PackedPoint>& queries, float radius, std::vector<uint64_t>& offsets, std::vector<PointNeighbour>& neighbours) const;
+
+	private:
+		struct PendingNode
+		{
+			uint32_t node;
+			float distanceSquared;
+		};
+
+		// Nearest query with a node heap of the caller, a batch reuses one for all the queries of a range
+		uint32_t FindNearest(const float (&position)[3], uint32_t k, PointNeighbour* neighbours, std::vector<PendingNode>& pendingNodes) const;
+
+		[[nodiscard]] uint32_t GetLeafNodesOffset() const noexcept { return m_leafNodesCount - 1; }
+
+		uint64_t m_pointsCount = 0;
+		uint64_t m_bucketsCount = 0;
+		// power of two, buckets past m_bucketsCount have empty bounds
+		uint32_t m_leafNodesCount = 0;
+
+		// Morton order, the last bucket is padded with points at the largest float, which no query gets close to
+		std::vector<float> m_positionsX;
+		std::vector<float> m_positionsY;
+		std::vector<float> m_positionsZ;
+		std::vector<uint32_t> m_indices;
+
+		std::vector<AABB> m_nodeBounds;
+	};
+}
+
+#endif // POINT_NEIGHBOUR_INDEX_H
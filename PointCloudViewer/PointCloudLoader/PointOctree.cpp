@@ -0,0 +1,59 @@
+#include "PointOctree.h"
+
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	std::filesystem::path GetPointOctreeIndexPath(const std::filesystem::path& sourcePath)
+	{
+		return sourcePath.string() + ".octree";
+	}
+
+	std::filesystem::path GetPointOctreeNodesPath(const std::filesystem::path& sourcePath)
+	{
+		return sourcePath.string() + ".octree.nodes";
+	}
+
+	PointOctreeFile::PointOctreeFile(const std::filesystem::path& sourcePath) :
+		m_indexFile(std::make_unique<MappedFile>(GetPointOctreeIndexPath(sourcePath).string())),
+		m_nodesFile(std::make_unique<MappedFile>(GetPointOctreeNodesPath(sourcePath).string()))
+	{
+		if (!m_indexFile->IsValid() || !m_nodesFile->IsValid() || m_indexFile->GetSize() < sizeof(PointOctreeHeader))
+		{
+			return;
+		}
+
+		const PointOctreeHeader& header = GetHeader();
+		m_isValid = header.magic == PointOctreeHeader::MAGIC &&
+			header.version == PointOctreeHeader::VERSION &&
+			header.pointStride == sizeof(PackedPoint) &&
+			m_indexFile->GetSize() == sizeof(PointOctreeHeader) + header.nodesCount * sizeof(PointOctreeNode) &&
+			m_nodesFile->GetSize() == header.pointsCount * sizeof(PackedPoint);
+		if (!m_isValid)
+		{
+			Logger::LogFormat("Point octree of %s is incomplete or outdated\n", sourcePath.string().c_str());
+		}
+	}
+
+	void PointOctreeFile::GetNodeBounds(const PointOctreeNode& node, float (&boundsMin)[3], float (&boundsMax)[3]) const
+	{
+		const PointOctreeHeader& header = GetHeader();
+		const float nodeSize = header.cubeSize / static_cast<float>(1u << node.level);
+
+		// every third bit of the code is one bit of the cell coordinate
+		uint32_t cell[3] = {};
+		for (uint32_t level = 0; level < node.level; level++)
+		{
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				cell[axis] |= static_cast<uint32_t>(node.code >> (level * 3 + axis) & 1) << level;
+			}
+		}
+
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = header.cubeMin[axis] + static_cast<float>(cell[axis]) * nodeSize;
+			boundsMax[axis] = boundsMin[axis] + nodeSize;
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef POINT_OCTREE_H
+#define POINT_OCTREE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "CommonEngineStructs.h"
+#include "PointCloudStats.h"
+#include "PointOrigin.h"
+#include "DataManager/MappedFile.h"
+
+namespace PointCloudViewer
+{
+	// Hierarchy index layout: header, then nodesCount node records right after it.
+	// Nodes are sorted by level and by Morton code inside a level, so children of a node are contiguous and come in octant order.
+	// Points of the nodes are in a node file of their own, raw records of pointStride bytes in the order of the node records.
+	// Every point is stored once, a node holds a subsample of its cell and the children hold the rest (additive refinement).
+	struct PointOctreeHeader
+	{
+		static constexpr uint32_t MAGIC = 0x544F4350; // "PCOT"
+		static constexpr uint32_t VERSION = 1;
+
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint32_t pointStride = 0;
+		uint32_t nodesCount = 0;
+		uint64_t pointsCount = 0;
+		// node points are relative to the origin
+		PointOrigin origin;
+		// root cell, origin-relative
+		float cubeMin[3] = {};
+		float cubeSize = 0.0f;
+		// sampling cells per axis of a node, points of a node are at least about size / samplingGridSize apart
+		uint32_t samplingGridSize = 0;
+		uint32_t reserved = 0;
+		PointCloudStats stats;
+	};
+
+	struct PointOctreeNode
+	{
+		// Morton code of the node cell among the 8^level cells of its level, octant bits x, y, z from bit 0
+		uint64_t code = 0;
+		// first point of the node in the node file
+		uint64_t pointsOffset = 0;
+		uint32_t pointsCount = 0;
+		// index of the first child, valid when childMask isn't zero
+		uint32_t firstChild = 0;
+		uint8_t level = 0;
+		// bit i is set when octant i has a child
+		uint8_t childMask = 0;
+		uint16_t reserved0 = 0;
+		uint32_t reserved1 = 0;
+	};
+
+	static_assert(sizeof(PointOctreeNode) == 32);
+
+	// Index next to the source, "scan.txt" is indexed into "scan.txt.octree" and "scan.txt.octree.nodes"
+	[[nodiscard]] std::filesystem::path GetPointOctreeIndexPath(const std::filesystem::path& sourcePath);
+	[[nodiscard]] std::filesystem::path GetPointOctreeNodesPath(const std::filesystem::path& sourcePath);
+
+	// Read-only octree built by PointOctreeBuilder, both files are mapped and node points are paged in on access
+	class PointOctreeFile
+	{
+	public:
+		explicit PointOctreeFile(const std::filesystem::path& sourcePath);
+
+		// Both files are complete and of the current version
+		[[nodiscard]] bool IsValid() const noexcept { return m_isValid; }
+
+		[[nodiscard]] const PointOctreeHeader& GetHeader() const noexcept { return *reinterpret_cast<const PointOctreeHeader*>(m_indexFile->GetData()); }
+		[[nodiscard]] const PointOctreeNode* GetNodes() const noexcept { return reinterpret_cast<const PointOctreeNode*>(m_indexFile->GetData() + sizeof(PointOctreeHeader)); }
+		[[nodiscard]] uint32_t GetNodesCount() const noexcept { return GetHeader().nodesCount; }
+		[[nodiscard]] const PackedPoint* GetNodePoints(const PointOctreeNode& node) const noexcept { return reinterpret_cast<const PackedPoint*>(m_nodesFile->GetData()) + node.pointsOffset; }
+		// For read-ahead and release of node pages
+		[[nodiscard]] const MappedFile* GetNodesFile() const noexcept { return m_nodesFile.get(); }
+
+		// Origin-relative cell of a node
+		void GetNodeBounds(const PointOctreeNode& node, float (&boundsMin)[3], float (&boundsMax)[3]) const;
+
+	private:
+		std::unique_ptr<MappedFile> m_indexFile;
+		std::unique_ptr<MappedFile> m_nodesFile;
+		bool m_isValid = false;
+	};
+}
+
+#endif // POINT_OCTREE_H
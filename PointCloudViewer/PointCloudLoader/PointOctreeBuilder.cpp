@@ -0,0 +1,646 @@
+#include "PointOctreeBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <mutex>
+
+#include "PointDataset.h"
+#include "PointSink.h"
+#include "DataManager/DataManager.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+#include "Utils/TimeCounter.h"
+
+namespace PointCloudViewer
+{
+	// Chunk points, their sort entries and the node output of a chunk build, per point
+	static constexpr uint64_t INDEXED_POINT_SIZE = sizeof(PackedPoint) * 2 + sizeof(MortonEntry);
+	// Staged points read between two read-ahead hints in the sequential passes
+	static constexpr uint64_t STAGED_BATCH_POINTS_COUNT = 4 * 1024 * 1024;
+	// Bounds of the per-chunk write buffers, the budget share is split between all chunks
+	static constexpr uint64_t MIN_CHUNK_BUFFER_POINTS_COUNT = 4 * 1024;
+	static constexpr uint64_t MAX_CHUNK_BUFFER_POINTS_COUNT = 1024 * 1024;
+
+	// Random value of a point for sampling cell elections, a hash keeps the octree reproducible
+	static uint32_t GetElectionRandom(uint32_t index)
+	{
+		uint32_t hash = index;
+		hash ^= hash >> 16;
+		hash *= 0x7FEB352Du;
+		hash ^= hash >> 15;
+		hash *= 0x846CA68Bu;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	// Writes every batch of the dataset to the staging file as it is
+	class StagingPointSink : public IPointSink
+	{
+	public:
+		explicit StagingPointSink(const std::filesystem::path& path) :
+			m_blockPool(PointBlockMemory::System),
+			m_stream(path, std::ios::binary | std::ios::trunc)
+		{
+		}
+
+		[[nodiscard]] PointBlockPool* GetBlockPool() override { return &m_blockPool; }
+
+		void Begin(uint64_t estimatedPointsCount, const PointOrigin& origin) override
+		{
+		}
+
+		void Consume(const PointBlock* blocks, uint64_t count) override
+		{
+			for (const PointBlock* block = blocks; block != nullptr; block = block->next)
+			{
+				m_stream.write(reinterpret_cast<const char*>(block->points), static_cast<std::streamsize>(block->count * sizeof(PackedPoint)));
+			}
+		}
+
+		void End(const PointCloudStats& stats) override
+		{
+			m_stream.close();
+		}
+
+		[[nodiscard]] bool IsWritten() const { return !m_stream.fail(); }
+
+	private:
+		PointBlockPool m_blockPool;
+		std::ofstream m_stream;
+	};
+
+	PointOctreeBuilder::PointOctreeBuilder(std::string path, const PointOctreeBuilderSettings& settings) :
+		m_path(std::move(path)),
+		m_settings(settings),
+		m_samplingBits(static_cast<uint32_t>(std::countr_zero(settings.samplingGridSize)))
+	{
+		ASSERT(std::has_single_bit(settings.samplingGridSize) && m_samplingBits < MortonQuantizer::MAX_BITS_PER_AXIS);
+		ASSERT(settings.countingGridBits <= 10);
+
+		m_sourcePath = DataManager::Get()->GetFilePath(m_path);
+		m_stagedPath = m_sourcePath.string() + ".octree.staged";
+		m_nodesStagedPath = m_sourcePath.string() + ".octree.nodes.staged";
+	}
+
+	bool PointOctreeBuilder::Build()
+	{
+		TIME_PERF("Building point octree");
+
+		if (!StagePoints())
+		{
+			RemoveTemporaryFiles();
+			return false;
+		}
+
+		{
+			const std::unique_ptr<MappedFile> stagedFile = std::make_unique<MappedFile>(m_stagedPath.string());
+			if (!stagedFile->IsValid() || stagedFile->GetSize() != m_pointsCount * sizeof(PackedPoint))
+			{
+				Logger::LogFormat("Staged points of %s can't be read\n", m_path.c_str());
+				RemoveTemporaryFiles();
+				return false;
+			}
+
+			std::vector<uint64_t> cellCounts;
+			CountPoints(stagedFile.get(), cellCounts);
+
+			// every worker builds a chunk at once
+			const uint64_t maxChunkPointsCount = std::clamp<uint64_t>(
+				m_settings.memoryBudget / (ThreadManager::Get()->GetWorkersCount() * INDEXED_POINT_SIZE),
+				m_settings.maxNodePointsCount,
+				std::numeric_limits<uint32_t>::max());
+			CreateChunks(cellCounts, maxChunkPointsCount);
+
+			if (!DistributePoints(stagedFile.get()))
+			{
+				RemoveTemporaryFiles();
+				return false;
+			}
+		}
+		std::error_code error;
+		std::filesystem::remove(m_stagedPath, error);
+
+		const bool isBuilt = BuildChunks() && BuildUpperNodes() && WriteOctree();
+		RemoveTemporaryFiles();
+		return isBuilt;
+	}
+
+	bool PointOctreeBuilder::StagePoints()
+	{
+		TIME_PERF("Octree staging pass");
+
+		StagingPointSink stagingSink(m_stagedPath);
+		PointDatasetLoader loader(ReadPointDataset(m_path), &stagingSink);
+		m_pointsCount = loader.Load();
+		m_origin = loader.GetOrigin();
+		m_stats = loader.GetStats();
+		if (!stagingSink.IsWritten())
+		{
+			Logger::LogFormat("Can't write staged points to %s\n", m_stagedPath.string().c_str());
+			return false;
+		}
+
+		// stats are in source coordinates, the cube is origin-relative like the points
+		float boundsMin[3];
+		float boundsMax[3];
+		const double origin[3] = {m_origin.x, m_origin.y, m_origin.z};
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = static_cast<float>(m_stats.boundsMin[axis] - origin[axis]);
+			boundsMax[axis] = static_cast<float>(m_stats.boundsMax[axis] - origin[axis]);
+		}
+		m_quantizer.emplace(boundsMin, boundsMax);
+
+		Logger::LogFormat("Octree of %s: %llu points staged\n", m_path.c_str(), m_pointsCount);
+		return true;
+	}
+
+	void PointOctreeBuilder::CountPoints(const MappedFile* stagedFile, std::vector<uint64_t>& cellCounts) const
+	{
+		TIME_PERF("Octree counting pass");
+
+		const PackedPoint* points = reinterpret_cast<const PackedPoint*>(stagedFile->GetData());
+		const uint32_t countingShift = (MortonQuantizer::MAX_BITS_PER_AXIS - m_settings.countingGridBits) * 3;
+		std::vector<std::atomic<uint32_t>> counts(1ull << m_settings.countingGridBits * 3);
+
+		const uint64_t batchesCount = (m_pointsCount + STAGED_BATCH_POINTS_COUNT - 1) / STAGED_BATCH_POINTS_COUNT;
+		ThreadManager::Get()->ParallelFor(batchesCount, [&](uint64_t batchIndex, uint32_t)
+		{
+			const uint64_t begin = batchIndex * STAGED_BATCH_POINTS_COUNT;
+			const uint64_t end = std::min(begin + STAGED_BATCH_POINTS_COUNT, m_pointsCount);
+			for (uint64_t i = begin; i < end; i++)
+			{
+				counts[m_quantizer->Encode(points[i]) >> countingShift].fetch_add(1, std::memory_order_relaxed);
+			}
+			stagedFile->ReleaseRange(begin * sizeof(PackedPoint), (end - begin) * sizeof(PackedPoint));
+		});
+
+		cellCounts.resize(counts.size());
+		for (uint64_t cell = 0; cell < counts.size(); cell++)
+		{
+			cellCounts[cell] = counts[cell].load(std::memory_order_relaxed);
+		}
+	}
+
+	void PointOctreeBuilder::CreateChunks(const std::vector<uint64_t>& cellCounts, uint64_t maxChunkPointsCount)
+	{
+		// bottom-up, eight siblings merge into their parent while the sum fits a chunk.
+		// A parent that can't merge turns its occupied children into chunks and blocks all its ancestors.
+		constexpr uint64_t BLOCKED = std::numeric_limits<uint64_t>::max();
+		std::vector<uint64_t> levelCounts = cellCounts;
+		for (uint32_t level = m_settings.countingGridBits; level > 0; level--)
+		{
+			std::vector<uint64_t> parentCounts(levelCounts.size() / 8);
+			for (uint64_t parent = 0; parent < parentCounts.size(); parent++)
+			{
+				uint64_t sum = 0;
+				for (uint64_t child = parent * 8; child < parent * 8 + 8 && sum != BLOCKED; child++)
+				{
+					sum = levelCounts[child] == BLOCKED ? BLOCKED : sum + levelCounts[child];
+				}
+				if (sum != BLOCKED && sum <= maxChunkPointsCount)
+				{
+					parentCounts[parent] = sum;
+					continue;
+				}
+
+				parentCounts[parent] = BLOCKED;
+				for (uint64_t child = parent * 8; child < parent * 8 + 8; child++)
+				{
+					if (levelCounts[child] != BLOCKED && levelCounts[child] != 0)
+					{
+						m_chunks.push_back({child, level, levelCounts[child]});
+					}
+				}
+			}
+			levelCounts.swap(parentCounts);
+		}
+		if (levelCounts[0] != BLOCKED && levelCounts[0] != 0)
+		{
+			m_chunks.push_back({0, 0, levelCounts[0]});
+		}
+
+		// chunk cells cover contiguous Morton ranges of the counting grid
+		m_cellChunks.assign(cellCounts.size(), 0);
+		uint64_t maxPointsCount = 0;
+		for (uint32_t chunkIndex = 0; chunkIndex < m_chunks.size(); chunkIndex++)
+		{
+			Chunk& chunk = m_chunks[chunkIndex];
+			chunk.path = m_sourcePath.string() + ".octree.chunk" + std::to_string(chunkIndex);
+			const uint32_t shift = (m_settings.countingGridBits - chunk.level) * 3;
+			std::fill(m_cellChunks.begin() + (chunk.code << shift), m_cellChunks.begin() + ((chunk.code + 1) << shift), chunkIndex);
+			maxPointsCount = std::max(maxPointsCount, chunk.pointsCount);
+		}
+		if (maxPointsCount > maxChunkPointsCount)
+		{
+			// a single counting cell denser than the budget, its build takes more memory than planned
+			Logger::LogFormat("Octree chunk of %llu points exceeds the budget of %llu points\n", maxPointsCount, maxChunkPointsCount);
+		}
+		Logger::LogFormat("Octree of %s: %llu chunks of up to %llu points\n", m_path.c_str(), m_chunks.size(), maxPointsCount);
+	}
+
+	bool PointOctreeBuilder::DistributePoints(const MappedFile* stagedFile)
+	{
+		TIME_PERF("Octree distribution pass");
+
+		// sequential, so chunk files get points in staging order and the octree doesn't depend on scheduling
+		const uint64_t bufferPointsCount = std::clamp<uint64_t>(
+			m_settings.memoryBudget / 2 / std::max<uint64_t>(m_chunks.size(), 1) / sizeof(PackedPoint),
+			MIN_CHUNK_BUFFER_POINTS_COUNT, MAX_CHUNK_BUFFER_POINTS_COUNT);
+		bool isWritten = true;
+		const auto flushChunk = [&isWritten](Chunk& chunk)
+		{
+			std::ofstream stream(chunk.path, std::ios::binary | std::ios::app);
+			stream.write(reinterpret_cast<const char*>(chunk.writeBuffer.data()), static_cast<std::streamsize>(chunk.writeBuffer.size() * sizeof(PackedPoint)));
+			isWritten = isWritten && !stream.fail();
+			chunk.writeBuffer.clear();
+		};
+
+		const PackedPoint* points = reinterpret_cast<const PackedPoint*>(stagedFile->GetData());
+		const uint32_t countingShift = (MortonQuantizer::MAX_BITS_PER_AXIS - m_settings.countingGridBits) * 3;
+		stagedFile->PrefetchRange(0, STAGED_BATCH_POINTS_COUNT * sizeof(PackedPoint));
+		for (uint64_t batchBegin = 0; batchBegin < m_pointsCount && isWritten; batchBegin += STAGED_BATCH_POINTS_COUNT)
+		{
+			const uint64_t batchEnd = std::min(batchBegin + STAGED_BATCH_POINTS_COUNT, m_pointsCount);
+			stagedFile->PrefetchRange(batchEnd * sizeof(PackedPoint), STAGED_BATCH_POINTS_COUNT * sizeof(PackedPoint));
+			for (uint64_t i = batchBegin; i < batchEnd; i++)
+			{
+				Chunk& chunk = m_chunks[m_cellChunks[m_quantizer->Encode(points[i]) >> countingShift]];
+				chunk.writeBuffer.push_back(points[i]);
+				if (chunk.writeBuffer.size() == bufferPointsCount)
+				{
+					flushChunk(chunk);
+				}
+			}
+			stagedFile->ReleaseRange(batchBegin * sizeof(PackedPoint), (batchEnd - batchBegin) * sizeof(PackedPoint));
+		}
+
+		for (Chunk& chunk : m_chunks)
+		{
+			if (!chunk.writeBuffer.empty())
+			{
+				flushChunk(chunk);
+			}
+			chunk.writeBuffer.shrink_to_fit();
+		}
+		if (!isWritten)
+		{
+			Logger::LogFormat("Can't write octree chunks of %s\n", m_path.c_str());
+		}
+		return isWritten;
+	}
+
+	bool PointOctreeBuilder::BuildChunks()
+	{
+		TIME_PERF("Octree chunk indexing");
+
+		m_nodesStream.open(m_nodesStagedPath, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+		std::mutex nodesMutex;
+		bool isBuilt = m_nodesStream.is_open();
+
+		ThreadManager::Get()->ParallelFor(m_chunks.size(), [&](uint64_t chunkIndex, uint32_t)
+		{
+			const Chunk& chunk = m_chunks[chunkIndex];
+			std::vector<PackedPoint> points(chunk.pointsCount);
+			{
+				std::ifstream stream(chunk.path, std::ios::binary);
+				stream.read(reinterpret_cast<char*>(points.data()), static_cast<std::streamsize>(points.size() * sizeof(PackedPoint)));
+				if (stream.fail())
+				{
+					Logger::LogFormat("Can't read octree chunk %s\n", chunk.path.string().c_str());
+					std::lock_guard lock(nodesMutex);
+					isBuilt = false;
+					return;
+				}
+			}
+			std::error_code error;
+			std::filesystem::remove(chunk.path, error);
+
+			// workers are all busy with chunks, the chunk itself is sorted on this one
+			std::vector<MortonEntry> entries(points.size());
+			for (uint64_t i = 0; i < points.size(); i++)
+			{
+				entries[i] = {m_quantizer->Encode(points[i]), static_cast<uint32_t>(i)};
+			}
+			std::sort(entries.begin(), entries.end(), [](const MortonEntry& left, const MortonEntry& right)
+			{
+				return left.code != right.code ? left.code < right.code : left.index < right.index;
+			});
+
+			std::vector<PackedPoint> nodePoints;
+			nodePoints.reserve(points.size());
+			std::vector<BuiltNode> nodes;
+			BuildSubtree(entries, 0, entries.size(), chunk.level, chunk.code, points, nodePoints, nodes);
+
+			std::lock_guard lock(nodesMutex);
+			m_nodesStream.seekp(static_cast<std::streamoff>(m_nodesStagedCount * sizeof(PackedPoint)));
+			m_nodesStream.write(reinterpret_cast<const char*>(nodePoints.data()), static_cast<std::streamsize>(nodePoints.size() * sizeof(PackedPoint)));
+			isBuilt = isBuilt && !m_nodesStream.fail();
+			for (BuiltNode& node : nodes)
+			{
+				node.pointsOffset += m_nodesStagedCount;
+				m_nodes.push_back(std::move(node));
+			}
+			m_nodesStagedCount += nodePoints.size();
+		});
+
+		if (!isBuilt)
+		{
+			Logger::LogFormat("Can't build octree chunks of %s\n", m_path.c_str());
+		}
+		return isBuilt;
+	}
+
+	void PointOctreeBuilder::BuildSubtree(std::vector<MortonEntry>& entries, uint64_t begin, uint64_t end, uint32_t level, uint64_t code,
+	                                      const std::vector<PackedPoint>& points, std::vector<PackedPoint>& nodePoints, std::vector<BuiltNode>& nodes) const
+	{
+		BuiltNode node = {code, level, 0, nodePoints.size(), {}, false};
+
+		// sampling cells of the finest level are the quantization cells, nodes there keep everything
+		const uint32_t samplingLevel = level + m_samplingBits;
+		if (end - begin <= m_settings.maxNodePointsCount || samplingLevel > MortonQuantizer::MAX_BITS_PER_AXIS)
+		{
+			for (uint64_t i = begin; i < end; i++)
+			{
+				nodePoints.push_back(points[entries[i].index]);
+			}
+			node.pointsCount = static_cast<uint32_t>(end - begin);
+			nodes.push_back(std::move(node));
+			return;
+		}
+
+		// one point per sampling cell stays, the rest is compacted in place and keeps its order
+		const uint32_t samplingShift = (MortonQuantizer::MAX_BITS_PER_AXIS - samplingLevel) * 3;
+		uint64_t rejectedEnd = begin;
+		for (uint64_t runBegin = begin; runBegin < end;)
+		{
+			const uint64_t cell = entries[runBegin].code >> samplingShift;
+			uint64_t runEnd = runBegin + 1;
+			uint64_t elected = runBegin;
+			while (runEnd < end && entries[runEnd].code >> samplingShift == cell)
+			{
+				if (GetElectionRandom(entries[runEnd].index) < GetElectionRandom(entries[elected].index))
+				{
+					elected = runEnd;
+				}
+				runEnd++;
+			}
+
+			nodePoints.push_back(points[entries[elected].index]);
+			for (uint64_t i = runBegin; i < runEnd; i++)
+			{
+				if (i != elected)
+				{
+					entries[rejectedEnd++] = entries[i];
+				}
+			}
+			runBegin = runEnd;
+		}
+		node.pointsCount = static_cast<uint32_t>(nodePoints.size() - node.pointsOffset);
+		nodes.push_back(std::move(node));
+
+		// entries are still sorted, children are runs of the same octant
+		const uint32_t childShift = (MortonQuantizer::MAX_BITS_PER_AXIS - level - 1) * 3;
+		for (uint64_t childBegin = begin; childBegin < rejectedEnd;)
+		{
+			const uint64_t octant = entries[childBegin].code >> childShift & 7;
+			uint64_t childEnd = childBegin + 1;
+			while (childEnd < rejectedEnd && (entries[childEnd].code >> childShift & 7) == octant)
+			{
+				childEnd++;
+			}
+			BuildSubtree(entries, childBegin, childEnd, level + 1, code << 3 | octant, points, nodePoints, nodes);
+			childBegin = childEnd;
+		}
+	}
+
+	bool PointOctreeBuilder::BuildUpperNodes()
+	{
+		TIME_PERF("Octree upper levels");
+
+		// every ancestor of a chunk root, chunks never nest so none of them is a chunk node
+		for (const Chunk& chunk : m_chunks)
+		{
+			for (uint32_t level = 0; level < chunk.level; level++)
+			{
+				m_nodes.push_back({chunk.code >> (chunk.level - level) * 3, level, 0, 0, {}, true});
+			}
+		}
+		const auto nodeLess = [](const BuiltNode& left, const BuiltNode& right)
+		{
+			return left.level != right.level ? left.level < right.level : left.code < right.code;
+		};
+		std::sort(m_nodes.begin(), m_nodes.end(), nodeLess);
+		m_nodes.erase(std::unique(m_nodes.begin(), m_nodes.end(), [](const BuiltNode& left, const BuiltNode& right)
+		{
+			return left.level == right.level && left.code == right.code;
+		}), m_nodes.end());
+
+		// deepest upper level first, a parent elects from the points its children hold at that moment
+		bool isBuilt = true;
+		for (uint64_t nodeIndex = m_nodes.size(); nodeIndex-- > 0 && isBuilt;)
+		{
+			BuiltNode& node = m_nodes[nodeIndex];
+			if (!node.isUpper)
+			{
+				continue;
+			}
+
+			const BuiltNode firstChild = {node.code << 3, node.level + 1, 0, 0, {}, false};
+			const auto childrenBegin = std::lower_bound(m_nodes.begin(), m_nodes.end(), firstChild, nodeLess);
+			auto childrenEnd = childrenBegin;
+			std::vector<PackedPoint> candidates;
+			std::vector<uint32_t> candidateOffsets;
+			for (; childrenEnd != m_nodes.end() && childrenEnd->level == node.level + 1 && childrenEnd->code >> 3 == node.code; ++childrenEnd)
+			{
+				candidateOffsets.push_back(static_cast<uint32_t>(candidates.size()));
+				if (childrenEnd->isUpper)
+				{
+					candidates.insert(candidates.end(), childrenEnd->points.begin(), childrenEnd->points.end());
+					continue;
+				}
+				candidates.resize(candidates.size() + childrenEnd->pointsCount);
+				m_nodesStream.seekg(static_cast<std::streamoff>(childrenEnd->pointsOffset * sizeof(PackedPoint)));
+				m_nodesStream.read(reinterpret_cast<char*>(candidates.data() + candidates.size() - childrenEnd->pointsCount), static_cast<std::streamsize>(childrenEnd->pointsCount * sizeof(PackedPoint)));
+			}
+			candidateOffsets.push_back(static_cast<uint32_t>(candidates.size()));
+
+			std::vector<MortonEntry> entries(candidates.size());
+			for (uint64_t i = 0; i < candidates.size(); i++)
+			{
+				entries[i] = {m_quantizer->Encode(candidates[i]), static_cast<uint32_t>(i)};
+			}
+			std::sort(entries.begin(), entries.end(), [](const MortonEntry& left, const MortonEntry& right)
+			{
+				return left.code != right.code ? left.code < right.code : left.index < right.index;
+			});
+
+			const uint32_t samplingShift = (MortonQuantizer::MAX_BITS_PER_AXIS - std::min(node.level + m_samplingBits, MortonQuantizer::MAX_BITS_PER_AXIS)) * 3;
+			std::vector<bool> isElected(candidates.size(), false);
+			for (uint64_t runBegin = 0; runBegin < entries.size();)
+			{
+				const uint64_t cell = entries[runBegin].code >> samplingShift;
+				uint64_t elected = runBegin;
+				uint64_t runEnd = runBegin + 1;
+				for (; runEnd < entries.size() && entries[runEnd].code >> samplingShift == cell; runEnd++)
+				{
+					if (GetElectionRandom(entries[runEnd].index) < GetElectionRandom(entries[elected].index))
+					{
+						elected = runEnd;
+					}
+				}
+				isElected[entries[elected].index] = true;
+				node.points.push_back(candidates[entries[elected].index]);
+				runBegin = runEnd;
+			}
+			node.pointsCount = static_cast<uint32_t>(node.points.size());
+
+			// elected points move up, chunk roots are rewritten in place with what is left
+			uint32_t childIndex = 0;
+			for (auto child = childrenBegin; child != childrenEnd; ++child, childIndex++)
+			{
+				std::vector<PackedPoint> remainingPoints;
+				for (uint32_t i = candidateOffsets[childIndex]; i < candidateOffsets[childIndex + 1]; i++)
+				{
+					if (!isElected[i])
+					{
+						remainingPoints.push_back(candidates[i]);
+					}
+				}
+				child->pointsCount = static_cast<uint32_t>(remainingPoints.size());
+				if (child->isUpper)
+				{
+					child->points = std::move(remainingPoints);
+					continue;
+				}
+				m_nodesStream.seekp(static_cast<std::streamoff>(child->pointsOffset * sizeof(PackedPoint)));
+				m_nodesStream.write(reinterpret_cast<const char*>(remainingPoints.data()), static_cast<std::streamsize>(remainingPoints.size() * sizeof(PackedPoint)));
+			}
+			isBuilt = !m_nodesStream.fail();
+		}
+
+		if (!isBuilt)
+		{
+			Logger::LogFormat("Can't build upper octree levels of %s\n", m_path.c_str());
+		}
+		return isBuilt;
+	}
+
+	bool PointOctreeBuilder::WriteOctree()
+	{
+		TIME_PERF("Octree writing");
+
+		// nodes are sorted by level and code, children of a node follow each other on the next level
+		std::vector<PointOctreeNode> records(m_nodes.size());
+		uint64_t pointsOffset = 0;
+		for (uint64_t nodeIndex = 0, childIndex = 0; nodeIndex < m_nodes.size(); nodeIndex++)
+		{
+			const BuiltNode& node = m_nodes[nodeIndex];
+			PointOctreeNode& record = records[nodeIndex];
+			record.code = node.code;
+			record.level = static_cast<uint8_t>(node.level);
+			record.pointsOffset = pointsOffset;
+			record.pointsCount = node.pointsCount;
+			pointsOffset += node.pointsCount;
+
+			while (childIndex < m_nodes.size() && (m_nodes[childIndex].level < node.level + 1 || (m_nodes[childIndex].level == node.level + 1 && m_nodes[childIndex].code >> 3 < node.code)))
+			{
+				childIndex++;
+			}
+			record.firstChild = static_cast<uint32_t>(childIndex);
+			for (; childIndex < m_nodes.size() && m_nodes[childIndex].level == node.level + 1 && m_nodes[childIndex].code >> 3 == node.code; childIndex++)
+			{
+				record.childMask |= static_cast<uint8_t>(1u << (m_nodes[childIndex].code & 7));
+			}
+		}
+		ASSERT(pointsOffset == m_pointsCount);
+
+		PointOctreeHeader header;
+		header.magic = PointOctreeHeader::MAGIC;
+		header.version = PointOctreeHeader::VERSION;
+		header.pointStride = sizeof(PackedPoint);
+		header.nodesCount = static_cast<uint32_t>(records.size());
+		header.pointsCount = pointsOffset;
+		header.origin = m_origin;
+		const double origin[3] = {m_origin.x, m_origin.y, m_origin.z};
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			header.cubeMin[axis] = static_cast<float>(m_stats.boundsMin[axis] - origin[axis]);
+		}
+		header.cubeSize = m_quantizer->GetCellSize() * static_cast<float>(1u << MortonQuantizer::MAX_BITS_PER_AXIS);
+		header.samplingGridSize = m_settings.samplingGridSize;
+		header.stats = m_stats;
+
+		const std::filesystem::path indexPath = GetPointOctreeIndexPath(m_sourcePath);
+		const std::filesystem::path nodesPath = GetPointOctreeNodesPath(m_sourcePath);
+		const std::filesystem::path indexTemporaryPath = indexPath.string() + ".tmp";
+		const std::filesystem::path nodesTemporaryPath = nodesPath.string() + ".tmp";
+
+		std::ofstream nodesStream(nodesTemporaryPath, std::ios::binary | std::ios::trunc);
+		std::vector<PackedPoint> points;
+		for (const BuiltNode& node : m_nodes)
+		{
+			if (node.isUpper)
+			{
+				nodesStream.write(reinterpret_cast<const char*>(node.points.data()), static_cast<std::streamsize>(node.points.size() * sizeof(PackedPoint)));
+				continue;
+			}
+			points.resize(node.pointsCount);
+			m_nodesStream.seekg(static_cast<std::streamoff>(node.pointsOffset * sizeof(PackedPoint)));
+			m_nodesStream.read(reinterpret_cast<char*>(points.data()), static_cast<std::streamsize>(points.size() * sizeof(PackedPoint)));
+			nodesStream.write(reinterpret_cast<const char*>(points.data()), static_cast<std::streamsize>(points.size() * sizeof(PackedPoint)));
+		}
+		nodesStream.close();
+
+		std::ofstream indexStream(indexTemporaryPath, std::ios::binary | std::ios::trunc);
+		indexStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		indexStream.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(PointOctreeNode)));
+		indexStream.close();
+
+		std::error_code error;
+		if (nodesStream.fail() || indexStream.fail() || m_nodesStream.fail())
+		{
+			Logger::LogFormat("Can't write point octree of %s\n", m_path.c_str());
+			std::filesystem::remove(nodesTemporaryPath, error);
+			std::filesystem::remove(indexTemporaryPath, error);
+			return false;
+		}
+
+		// index goes last, a valid index always comes with its nodes
+		std::filesystem::remove(indexPath, error);
+		std::filesystem::rename(nodesTemporaryPath, nodesPath, error);
+		if (!error)
+		{
+			std::filesystem::rename(indexTemporaryPath, indexPath, error);
+		}
+		if (error)
+		{
+			Logger::LogFormat("Can't replace point octree %s: %s\n", indexPath.string().c_str(), error.message().c_str());
+			std::filesystem::remove(nodesTemporaryPath, error);
+			std::filesystem::remove(indexTemporaryPath, error);
+			return false;
+		}
+
+		Logger::LogFormat("Point octree written to %s, %llu nodes\n", indexPath.string().c_str(), records.size());
+		return true;
+	}
+
+	void PointOctreeBuilder::RemoveTemporaryFiles()
+	{
+		if (m_nodesStream.is_open())
+		{
+			m_nodesStream.close();
+		}
+
+		std::error_code error;
+		std::filesystem::remove(m_stagedPath, error);
+		std::filesystem::remove(m_nodesStagedPath, error);
+		for (const Chunk& chunk : m_chunks)
+		{
+			std::filesystem::remove(chunk.path, error);
+		}
+	}
+}
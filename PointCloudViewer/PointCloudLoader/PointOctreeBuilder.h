@@ -0,0 +1,105 @@
+#ifndef POINT_OCTREE_BUILDER_H
+#define POINT_OCTREE_BUILDER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "MortonSort.h"
+#include "PointCloudStats.h"
+#include "PointOctree.h"
+#include "PointOrigin.h"
+#include "DataManager/MappedFile.h"
+
+namespace PointCloudViewer
+{
+	struct PointOctreeBuilderSettings
+	{
+		// Peak memory of the chunk write buffers and of the chunk subtrees built at once
+		uint64_t memoryBudget = 4ull * 1024ull * 1024ull * 1024ull;
+		// Nodes with more points keep a subsample and pass the rest to their children
+		uint32_t maxNodePointsCount = 64 * 1024;
+		// Sampling cells per axis of a node, a power of two
+		uint32_t samplingGridSize = 128;
+		// Counting grid has 2^countingGridBits cells per axis, chunks are merged from them
+		uint32_t countingGridBits = 7;
+	};
+
+	// Out-of-core octree converter for clouds that don't fit in memory, in the spirit of the Potree converter.
+	// 1. The dataset streams through the loaders into a staging file of dataset-relative points.
+	// 2. Counting pass: points are counted in a coarse grid, cells are merged bottom-up into chunks that fit the budget.
+	// 3. Distribution pass: points are appended to one file per chunk.
+	// 4. Workers build the subtree of every chunk in memory, each node elects one point per sampling cell.
+	// 5. Nodes above the chunks are built bottom-up, they take their subsample from the children's points.
+	// Staging and chunk files live next to the output and are deleted as soon as they are consumed.
+	class PointOctreeBuilder
+	{
+	public:
+		explicit PointOctreeBuilder(std::string path, const PointOctreeBuilderSettings& settings = {});
+
+		// Path is a dataset like for PointDatasetLoader, the octree goes next to it
+		bool Build();
+
+	private:
+		struct Chunk
+		{
+			uint64_t code;
+			uint32_t level;
+			uint64_t pointsCount;
+			std::filesystem::path path;
+			std::vector<PackedPoint> writeBuffer;
+		};
+
+		struct BuiltNode
+		{
+			uint64_t code;
+			uint32_t level;
+			uint32_t pointsCount;
+			// points in the node staging file for chunk nodes
+			uint64_t pointsOffset;
+			// points of the nodes above the chunks, they are few and stay in memory
+			std::vector<PackedPoint> points;
+			bool isUpper;
+		};
+
+		bool StagePoints();
+		void CountPoints(const MappedFile* stagedFile, std::vector<uint64_t>& cellCounts) const;
+		void CreateChunks(const std::vector<uint64_t>& cellCounts, uint64_t maxChunkPointsCount);
+		bool DistributePoints(const MappedFile* stagedFile);
+		bool BuildChunks();
+		bool BuildUpperNodes();
+		bool WriteOctree();
+
+		// Subtree of a chunk, accepted points of every node are appended to nodePoints
+		void BuildSubtree(std::vector<MortonEntry>& entries, uint64_t begin, uint64_t end, uint32_t level, uint64_t code,
+		                  const std::vector<PackedPoint>& points, std::vector<PackedPoint>& nodePoints, std::vector<BuiltNode>& nodes) const;
+
+		void RemoveTemporaryFiles();
+
+		std::string m_path;
+		PointOctreeBuilderSettings m_settings;
+		uint32_t m_samplingBits;
+
+		std::filesystem::path m_sourcePath;
+		std::filesystem::path m_stagedPath;
+		std::filesystem::path m_nodesStagedPath;
+
+		uint64_t m_pointsCount = 0;
+		PointOrigin m_origin;
+		PointCloudStats m_stats;
+		std::optional<MortonQuantizer> m_quantizer;
+
+		std::vector<Chunk> m_chunks;
+		// chunk of every counting grid cell, by Morton code
+		std::vector<uint32_t> m_cellChunks;
+
+		std::fstream m_nodesStream;
+		uint64_t m_nodesStagedCount = 0;
+		std::vector<BuiltNode> m_nodes;
+	};
+}
+
+#endif // POINT_OCTREE_BUILDER_H
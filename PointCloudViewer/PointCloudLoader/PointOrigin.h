@@ -0,0 +1,58 @@
+#ifndef POINT_ORIGIN_H
+#define POINT_ORIGIN_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace PointCloudViewer
+{
+	// Dataset origin in source coordinates. Loaders subtract it in double precision before positions are stored as floats,
+	// so georeferenced clouds keep their precision, and the renderer adds it back through the view matrix.
+	struct PointOrigin
+	{
+		double x = 0.0;
+		double y = 0.0;
+		double z = 0.0;
+	};
+
+	// Source coordinate bounds accumulated by the origin pre-pass
+	struct PointSourceBounds
+	{
+		double min[3] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+		double max[3] = {std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+
+		void Add(double x, double y, double z)
+		{
+			const double position[3] = {x, y, z};
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				min[axis] = std::min(min[axis], position[axis]);
+				max[axis] = std::max(max[axis], position[axis]);
+			}
+		}
+
+		void Add(const PointSourceBounds& other)
+		{
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				min[axis] = std::min(min[axis], other.min[axis]);
+				max[axis] = std::max(max[axis], other.max[axis]);
+			}
+		}
+
+		[[nodiscard]] bool IsEmpty() const noexcept { return min[0] > max[0]; }
+
+		// Center of the bounds, zero for empty ones
+		[[nodiscard]] PointOrigin GetCenter() const
+		{
+			if (IsEmpty())
+			{
+				return {};
+			}
+			return {(min[0] + max[0]) * 0.5, (min[1] + max[1]) * 0.5, (min[2] + max[2]) * 0.5};
+		}
+	};
+}
+
+#endif // POINT_ORIGIN_H
@@ -0,0 +1,40 @@
+#ifndef POINT_PACKING_H
+#define POINT_PACKING_H
+
+#include <algorithm>
+#include <cstdint>
+
+#include "CommonEngineStructs.h"
+
+namespace PointCloudViewer
+{
+	// value is expected in [0, 1], anything outside is clamped, NaN goes to 0
+	inline uint32_t PackUnorm(float value, uint32_t maxValue)
+	{
+		// NaN fails the comparison
+		const float clampedValue = value > 0.0f ? std::min(value, 1.0f) : 0.0f;
+		return static_cast<uint32_t>(clampedValue * static_cast<float>(maxValue) + 0.5f);
+	}
+
+	// Opaque RGB10A2, channels in [0, 1]
+	inline uint32_t PackColor(float r, float g, float b)
+	{
+		return PackUnorm(r, 1023) | PackUnorm(g, 1023) << 10 | PackUnorm(b, 1023) << 20 | 3u << 30;
+	}
+
+	inline uint32_t PackIntensity(float intensity)
+	{
+		return PackUnorm(intensity, 0xFFFF);
+	}
+
+	inline PackedPoint PackPoint(float x, float y, float z, float r, float g, float b, float intensity)
+	{
+		PackedPoint point;
+		point.position = {x, y, z};
+		point.color.v = PackColor(r, g, b);
+		point.intensity = PackIntensity(intensity);
+		return point;
+	}
+}
+
+#endif // POINT_PACKING_H
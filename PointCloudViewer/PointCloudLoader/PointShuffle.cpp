@@ -0,0 +1,171 @@
+#include "PointShuffle.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "MortonSort.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Assert.h"
+
+namespace PointCloudViewer
+{
+	// Finest level cuts the bounds into 4096 cells per axis, centimeters for a building sized scan
+	static constexpr uint32_t SHUFFLE_GRID_BITS = 12;
+	// Level of the points that represent no cell
+	static constexpr uint32_t SHUFFLE_REMAINDER_LEVEL = SHUFFLE_GRID_BITS + 1;
+	// Order key is the level above a 32-bit random value
+	static constexpr uint32_t SHUFFLE_ORDER_KEY_BITS = 32 + 4;
+	static_assert(SHUFFLE_REMAINDER_LEVEL < 1 << (SHUFFLE_ORDER_KEY_BITS - 32));
+
+	// Work is split into a few ranges per worker so stealing evens out uneven ranges
+	static constexpr uint32_t SHUFFLE_RANGES_PER_WORKER = 4;
+	// Ranges shorter than this aren't worth a task
+	static constexpr uint64_t SHUFFLE_MIN_RANGE_SIZE = 64 * 1024;
+
+	// Representative of a cell, the entry with the smallest random value
+	struct ShuffleCell
+	{
+		uint64_t code;
+		uint32_t random;
+		uint32_t index;
+	};
+
+	// Election and the order inside a level draw independent values, otherwise representatives of dense areas come first
+	static constexpr uint32_t ELECTION_SEED = 0;
+	static constexpr uint32_t ORDER_SEED = 0x9E3779B9u;
+
+	// Random value of a point, a hash of its index keeps the order reproducible
+	static uint32_t GetPointRandom(uint32_t index, uint32_t seed)
+	{
+		uint32_t hash = index ^ seed;
+		hash ^= hash >> 16;
+		hash *= 0x7FEB352Du;
+		hash ^= hash >> 15;
+		hash *= 0x846CA68Bu;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	static uint64_t GetRangeBoundary(uint64_t count, uint64_t rangesCount, uint64_t rangeIndex)
+	{
+		return count * rangeIndex / rangesCount;
+	}
+
+	// Elects the representative of every cell at every level and returns the level of each point.
+	// Entries are sorted by cell code, so cells of any level are runs of entries and their parents are runs of cells.
+	static std::vector<uint8_t> ElectRepresentatives(const std::vector<MortonEntry>& entries)
+	{
+		ThreadManager* threadManager = ThreadManager::Get();
+		const uint64_t count = entries.size();
+		const uint64_t rangesCount = std::clamp<uint64_t>(count / SHUFFLE_MIN_RANGE_SIZE, 1, threadManager->GetWorkersCount() * SHUFFLE_RANGES_PER_WORKER);
+
+		// finest cells in parallel, a range starts at the first cell that begins inside it
+		std::vector<std::vector<ShuffleCell>> rangeCells(rangesCount);
+		threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			uint64_t begin = GetRangeBoundary(count, rangesCount, rangeIndex);
+			const uint64_t end = GetRangeBoundary(count, rangesCount, rangeIndex + 1);
+			while (begin != 0 && begin < end && entries[begin].code == entries[begin - 1].code)
+			{
+				begin++;
+			}
+			if (begin == end)
+			{
+				return;
+			}
+
+			std::vector<ShuffleCell>& cells = rangeCells[rangeIndex];
+			for (uint64_t i = begin; i < count && (i < end || entries[i].code == entries[i - 1].code); i++)
+			{
+				const uint32_t random = GetPointRandom(entries[i].index, ELECTION_SEED);
+				if (cells.empty() || cells.back().code != entries[i].code)
+				{
+					cells.push_back({entries[i].code, random, entries[i].index});
+				}
+				else if (random < cells.back().random)
+				{
+					cells.back().random = random;
+					cells.back().index = entries[i].index;
+				}
+			}
+		});
+
+		std::vector<ShuffleCell> cells;
+		for (const std::vector<ShuffleCell>& range : rangeCells)
+		{
+			cells.insert(cells.end(), range.begin(), range.end());
+		}
+		rangeCells.clear();
+
+		std::vector<uint8_t> levels(count, static_cast<uint8_t>(SHUFFLE_REMAINDER_LEVEL));
+		for (uint32_t level = SHUFFLE_GRID_BITS;; level--)
+		{
+			// parents are elected by later iterations and overwrite the level of their representative
+			for (const ShuffleCell& cell : cells)
+			{
+				levels[cell.index] = static_cast<uint8_t>(level);
+			}
+			if (level == 0)
+			{
+				break;
+			}
+
+			// coarsening in place, a parent never lands past its first child
+			uint64_t parentsCount = 0;
+			for (const ShuffleCell& cell : cells)
+			{
+				const uint64_t parentCode = cell.code >> 3;
+				if (parentsCount == 0 || cells[parentsCount - 1].code != parentCode)
+				{
+					cells[parentsCount++] = {parentCode, cell.random, cell.index};
+				}
+				else if (cell.random < cells[parentsCount - 1].random)
+				{
+					cells[parentsCount - 1].random = cell.random;
+					cells[parentsCount - 1].index = cell.index;
+				}
+			}
+			cells.resize(parentsCount);
+		}
+
+		return levels;
+	}
+
+	void ShufflePoints(std::vector<PackedPoint>& points)
+	{
+		const uint64_t count = points.size();
+		if (count < 2)
+		{
+			return;
+		}
+		ASSERT(count <= std::numeric_limits<uint32_t>::max());
+
+		ThreadManager* threadManager = ThreadManager::Get();
+		const uint64_t rangesCount = std::clamp<uint64_t>(count / SHUFFLE_MIN_RANGE_SIZE, 1, threadManager->GetWorkersCount() * SHUFFLE_RANGES_PER_WORKER);
+
+		std::vector<MortonEntry> entries = ComputeMortonEntries(points, MortonQuantizer::FromPoints(points, SHUFFLE_GRID_BITS));
+		RadixSortMortonEntries(entries, SHUFFLE_GRID_BITS * 3);
+		const std::vector<uint8_t> levels = ElectRepresentatives(entries);
+
+		threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			for (uint64_t i = GetRangeBoundary(count, rangesCount, rangeIndex); i < GetRangeBoundary(count, rangesCount, rangeIndex + 1); i++)
+			{
+				const uint32_t index = static_cast<uint32_t>(i);
+				entries[i] = {static_cast<uint64_t>(levels[i]) << 32 | GetPointRandom(index, ORDER_SEED), index};
+			}
+		});
+		RadixSortMortonEntries(entries, SHUFFLE_ORDER_KEY_BITS);
+
+		std::vector<PackedPoint> shuffledPoints(count);
+		threadManager->ParallelFor(rangesCount, [&](uint64_t rangeIndex, uint32_t)
+		{
+			for (uint64_t i = GetRangeBoundary(count, rangesCount, rangeIndex); i < GetRangeBoundary(count, rangesCount, rangeIndex + 1); i++)
+			{
+				shuffledPoints[i] = points[entries[i].index];
+			}
+		});
+		points.swap(shuffledPoints);
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef POINT_SHUFFLE_H
+#define POINT_SHUFFLE_H
+
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace PointCloudViewer
+{
+	// Reorders points so that every prefix of the cloud is a spatially uniform subsample of it,
+	// drawing the first N points is then a level of detail of its own.
+	// The cloud is split into a hierarchy of cubic voxels, level L cuts the bounds into 2^L cells per axis.
+	// Every occupied cell elects one random representative, a point goes to the coarsest level it represents.
+	// Levels come coarse to fine, points never elected come last, order inside a level is random.
+	// Order depends only on the input, the same cloud always shuffles the same way. Runs on the thread manager workers.
+	void ShufflePoints(std::vector<PackedPoint>& points);
+}
+
+#endif // POINT_SHUFFLE_H
@@ -0,0 +1,116 @@
+#ifndef POINT_SINK_H
+#define POINT_SINK_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "PointBlockPool.h"
+#include "PointCloudStats.h"
+#include "PointOrigin.h"
+
+namespace PointCloudViewer
+{
+	// Final stage of the loading pipeline. All calls come from the upload stage thread, batches arrive in file order.
+	class IPointSink
+	{
+	public:
+		virtual ~IPointSink() = default;
+
+		// Pool parsers write into, the sink decides which memory suits it
+		[[nodiscard]] virtual PointBlockPool* GetBlockPool() = 0;
+
+		// Called once before the first batch, the estimate comes from the first chunk and can be exceeded.
+		// Positions of all batches are relative to the origin.
+		virtual void Begin(uint64_t estimatedPointsCount, const PointOrigin& origin) = 0;
+		// Blocks are returned to the pool after the call, count is the total of the chain
+		virtual void Consume(const PointBlock* blocks, uint64_t count) = 0;
+		// Called once after the last batch, stats cover every point passed to the sink
+		virtual void End(const PointCloudStats& stats) = 0;
+	};
+
+	// Sink that only counts points, lets the pipeline run headless
+	class NullPointSink : public IPointSink
+	{
+	public:
+		explicit NullPointSink(uint32_t pointsPerBlock = PointBlockPool::DEFAULT_POINTS_PER_BLOCK) :
+			m_blockPool(PointBlockMemory::System, pointsPerBlock)
+		{
+		}
+
+		[[nodiscard]] PointBlockPool* GetBlockPool() override { return &m_blockPool; }
+
+		void Begin(uint64_t estimatedPointsCount, const PointOrigin& origin) override
+		{
+			m_estimatedPointsCount = estimatedPointsCount;
+		}
+
+		void Consume(const PointBlock* blocks, uint64_t count) override
+		{
+			m_pointsCount += count;
+			m_batchesCount++;
+		}
+
+		void End(const PointCloudStats& stats) override
+		{
+		}
+
+		[[nodiscard]] uint64_t GetPointsCount() const noexcept { return m_pointsCount; }
+		[[nodiscard]] uint64_t GetBatchesCount() const noexcept { return m_batchesCount; }
+		[[nodiscard]] uint64_t GetEstimatedPointsCount() const noexcept { return m_estimatedPointsCount; }
+
+	private:
+		PointBlockPool m_blockPool;
+		uint64_t m_estimatedPointsCount = 0;
+		uint64_t m_pointsCount = 0;
+		uint64_t m_batchesCount = 0;
+	};
+
+	// Pass-through sink that keeps a system memory copy of every point on the way to the target sink,
+	// for stages that need the whole cloud on the CPU once it is loaded
+	class RetainingPointSink : public IPointSink
+	{
+	public:
+		explicit RetainingPointSink(IPointSink* target) :
+			m_target(target),
+			m_blockPool(PointBlockMemory::System, target->GetBlockPool()->GetPointsPerBlock())
+		{
+		}
+
+		[[nodiscard]] PointBlockPool* GetBlockPool() override { return &m_blockPool; }
+
+		void Begin(uint64_t estimatedPointsCount, const PointOrigin& origin) override
+		{
+			m_points.reserve(estimatedPointsCount);
+			m_target->Begin(estimatedPointsCount, origin);
+		}
+
+		void Consume(const PointBlock* blocks, uint64_t count) override
+		{
+			PointBlockWriter writer(m_target->GetBlockPool());
+			for (const PointBlock* block = blocks; block != nullptr; block = block->next)
+			{
+				m_points.insert(m_points.end(), block->points, block->points + block->count);
+				writer.Append(block->points, block->count);
+			}
+
+			m_target->Consume(writer.GetHead(), writer.GetPointsCount());
+			m_target->GetBlockPool()->Release(writer.GetHead());
+		}
+
+		void End(const PointCloudStats& stats) override
+		{
+			m_target->End(stats);
+		}
+
+		// Points in the order the target got them, the sink keeps none afterwards
+		[[nodiscard]] std::vector<PackedPoint> TakePoints() { return std::move(m_points); }
+
+	private:
+		IPointSink* m_target;
+		PointBlockPool m_blockPool;
+		std::vector<PackedPoint> m_points;
+	};
+}
+
+#endif // POINT_SINK_H
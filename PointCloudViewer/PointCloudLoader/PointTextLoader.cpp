@@ -0,0 +1,423 @@
+#include "PointTextLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "PointPacking.h"
+#include "PointTextParser.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	// Origin pre-pass reads this many lines at evenly spaced places of the file
+	static constexpr uint32_t ORIGIN_SAMPLES_COUNT = 64;
+	static constexpr uint32_t ORIGIN_SAMPLE_LINES_COUNT = 256;
+
+	// Async reads run this far past the chunk to find the end of its last line, longer lines are cut
+	static constexpr uint64_t CHUNK_OVERLAP_SIZE = 64ull * 1024ull;
+
+	static uint32_t GetParsingWorkersCount()
+	{
+		return std::max(ThreadManager::Get()->GetWorkersCount(), 2u) - 1;
+	}
+
+	static uint32_t GetValueIndex(int32_t column, uint32_t missingIndex)
+	{
+		ASSERT(column < static_cast<int32_t>(PointTextParser::MAX_VALUES_PER_LINE));
+		return column >= 0 ? static_cast<uint32_t>(column) : missingIndex;
+	}
+
+	// Drops everything after the first count points of the chain
+	static void TruncateBlocks(PointBlock* blocks, uint64_t count, PointBlockPool* pool)
+	{
+		for (PointBlock* block = blocks; block != nullptr; block = block->next)
+		{
+			if (count <= block->count)
+			{
+				block->count = static_cast<uint32_t>(count);
+				pool->Release(block->next);
+				block->next = nullptr;
+				return;
+			}
+			count -= block->count;
+		}
+	}
+
+	PointTextLoader::PointTextLoader(const MappedFile* file, IPointSink* sink, const PointTextLoaderSettings& settings, AsyncFileReader* reader) :
+		m_file(file),
+		m_sink(sink),
+		m_reader(reader),
+		m_data(file->GetData() + std::min(settings.dataOffset, file->GetSize())),
+		m_dataSize(file->GetSize() - std::min(settings.dataOffset, file->GetSize())),
+		m_chunkSize(std::max<uint64_t>(settings.chunkSize, 1)),
+		m_chunksCount((m_dataSize + m_chunkSize - 1) / m_chunkSize),
+		m_maxPointsCount(settings.maxPointsCount),
+		m_valuesPerPoint(settings.valuesPerPoint),
+		m_valueIndices{
+			{
+				GetValueIndex(settings.columns.x, MISSING_INTENSITY_INDEX),
+				GetValueIndex(settings.columns.y, MISSING_INTENSITY_INDEX),
+				GetValueIndex(settings.columns.z, MISSING_INTENSITY_INDEX)
+			},
+			GetValueIndex(settings.columns.intensity, MISSING_INTENSITY_INDEX),
+			{
+				GetValueIndex(settings.columns.red, MISSING_COLOR_INDEX),
+				GetValueIndex(settings.columns.green, MISSING_COLOR_INDEX),
+				GetValueIndex(settings.columns.blue, MISSING_COLOR_INDEX)
+			}
+		},
+		m_colorMax(settings.colorMax),
+		m_colorScale(1.0 / settings.colorMax),
+		m_intensityMin(settings.intensityMin),
+		m_intensityScale(1.0 / (settings.intensityMax - settings.intensityMin)),
+		m_readSlots(GetParsingWorkersCount())
+	{
+		// positions are mandatory, only colour and intensity fall back to defaults
+		ASSERT(settings.columns.x >= 0 && settings.columns.y >= 0 && settings.columns.z >= 0);
+
+		const uint32_t ringSize = settings.ringSize != 0 ? settings.ringSize : GetParsingWorkersCount() * 4;
+		m_slots.resize(ringSize);
+
+		if (settings.isProgressive)
+		{
+			m_chunkOrder = GetProgressiveOrder(m_chunksCount);
+		}
+		else
+		{
+			m_chunkOrder.resize(m_chunksCount);
+			std::iota(m_chunkOrder.begin(), m_chunkOrder.end(), 0);
+		}
+
+		ASSERT(m_reader == nullptr || m_reader->GetSize() == m_file->GetSize());
+	}
+
+	uint64_t PointTextLoader::Load()
+	{
+		ThreadManager* threadManager = ThreadManager::Get();
+		// one worker reads, the rest parse
+		ASSERT(threadManager->GetWorkersCount() >= 2);
+
+		ComputeOrigin();
+
+		threadManager->StartWorker(0, m_reader != nullptr ? &PointTextLoader::ReadChunksAsync : &PointTextLoader::ReadChunks, this);
+		for (uint32_t workerIndex = 1; workerIndex < threadManager->GetWorkersCount(); workerIndex++)
+		{
+			threadManager->StartWorker(workerIndex, &PointTextLoader::ParseChunks, this, workerIndex - 1);
+		}
+
+		uint64_t pointsCount = 0;
+		PointStatsAccumulator stats;
+		for (uint64_t sequenceIndex = 0; sequenceIndex < m_chunksCount; sequenceIndex++)
+		{
+			ChunkSlot& slot = m_slots[sequenceIndex % m_slots.size()];
+			{
+				std::unique_lock lock(m_mutex);
+				m_chunkParsed.wait(lock, [&slot, sequenceIndex]
+				{
+					return slot.state == ChunkState::Parsed && slot.sequenceIndex == sequenceIndex;
+				});
+			}
+
+			if (sequenceIndex == 0)
+			{
+				// first chunk density extrapolated to the whole file, with a bit of slack for uneven lines
+				const double pointsPerByte = static_cast<double>(slot.pointsCount) / static_cast<double>(std::max<int64_t>(slot.end - slot.begin, 1));
+				const uint64_t estimatedPointsCount = static_cast<uint64_t>(std::ceil(pointsPerByte * static_cast<double>(m_dataSize) * 1.05));
+				m_sink->Begin(std::min(estimatedPointsCount, m_maxPointsCount), m_origin);
+			}
+
+			// chunks past the limit are still drained, readers and parsers don't know about it
+			if (slot.pointsCount > m_maxPointsCount - pointsCount)
+			{
+				TruncateBlocks(slot.blocks, m_maxPointsCount - pointsCount, m_sink->GetBlockPool());
+				slot.pointsCount = m_maxPointsCount - pointsCount;
+				// happens once per load, reading back the kept points is cheaper than tracking stats per point index
+				slot.stats.Reset();
+				for (const PointBlock* block = slot.blocks; block != nullptr; block = block->next)
+				{
+					slot.stats.Add(block->points, block->count);
+				}
+			}
+			stats.Merge(slot.stats);
+			if (slot.pointsCount != 0)
+			{
+				m_sink->Consume(slot.blocks, slot.pointsCount);
+			}
+			m_sink->GetBlockPool()->Release(slot.blocks);
+			pointsCount += slot.pointsCount;
+			if (m_reader == nullptr)
+			{
+				m_file->ReleaseRange(slot.begin - m_file->GetData(), slot.end - slot.begin);
+			}
+
+			{
+				std::lock_guard lock(m_mutex);
+				slot.state = ChunkState::Free;
+			}
+			m_slotFreed.notify_one();
+		}
+
+		if (m_chunksCount == 0)
+		{
+			m_sink->Begin(0, m_origin);
+		}
+		m_stats = stats.GetStats(m_origin);
+		m_sink->End(m_stats);
+
+		threadManager->WaitAllWorkers();
+		return pointsCount;
+	}
+
+	void PointTextLoader::ComputeOrigin()
+	{
+		if (m_dataSize == 0)
+		{
+			return;
+		}
+
+		std::vector<PointSourceBounds> samplesBounds(ORIGIN_SAMPLES_COUNT);
+		ThreadManager::Get()->ParallelFor(ORIGIN_SAMPLES_COUNT, [this, &samplesBounds](uint64_t sampleIndex, uint32_t)
+		{
+			const char* dataEnd = m_data + m_dataSize;
+			const char* currentPosition = m_data + m_dataSize * sampleIndex / ORIGIN_SAMPLES_COUNT;
+			// samples start at the line after the one they land in
+			if (sampleIndex != 0)
+			{
+				currentPosition = PointTextParser::FindLineEnd(currentPosition, dataEnd);
+				currentPosition += currentPosition != dataEnd;
+			}
+
+			double numbers[VALUES_BUFFER_SIZE];
+			for (uint32_t lineIndex = 0; lineIndex < ORIGIN_SAMPLE_LINES_COUNT && currentPosition < dataEnd; lineIndex++)
+			{
+				if (PointTextParser::ReadLine(currentPosition, dataEnd, numbers) == m_valuesPerPoint)
+				{
+					samplesBounds[sampleIndex].Add(numbers[m_valueIndices.position[0]], numbers[m_valueIndices.position[1]], numbers[m_valueIndices.position[2]]);
+				}
+			}
+		});
+
+		PointSourceBounds bounds;
+		for (const PointSourceBounds& sampleBounds : samplesBounds)
+		{
+			bounds.Add(sampleBounds);
+		}
+		m_origin = bounds.GetCenter();
+	}
+
+	void PointTextLoader::ReadChunks()
+	{
+		const char* data = m_file->GetData();
+		for (uint64_t sequenceIndex = 0; sequenceIndex < m_chunksCount; sequenceIndex++)
+		{
+			ChunkSlot& slot = m_slots[sequenceIndex % m_slots.size()];
+			{
+				std::unique_lock lock(m_mutex);
+				m_slotFreed.wait(lock, [&slot] { return slot.state == ChunkState::Free; });
+			}
+
+			const uint64_t chunkIndex = m_chunkOrder[sequenceIndex];
+			const char* chunkBegin = GetChunkBoundary(chunkIndex);
+			const char* chunkEnd = GetChunkBoundary(chunkIndex + 1);
+			m_file->PrefetchRange(chunkBegin - data, chunkEnd - chunkBegin);
+
+			{
+				std::lock_guard lock(m_mutex);
+				slot.sequenceIndex = sequenceIndex;
+				slot.begin = chunkBegin;
+				slot.end = chunkEnd;
+				slot.state = ChunkState::Read;
+			}
+			QueueChunk(sequenceIndex);
+		}
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_readFinished = true;
+		}
+		m_chunkRead.notify_all();
+	}
+
+	void PointTextLoader::ReadChunksAsync()
+	{
+		const uint64_t dataOffset = m_data - m_file->GetData();
+		const uint64_t fileSize = m_file->GetSize();
+		const uint64_t alignment = AsyncFileReader::ALIGNMENT;
+
+		uint64_t submittedChunksCount = 0;
+		uint64_t readChunksCount = 0;
+		while (readChunksCount < m_chunksCount)
+		{
+			// every slot free in ring order gets a read, until the reader's queue is full
+			while (submittedChunksCount < m_chunksCount && submittedChunksCount - readChunksCount < m_reader->GetQueueDepth())
+			{
+				ChunkSlot& slot = m_slots[submittedChunksCount % m_slots.size()];
+				{
+					std::unique_lock lock(m_mutex);
+					// with reads in flight their completions come first, the slot is checked again after them
+					if (slot.state != ChunkState::Free && submittedChunksCount != readChunksCount)
+					{
+						break;
+					}
+					m_slotFreed.wait(lock, [&slot] { return slot.state == ChunkState::Free; });
+					slot.sequenceIndex = submittedChunksCount;
+					slot.state = ChunkState::Reading;
+				}
+				if (slot.buffer == nullptr)
+				{
+					// chunk plus overlap, and a sector on both sides for the aligned start and end of the read
+					slot.buffer = AsyncFileReader::AllocateBuffer(std::min(m_chunkSize, m_dataSize) + CHUNK_OVERLAP_SIZE + 2 * alignment);
+				}
+
+				const uint64_t submittedChunkIndex = m_chunkOrder[submittedChunksCount];
+				const uint64_t readBegin = (dataOffset + submittedChunkIndex * m_chunkSize) / alignment * alignment;
+				const uint64_t readEnd = (std::min(dataOffset + (submittedChunkIndex + 1) * m_chunkSize + CHUNK_OVERLAP_SIZE, fileSize) + alignment - 1) / alignment * alignment;
+				m_reader->Submit(readBegin, readEnd - readBegin, slot.buffer.get(), submittedChunksCount);
+				submittedChunksCount++;
+			}
+
+			uint64_t sequenceIndex;
+			uint64_t bytesRead;
+			const bool hasCompleted = m_reader->WaitCompletion(sequenceIndex, bytesRead);
+			ASSERT(hasCompleted);
+
+			// same line ownership as GetChunkBoundary, found inside the read instead of the mapping
+			ChunkSlot& slot = m_slots[sequenceIndex % m_slots.size()];
+			const uint64_t chunkIndex = m_chunkOrder[sequenceIndex];
+			const uint64_t readBegin = (dataOffset + chunkIndex * m_chunkSize) / alignment * alignment;
+			const uint64_t readEnd = readBegin + bytesRead;
+			const char* readData = slot.buffer.get();
+			const char* readDataEnd = readData + bytesRead;
+			if (readEnd < std::min(dataOffset + (chunkIndex + 1) * m_chunkSize, fileSize))
+			{
+				Logger::LogFormat("Chunk %llu was read short, %llu bytes at %llu\n", chunkIndex, bytesRead, readBegin);
+			}
+
+			const char* chunkBegin = std::min(readData + (dataOffset + chunkIndex * m_chunkSize - readBegin), readDataEnd);
+			if (chunkIndex != 0)
+			{
+				chunkBegin = PointTextParser::FindLineEnd(chunkBegin, readDataEnd);
+				chunkBegin += chunkBegin != readDataEnd;
+			}
+			const char* chunkEnd = readDataEnd;
+			if (chunkIndex + 1 < m_chunksCount)
+			{
+				chunkEnd = PointTextParser::FindLineEnd(std::min(readData + (dataOffset + (chunkIndex + 1) * m_chunkSize - readBegin), readDataEnd), readDataEnd);
+				if (chunkEnd != readDataEnd)
+				{
+					chunkEnd++;
+				}
+				else if (readEnd < fileSize)
+				{
+					Logger::LogFormat("Line at the end of chunk %llu is longer than %llu bytes, it is cut\n", chunkIndex, CHUNK_OVERLAP_SIZE);
+				}
+			}
+
+			{
+				std::lock_guard lock(m_mutex);
+				slot.begin = chunkBegin;
+				slot.end = std::max(chunkBegin, chunkEnd);
+				slot.state = ChunkState::Read;
+			}
+			QueueChunk(sequenceIndex);
+			readChunksCount++;
+		}
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_readFinished = true;
+		}
+		m_chunkRead.notify_all();
+	}
+
+	void PointTextLoader::QueueChunk(uint64_t sequenceIndex)
+	{
+		{
+			// counter goes up first so a parser can't take it below zero, under the lock so a sleeping parser can't miss it
+			std::lock_guard lock(m_mutex);
+			m_readSlotsCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		m_readSlots.Push(static_cast<uint32_t>(sequenceIndex % m_readSlots.GetQueuesCount()), static_cast<uint32_t>(sequenceIndex % m_slots.size()));
+		m_chunkRead.notify_one();
+	}
+
+	void PointTextLoader::ParseChunks(uint32_t queueIndex)
+	{
+		while (true)
+		{
+			uint32_t slotIndex;
+			if (!m_readSlots.Pop(queueIndex, slotIndex))
+			{
+				std::unique_lock lock(m_mutex);
+				m_chunkRead.wait(lock, [this] { return m_readSlotsCount.load(std::memory_order_relaxed) != 0 || m_readFinished; });
+				if (m_readSlotsCount.load(std::memory_order_relaxed) == 0)
+				{
+					return;
+				}
+				// a chunk is queued somewhere, another parser may still beat us to it
+				continue;
+			}
+			m_readSlotsCount.fetch_sub(1, std::memory_order_relaxed);
+
+			ParseChunk(m_slots[slotIndex]);
+
+			{
+				std::lock_guard lock(m_mutex);
+				m_slots[slotIndex].state = ChunkState::Parsed;
+			}
+			// only the upload stage waits for parsed chunks
+			m_chunkParsed.notify_one();
+		}
+	}
+
+	void PointTextLoader::ParseChunk(ChunkSlot& slot) const
+	{
+		slot.stats.Reset();
+		PointBlockWriter writer(m_sink->GetBlockPool(), &slot.stats);
+
+		// parser fills the first MAX_VALUES_PER_LINE, the rest are defaults for missing attributes
+		double numbers[VALUES_BUFFER_SIZE];
+		numbers[MISSING_COLOR_INDEX] = m_colorMax;
+		numbers[MISSING_INTENSITY_INDEX] = m_intensityMin;
+
+		const ValueIndices& indices = m_valueIndices;
+		const char* currentPosition = slot.begin;
+		while (currentPosition < slot.end)
+		{
+			if (PointTextParser::ReadLine(currentPosition, slot.end, numbers) != m_valuesPerPoint)
+			{
+				continue;
+			}
+			writer.Append(PackPoint(static_cast<float>(numbers[indices.position[0]] - m_origin.x),
+			                        static_cast<float>(numbers[indices.position[1]] - m_origin.y),
+			                        static_cast<float>(numbers[indices.position[2]] - m_origin.z),
+			                        static_cast<float>(numbers[indices.color[0]] * m_colorScale),
+			                        static_cast<float>(numbers[indices.color[1]] * m_colorScale),
+			                        static_cast<float>(numbers[indices.color[2]] * m_colorScale),
+			                        static_cast<float>((numbers[indices.intensity] - m_intensityMin) * m_intensityScale)));
+		}
+
+		slot.blocks = writer.GetHead();
+		slot.pointsCount = writer.GetPointsCount();
+	}
+
+	const char* PointTextLoader::GetChunkBoundary(uint64_t chunkIndex) const
+	{
+		const char* dataEnd = m_data + m_dataSize;
+		if (chunkIndex == 0)
+		{
+			return m_data;
+		}
+		if (chunkIndex >= m_chunksCount)
+		{
+			return dataEnd;
+		}
+
+		const char* boundary = PointTextParser::FindLineEnd(m_data + chunkIndex * m_chunkSize, dataEnd);
+		return boundary + (boundary != dataEnd);
+	}
+}
@@ -0,0 +1,157 @@
+#ifndef POINT_TEXT_LOADER_H
+#define POINT_TEXT_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "PointLoader.h"
+#include "PointSink.h"
+#include "PointTextParser.h"
+#include "DataManager/AsyncFileReader.h"
+#include "DataManager/MappedFile.h"
+#include "ThreadManager/WorkStealingQueue.h"
+
+namespace PointCloudViewer
+{
+	// Column of every point attribute in a line, -1 when lines don't have it
+	struct PointTextColumns
+	{
+		int32_t x = 0;
+		int32_t y = 1;
+		int32_t z = 2;
+		int32_t intensity = 3;
+		int32_t red = 4;
+		int32_t green = 5;
+		int32_t blue = 6;
+	};
+
+	struct PointTextLoaderSettings
+	{
+		// small chunks keep every worker busy until the end of the file, results are ordered by chunk index anyway
+		uint64_t chunkSize = 4ull * 1024ull * 1024ull;
+		// chunks in flight between reading and upload, 0 means four per parsing worker
+		uint32_t ringSize = 0;
+
+		// lines with a different amount of numbers are skipped, defaults are x y z intensity r g b
+		uint32_t valuesPerPoint = 7;
+		PointTextColumns columns;
+
+		// column ranges mapped to unorm, defaults fit 8-bit colours and 12-bit signed scanner intensity
+		double colorMax = 255.0;
+		double intensityMin = -2048.0;
+		double intensityMax = 2047.0;
+
+		// points start at dataOffset, anything after the first maxPointsCount points passed to the sink is dropped
+		uint64_t dataOffset = 0;
+		uint64_t maxPointsCount = UINT64_MAX;
+
+		// chunks go to the sink in progressive rounds instead of file order
+		bool isProgressive = true;
+	};
+
+	// Streaming loader of ascii point clouds: read -> parse -> upload.
+	// A reader worker walks the file chunk by chunk, prefetches it and deals chunks round-robin into
+	// per-worker queues, the rest of workers parse their own chunks and steal from others when idle,
+	// the calling thread hands parsed chunks to the sink in load order, progressive rounds or file order.
+	// A quick parallel pre-pass over sampled lines picks the origin positions are stored relative to,
+	// parsers gather stats of their chunks as they write them.
+	// Only ringSize chunks exist at once, consumed chunks are dropped from the working set
+	// and their output blocks go back to the sink's pool.
+	// With an async reader chunks are read into slot buffers instead, many reads in flight past the page cache,
+	// and each completed read goes straight to the parsers. The mapping is then only touched by the origin pre-pass.
+	class PointTextLoader : public IPointLoader
+	{
+	public:
+		PointTextLoader(const MappedFile* file, IPointSink* sink, const PointTextLoaderSettings& settings = {}, AsyncFileReader* reader = nullptr);
+
+		// Runs the whole pipeline, returns amount of points passed to the sink
+		uint64_t Load() override;
+		[[nodiscard]] PointOrigin GetOrigin() const override { return m_origin; }
+		[[nodiscard]] const PointCloudStats& GetStats() const override { return m_stats; }
+
+	private:
+		enum class ChunkState
+		{
+			Free,
+			Reading,
+			Read,
+			Parsed
+		};
+
+		struct ChunkSlot
+		{
+			ChunkState state = ChunkState::Free;
+			// position of the chunk in load order
+			uint64_t sequenceIndex = 0;
+			const char* begin = nullptr;
+			const char* end = nullptr;
+			PointBlock* blocks = nullptr;
+			uint64_t pointsCount = 0;
+			// filled by the parsing worker, merged in file order so points dropped past maxPointsCount stay out
+			PointStatsAccumulator stats;
+			// async reads only, begin and end point into it
+			AlignedBuffer buffer;
+		};
+
+		// Center of the bounds of lines sampled across the file, parsing everything twice isn't worth the precision
+		void ComputeOrigin();
+		void ReadChunks();
+		void ReadChunksAsync();
+		// Pushes a read slot to its parser's queue
+		void QueueChunk(uint64_t sequenceIndex);
+		void ParseChunks(uint32_t queueIndex);
+		void ParseChunk(ChunkSlot& slot) const;
+
+		// First byte of the first line owned by the chunk, chunks own lines starting inside them
+		[[nodiscard]] const char* GetChunkBoundary(uint64_t chunkIndex) const;
+
+		// Index of every attribute in the parsed values, missing attributes point past the parser output at defaults
+		struct ValueIndices
+		{
+			uint32_t position[3];
+			uint32_t intensity;
+			uint32_t color[3];
+		};
+
+		static constexpr uint32_t MISSING_COLOR_INDEX = PointTextParser::MAX_VALUES_PER_LINE;
+		static constexpr uint32_t MISSING_INTENSITY_INDEX = PointTextParser::MAX_VALUES_PER_LINE + 1;
+		static constexpr uint32_t VALUES_BUFFER_SIZE = PointTextParser::MAX_VALUES_PER_LINE + 2;
+
+		const MappedFile* m_file;
+		IPointSink* m_sink;
+		AsyncFileReader* m_reader;
+		const char* m_data;
+		uint64_t m_dataSize;
+		uint64_t m_chunkSize;
+		uint64_t m_chunksCount;
+		// chunk index at every position of load order
+		std::vector<uint64_t> m_chunkOrder;
+		uint64_t m_maxPointsCount;
+
+		uint32_t m_valuesPerPoint;
+		ValueIndices m_valueIndices;
+		double m_colorMax;
+		double m_colorScale;
+		double m_intensityMin;
+		double m_intensityScale;
+		PointOrigin m_origin;
+		PointCloudStats m_stats;
+
+		std::vector<ChunkSlot> m_slots;
+		// read slot indices, one queue per parsing worker
+		WorkStealingQueues<uint32_t> m_readSlots;
+		// read chunks nobody has taken yet, parsers sleep only when it drops to zero
+		std::atomic<uint32_t> m_readSlotsCount = 0;
+		bool m_readFinished = false;
+
+		std::mutex m_mutex;
+		std::condition_variable m_slotFreed;
+		std::condition_variable m_chunkRead;
+		std::condition_variable m_chunkParsed;
+	};
+}
+
+#endif // POINT_TEXT_LOADER_H
@@ -0,0 +1,489 @@
+#include "PointTextParser.h"
+
+#include <bit>
+#include <cstring>
+#include <type_traits>
+#include <intrin.h>
+#include <immintrin.h>
+
+#include "DecimalConverter.h"
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		// a 64 byte window is classified at once, 16 byte digit loads of its tokens can reach 16 bytes past it
+		constexpr int64_t SIMD_SAFE_DISTANCE = 64 + 16;
+		constexpr uint32_t MAX_MANTISSA_DIGITS = 19;
+
+		bool IsDigit(char c)
+		{
+			return static_cast<uint8_t>(c - '0') < 10;
+		}
+
+		bool IsNumberStart(char c)
+		{
+			return IsDigit(c) || c == '-' || c == '+' || c == '.';
+		}
+
+		ParserInstructionSet DetectInstructionSet()
+		{
+			int info[4];
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+			const bool hasSSSE3 = info[2] & (1 << 9);
+			const bool hasSSE41 = info[2] & (1 << 19);
+			const bool hasSSE42 = info[2] & (1 << 20);
+			const bool hasOSXSave = info[2] & (1 << 27);
+			const bool hasAVX = info[2] & (1 << 28);
+
+			if (!(hasSSSE3 && hasSSE41 && hasSSE42))
+			{
+				return ParserInstructionSet::Scalar;
+			}
+
+			if (maxLeaf >= 7 && hasOSXSave && hasAVX)
+			{
+				__cpuidex(info, 7, 0);
+				const bool hasAVX2 = info[1] & (1 << 5);
+				// OS has to save ymm registers on context switch
+				if (hasAVX2 && (_xgetbv(0) & 0x6) == 0x6)
+				{
+					return ParserInstructionSet::AVX2;
+				}
+			}
+
+			return ParserInstructionSet::SSE42;
+		}
+
+		const ParserInstructionSet g_instructionSet = DetectInstructionSet();
+
+		// Parses optional exponent part "e[sign]digits". Cursor is left at 'e' if there are no digits after it.
+		void ParseExponent(const char*& cursor, const char* end, Decimal& decimal)
+		{
+			if (cursor >= end || (*cursor | 0x20) != 'e')
+			{
+				return;
+			}
+
+			const char* p = cursor + 1;
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+			if (p >= end || !IsDigit(*p))
+			{
+				return;
+			}
+
+			int64_t exponent = 0;
+			while (p < end && IsDigit(*p))
+			{
+				// anything this big is already zero or infinity
+				if (exponent < 0x10000)
+				{
+					exponent = exponent * 10 + (*p - '0');
+				}
+				p++;
+			}
+			decimal.exponent += negative ? -exponent : exponent;
+			cursor = p;
+		}
+
+		// Parses [sign]digits[.digits][e[sign]digits] starting at cursor. Returns false if there were no digits at all.
+		bool ParseDecimalScalar(const char*& cursor, const char* end, Decimal& decimal, const char*& digitsBegin)
+		{
+			decimal = {};
+			if (*cursor == '-' || *cursor == '+')
+			{
+				decimal.negative = *cursor == '-';
+				cursor++;
+			}
+			digitsBegin = cursor;
+
+			uint32_t significantDigits = 0;
+			bool hasDigits = false;
+
+			while (cursor < end && IsDigit(*cursor))
+			{
+				hasDigits = true;
+				if (significantDigits < MAX_MANTISSA_DIGITS)
+				{
+					decimal.mantissa = decimal.mantissa * 10 + (*cursor - '0');
+					significantDigits += decimal.mantissa != 0;
+				}
+				else
+				{
+					decimal.exponent++;
+					decimal.truncated = true;
+				}
+				cursor++;
+			}
+
+			if (cursor < end && *cursor == '.')
+			{
+				cursor++;
+				while (cursor < end && IsDigit(*cursor))
+				{
+					hasDigits = true;
+					if (significantDigits < MAX_MANTISSA_DIGITS)
+					{
+						decimal.mantissa = decimal.mantissa * 10 + (*cursor - '0');
+						significantDigits += decimal.mantissa != 0;
+						decimal.exponent--;
+					}
+					else
+					{
+						decimal.truncated = true;
+					}
+					cursor++;
+				}
+			}
+
+			if (hasDigits)
+			{
+				ParseExponent(cursor, end, decimal);
+			}
+			return hasDigits;
+		}
+
+		struct DigitShuffleTable
+		{
+			// pshufb controls moving integer and fraction digits to the end of a register without the dot between them,
+			// lanes in front of the number have the high bit set and are zeroed
+			alignas(16) int8_t controls[17][17][16];
+
+			constexpr DigitShuffleTable() : controls{}
+			{
+				for (int32_t integerDigits = 0; integerDigits <= 16; integerDigits++)
+				{
+					for (int32_t fractionDigits = 0; fractionDigits <= 16; fractionDigits++)
+					{
+						const int32_t count = integerDigits + fractionDigits;
+						for (int32_t lane = 0; lane < 16; lane++)
+						{
+							const int32_t digit = lane - (16 - count);
+							controls[integerDigits][fractionDigits][lane] = static_cast<int8_t>(
+								digit < 0 ? -1 : digit < integerDigits ? digit : digit + 1);
+						}
+					}
+				}
+			}
+		};
+
+		constexpr DigitShuffleTable g_digitShuffles;
+
+		// Converts digits of [int][.frac] at p with one vector pass, the text has to fit 16 readable bytes at p
+		uint64_t ConvertDigits16(const char* p, uint32_t integerDigits, uint32_t fractionDigits)
+		{
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i digits = _mm_sub_epi8(chunk, _mm_set1_epi8('0'));
+			const __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(g_digitShuffles.controls[integerDigits][fractionDigits]));
+			const __m128i aligned = _mm_shuffle_epi8(digits, shuffle);
+
+			const __m128i pairs = _mm_maddubs_epi16(aligned, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+			const __m128i quads = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+			const __m128i packed = _mm_packus_epi32(quads, quads);
+			const __m128i octets = _mm_madd_epi16(packed, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+			const uint64_t high = static_cast<uint32_t>(_mm_cvtsi128_si32(octets));
+			const uint64_t low = static_cast<uint32_t>(_mm_extract_epi32(octets, 1));
+			return high * 100000000ull + low;
+		}
+
+		template <typename T>
+		bool ParseNumber(const char*& cursor, const char* end, T& value)
+		{
+			Decimal decimal;
+			const char* digitsBegin;
+			if (!ParseDecimalScalar(cursor, end, decimal, digitsBegin))
+			{
+				return false;
+			}
+			if constexpr (std::is_same_v<T, float>)
+			{
+				value = DecimalConverter::ToFloat(decimal, digitsBegin, cursor);
+			}
+			else
+			{
+				value = DecimalConverter::ToDouble(decimal, digitsBegin, cursor);
+			}
+			return true;
+		}
+
+		void StoreValue(double value, double* values, uint32_t& valuesRead)
+		{
+			if (valuesRead < PointTextParser::MAX_VALUES_PER_LINE)
+			{
+				values[valuesRead] = value;
+			}
+			valuesRead++;
+		}
+
+		// Reads numbers of [cursor, end) until the end of the line, non-numeric characters are separators
+		void ReadNumbersScalar(const char*& cursor, const char* end, double* values, uint32_t& valuesRead)
+		{
+			while (cursor < end)
+			{
+				const char c = *cursor;
+				if (c == '\n')
+				{
+					cursor++;
+					return;
+				}
+
+				if (!IsNumberStart(c))
+				{
+					cursor++;
+					continue;
+				}
+
+				Decimal decimal;
+				const char* digitsBegin;
+				if (ParseDecimalScalar(cursor, end, decimal, digitsBegin))
+				{
+					StoreValue(DecimalConverter::ToDouble(decimal, digitsBegin, cursor), values, valuesRead);
+				}
+			}
+		}
+
+		const char* FindLineEndScalar(const char* cursor, const char* end)
+		{
+			const void* found = memchr(cursor, '\n', end - cursor);
+			return found != nullptr ? static_cast<const char*>(found) : end;
+		}
+
+		const char* FindLineEndSSE(const char* cursor, const char* end)
+		{
+			const __m128i newline = _mm_set1_epi8('\n');
+			while (end - cursor >= 16)
+			{
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+				const uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+				if (mask != 0)
+				{
+					return cursor + std::countr_zero(mask);
+				}
+				cursor += 16;
+			}
+			return FindLineEndScalar(cursor, end);
+		}
+
+		const char* FindLineEndAVX2(const char* cursor, const char* end)
+		{
+			const __m256i newline = _mm256_set1_epi8('\n');
+			while (end - cursor >= 32)
+			{
+				const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+				const uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline));
+				if (mask != 0)
+				{
+					return cursor + std::countr_zero(mask);
+				}
+				cursor += 32;
+			}
+			return FindLineEndSSE(cursor, end);
+		}
+
+		// Byte classes of a 64 byte window, bit i describes byte i
+		struct CharacterMasks
+		{
+			uint64_t digits;
+			// digits and every character a number can contain: . - + e E
+			uint64_t numeric;
+			uint64_t dots;
+			uint64_t newlines;
+		};
+
+		CharacterMasks ClassifySSE(const char* p)
+		{
+			CharacterMasks masks = {};
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+				// byte is a digit when (c - '0') as unsigned is not bigger than 9
+				const __m128i shifted = _mm_sub_epi8(chunk, _mm_set1_epi8('0'));
+				const __m128i isDigit = _mm_cmpeq_epi8(_mm_max_epu8(shifted, _mm_set1_epi8(9)), _mm_set1_epi8(9));
+				const __m128i isDot = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('.'));
+				const __m128i isSymbol = _mm_or_si128(
+					_mm_or_si128(isDot, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('-'))),
+					_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('+')),
+					             _mm_cmpeq_epi8(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), _mm_set1_epi8('e'))));
+				const __m128i isNewline = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+
+				const uint64_t digits = static_cast<uint32_t>(_mm_movemask_epi8(isDigit));
+				const uint64_t symbols = static_cast<uint32_t>(_mm_movemask_epi8(isSymbol));
+				const uint64_t dots = static_cast<uint32_t>(_mm_movemask_epi8(isDot));
+				const uint64_t newlines = static_cast<uint32_t>(_mm_movemask_epi8(isNewline));
+				masks.digits |= digits << (i * 16);
+				masks.numeric |= (digits | symbols) << (i * 16);
+				masks.dots |= dots << (i * 16);
+				masks.newlines |= newlines << (i * 16);
+			}
+			return masks;
+		}
+
+		CharacterMasks ClassifyAVX2(const char* p)
+		{
+			CharacterMasks masks = {};
+			for (uint32_t i = 0; i < 2; i++)
+			{
+				const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * 32));
+				const __m256i shifted = _mm256_sub_epi8(chunk, _mm256_set1_epi8('0'));
+				const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_max_epu8(shifted, _mm256_set1_epi8(9)), _mm256_set1_epi8(9));
+				const __m256i isDot = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('.'));
+				const __m256i isSymbol = _mm256_or_si256(
+					_mm256_or_si256(isDot, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('-'))),
+					_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('+')),
+					                _mm256_cmpeq_epi8(_mm256_or_si256(chunk, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('e'))));
+				const __m256i isNewline = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'));
+
+				const uint64_t digits = static_cast<uint32_t>(_mm256_movemask_epi8(isDigit));
+				const uint64_t symbols = static_cast<uint32_t>(_mm256_movemask_epi8(isSymbol));
+				const uint64_t dots = static_cast<uint32_t>(_mm256_movemask_epi8(isDot));
+				const uint64_t newlines = static_cast<uint32_t>(_mm256_movemask_epi8(isNewline));
+				masks.digits |= digits << (i * 32);
+				masks.numeric |= (digits | symbols) << (i * 32);
+				masks.dots |= dots << (i * 32);
+				masks.newlines |= newlines << (i * 32);
+			}
+			return masks;
+		}
+
+		// Converts a run of numeric characters found by the classifier, bit 0 of the masks is at begin.
+		// Plain [sign]int[.frac] numbers that fit one 16 byte load are converted from the masks directly,
+		// everything else (exponents, long mantissas, runs like "1-2") goes through the scalar grammar.
+		// Masks are used instead of branches on characters, signs and dots are random for the predictor.
+		void ReadToken(const char* begin, uint32_t length, uint64_t digits, uint64_t dots, double* values, uint32_t& valuesRead)
+		{
+			Decimal decimal;
+			decimal.negative = *begin == '-';
+			const uint32_t integerBegin = (*begin == '-') | (*begin == '+');
+			const uint32_t integerDigits = std::countr_zero(~(digits >> integerBegin));
+			const uint32_t dotPosition = integerBegin + integerDigits;
+
+			const uint32_t hasDot = (dots >> dotPosition) & 1;
+			const uint32_t fractionDigits = std::countr_zero(~(digits >> dotPosition >> 1)) & (0 - hasDot);
+			const uint32_t textLength = integerDigits + hasDot + fractionDigits;
+
+			if (integerBegin + textLength == length && integerDigits + fractionDigits != 0 && textLength <= 16)
+			{
+				decimal.mantissa = ConvertDigits16(begin + integerBegin, integerDigits, fractionDigits);
+				decimal.exponent = -static_cast<int64_t>(fractionDigits);
+				StoreValue(DecimalConverter::ToDouble(decimal, begin + integerBegin, begin + length), values, valuesRead);
+				return;
+			}
+
+			// token has no newline, so scalar code stops at its end
+			ReadNumbersScalar(begin, begin + length, values, valuesRead);
+		}
+
+		template <ParserInstructionSet InstructionSet>
+		uint32_t ReadLineSIMD(const char*& cursor, const char* end, double* values)
+		{
+			uint32_t valuesRead = 0;
+
+			while (end - cursor >= SIMD_SAFE_DISTANCE)
+			{
+				const CharacterMasks masks = InstructionSet == ParserInstructionSet::AVX2 ? ClassifyAVX2(cursor) : ClassifySSE(cursor);
+				// bits before the first newline of the window
+				const uint64_t lineMask = masks.newlines != 0 ? (masks.newlines & (0 - masks.newlines)) - 1 : ~0ull;
+				const uint64_t numeric = masks.numeric & lineMask;
+				uint64_t tokenStarts = numeric & ~(numeric << 1);
+
+				// without a newline the last token of the window can continue in the next one
+				uint32_t nextWindow = 64;
+				if (masks.newlines == 0 && (numeric >> 63) != 0)
+				{
+					nextWindow = 63 - std::countl_zero(tokenStarts);
+					tokenStarts ^= 1ull << nextWindow;
+					if (nextWindow == 0)
+					{
+						// 64+ numeric characters in a row, not a number this parser can take in one window
+						break;
+					}
+				}
+
+				while (tokenStarts != 0)
+				{
+					const uint32_t start = std::countr_zero(tokenStarts);
+					tokenStarts &= tokenStarts - 1;
+					const uint32_t length = std::countr_zero(~(numeric >> start));
+					ReadToken(cursor + start, length, masks.digits >> start, masks.dots >> start, values, valuesRead);
+				}
+
+				if (masks.newlines != 0)
+				{
+					cursor += std::countr_zero(masks.newlines) + 1;
+					return valuesRead;
+				}
+				cursor += nextWindow;
+			}
+
+			ReadNumbersScalar(cursor, end, values, valuesRead);
+			return valuesRead;
+		}
+	}
+
+	uint32_t PointTextParser::ReadLine(const char*& cursor, const char* end, double* values)
+	{
+		switch (g_instructionSet)
+		{
+		case ParserInstructionSet::AVX2:
+			return ReadLineSIMD<ParserInstructionSet::AVX2>(cursor, end, values);
+		case ParserInstructionSet::SSE42:
+			return ReadLineSIMD<ParserInstructionSet::SSE42>(cursor, end, values);
+		default:
+			{
+				uint32_t valuesRead = 0;
+				ReadNumbersScalar(cursor, end, values, valuesRead);
+				return valuesRead;
+			}
+		}
+	}
+
+	bool PointTextParser::ParseDouble(const char*& cursor, const char* end, double& value)
+	{
+		return ParseNumber(cursor, end, value);
+	}
+
+	bool PointTextParser::ParseFloat(const char*& cursor, const char* end, float& value)
+	{
+		return ParseNumber(cursor, end, value);
+	}
+
+	const char* PointTextParser::FindLineEnd(const char* cursor, const char* end)
+	{
+		switch (g_instructionSet)
+		{
+		case ParserInstructionSet::AVX2:
+			return FindLineEndAVX2(cursor, end);
+		case ParserInstructionSet::SSE42:
+			return FindLineEndSSE(cursor, end);
+		default:
+			return FindLineEndScalar(cursor, end);
+		}
+	}
+
+	ParserInstructionSet PointTextParser::GetInstructionSet()
+	{
+		return g_instructionSet;
+	}
+
+	const char* PointTextParser::GetInstructionSetName()
+	{
+		switch (g_instructionSet)
+		{
+		case ParserInstructionSet::AVX2:
+			return "AVX2";
+		case ParserInstructionSet::SSE42:
+			return "SSE4.2";
+		default:
+			return "scalar";
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef POINT_TEXT_PARSER_H
+#define POINT_TEXT_PARSER_H
+
+#include <cstdint>
+
+namespace PointCloudViewer
+{
+	enum class ParserInstructionSet
+	{
+		Scalar,
+		SSE42,
+		AVX2
+	};
+
+	// Parser of ascii point clouds: one point per line, numbers separated by any non-numeric characters.
+	// Numbers are [sign]digits[.digits][e[sign]digits] and are rounded exactly like strtod/strtof do.
+	// Instruction set is picked once at startup, SIMD paths fall back to scalar code near the end of the data.
+	class PointTextParser
+	{
+	public:
+		static constexpr uint32_t MAX_VALUES_PER_LINE = 16;
+
+		// Reads numbers of the line starting at cursor and moves cursor past the line's '\n'.
+		// Returns amount of numbers found in the line, only first MAX_VALUES_PER_LINE are written to values.
+		static uint32_t ReadLine(const char*& cursor, const char* end, double* values);
+
+		// Parse a single number starting at cursor and move cursor past it. Returns false if there were no digits.
+		static bool ParseDouble(const char*& cursor, const char* end, double& value);
+		static bool ParseFloat(const char*& cursor, const char* end, float& value);
+
+		// Returns pointer to the first '\n' in [cursor, end) or end if there is none.
+		static const char* FindLineEnd(const char* cursor, const char* end);
+
+		[[nodiscard]] static ParserInstructionSet GetInstructionSet();
+		[[nodiscard]] static const char* GetInstructionSetName();
+	};
+}
+
+#endif // POINT_TEXT_PARSER_H
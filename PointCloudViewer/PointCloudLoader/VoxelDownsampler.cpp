@@ -0,0 +1,327 @@
+#include "VoxelDownsampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <immintrin.h>
+#include <limits>
+
+#include "MortonSort.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+#include "Utils/TimeCounter.h"
+
+namespace PointCloudViewer
+{
+	// Points a task accumulates
+	static constexpr uint64_t VOXEL_BLOCK_SIZE = 64 * 1024;
+	// Every worker table is split into partitions by the top hash bits, partitions are merged independently
+	static constexpr uint32_t VOXEL_PARTITION_BITS = 6;
+	static constexpr uint32_t VOXEL_PARTITIONS_COUNT = 1u << VOXEL_PARTITION_BITS;
+	static constexpr uint32_t VOXEL_TABLE_MIN_CAPACITY_BITS = 8;
+	// Slots of this many points are prefetched before any of them is added, a voxel lookup is a cache miss on a large grid
+	static constexpr uint32_t VOXEL_BATCH_SIZE = 16;
+	// Morton codes have 63 bits, so all ones is never a voxel
+	static constexpr uint64_t EMPTY_VOXEL = std::numeric_limits<uint64_t>::max();
+
+	struct VoxelCell
+	{
+		uint64_t code;
+		double positionSum[3];
+		uint64_t colorSum[3];
+		uint64_t intensitySum;
+		uint32_t pointsCount;
+		// representative point, ties go to the smaller index
+		uint32_t pointIndex;
+		// squared distance of the representative to the voxel centre in voxel edges, 0 unless the nearest one is kept
+		float centerDistance;
+	};
+
+	// Fibonacci hashing, the high bits depend on all bits of the code
+	static uint64_t HashVoxel(uint64_t code)
+	{
+		return code * 0x9E3779B97F4A7C15ull;
+	}
+
+	static void MergeVoxel(VoxelCell& cell, const VoxelCell& other)
+	{
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			cell.positionSum[axis] += other.positionSum[axis];
+			cell.colorSum[axis] += other.colorSum[axis];
+		}
+		cell.intensitySum += other.intensitySum;
+		cell.pointsCount += other.pointsCount;
+		if (other.centerDistance < cell.centerDistance || (other.centerDistance == cell.centerDistance && other.pointIndex < cell.pointIndex))
+		{
+			cell.pointIndex = other.pointIndex;
+			cell.centerDistance = other.centerDistance;
+		}
+	}
+
+	// Open addressing with linear probing, doubled once half full
+	class VoxelTable
+	{
+	public:
+		void Add(const VoxelCell& cell, uint64_t hash)
+		{
+			if ((m_count + 1) * 2 > m_cells.size())
+			{
+				Grow();
+			}
+
+			const uint64_t mask = m_cells.size() - 1;
+			for (uint64_t slot = GetSlot(hash); ; slot = (slot + 1) & mask)
+			{
+				VoxelCell& tableCell = m_cells[slot];
+				if (tableCell.code == cell.code)
+				{
+					MergeVoxel(tableCell, cell);
+					return;
+				}
+				if (tableCell.code == EMPTY_VOXEL)
+				{
+					tableCell = cell;
+					m_count++;
+					return;
+				}
+			}
+		}
+
+		void Prefetch(uint64_t hash) const
+		{
+			if (!m_cells.empty())
+			{
+				_mm_prefetch(reinterpret_cast<const char*>(&m_cells[GetSlot(hash)]), _MM_HINT_T0);
+			}
+		}
+
+		[[nodiscard]] const std::vector<VoxelCell>& GetCells() const noexcept { return m_cells; }
+		[[nodiscard]] uint64_t GetCount() const noexcept { return m_count; }
+
+		void Clear()
+		{
+			m_cells = {};
+			m_capacityBits = 0;
+			m_count = 0;
+		}
+
+	private:
+		// bits under the partition ones
+		[[nodiscard]] uint64_t GetSlot(uint64_t hash) const noexcept { return hash << VOXEL_PARTITION_BITS >> (64 - m_capacityBits); }
+
+		void Grow()
+		{
+			std::vector<VoxelCell> cells;
+			cells.swap(m_cells);
+			m_capacityBits = cells.empty() ? VOXEL_TABLE_MIN_CAPACITY_BITS : m_capacityBits + 1;
+			m_cells.resize(1ull << m_capacityBits);
+			for (VoxelCell& cell : m_cells)
+			{
+				cell.code = EMPTY_VOXEL;
+			}
+
+			m_count = 0;
+			for (const VoxelCell& cell : cells)
+			{
+				if (cell.code != EMPTY_VOXEL)
+				{
+					Add(cell, HashVoxel(cell.code));
+				}
+			}
+		}
+
+		std::vector<VoxelCell> m_cells;
+		uint32_t m_capacityBits = 0;
+		uint64_t m_count = 0;
+	};
+
+	static PackedPoint GetVoxelPoint(const VoxelCell& cell, const std::vector<PackedPoint>& points, VoxelRepresentative representative)
+	{
+		PackedPoint point;
+		if (representative == VoxelRepresentative::Centroid)
+		{
+			const double pointsCount = static_cast<double>(cell.pointsCount);
+			point.position = {
+				static_cast<float>(cell.positionSum[0] / pointsCount),
+				static_cast<float>(cell.positionSum[1] / pointsCount),
+				static_cast<float>(cell.positionSum[2] / pointsCount)
+			};
+		}
+		else
+		{
+			point.position = points[cell.pointIndex].position;
+		}
+
+		// averages are rounded to the nearest
+		const uint64_t halfCount = cell.pointsCount / 2;
+		point.color.v = static_cast<uint32_t>((cell.colorSum[0] + halfCount) / cell.pointsCount) |
+			static_cast<uint32_t>((cell.colorSum[1] + halfCount) / cell.pointsCount) << 10 |
+			static_cast<uint32_t>((cell.colorSum[2] + halfCount) / cell.pointsCount) << 20 |
+			3u << 30;
+		point.intensity = static_cast<uint32_t>((cell.intensitySum + halfCount) / cell.pointsCount);
+		return point;
+	}
+
+	std::vector<PackedPoint> DownsampleVoxelGrid(const std::vector<PackedPoint>& points, const VoxelDownsampleSettings& settings)
+	{
+		TIME_PERF("Voxel grid downsampling");
+
+		ASSERT(settings.voxelSize > 0.0f);
+		ASSERT(points.size() <= std::numeric_limits<uint32_t>::max());
+
+		const uint64_t count = points.size();
+		if (count == 0)
+		{
+			return {};
+		}
+
+		// the grid starts at the bounds minimum and has the voxel size as its Morton cell
+		const MortonQuantizer boundsQuantizer = MortonQuantizer::FromPoints(points);
+		const float gridCellsCount = static_cast<float>(1u << MortonQuantizer::MAX_BITS_PER_AXIS);
+		const float extent = boundsQuantizer.GetCellSize() * gridCellsCount;
+		float voxelSize = settings.voxelSize;
+		if (extent > voxelSize * gridCellsCount)
+		{
+			voxelSize = extent / gridCellsCount;
+			Logger::LogFormat("Voxel size grown to %f to fit the bounds\n", voxelSize);
+		}
+		const float* boundsMin = boundsQuantizer.GetBoundsMin();
+		const float gridMin[3] = {boundsMin[0], boundsMin[1], boundsMin[2]};
+		const float gridMax[3] = {gridMin[0] + voxelSize * gridCellsCount, gridMin[1] + voxelSize * gridCellsCount, gridMin[2] + voxelSize * gridCellsCount};
+		const MortonQuantizer quantizer(gridMin, gridMax);
+		const float cellScale = 1.0f / quantizer.GetCellSize();
+		const bool keepsNearest = settings.representative == VoxelRepresentative::NearestToCenter;
+
+		ThreadManager* threadManager = ThreadManager::Get();
+		std::vector<VoxelTable> tables(static_cast<size_t>(threadManager->GetWorkersCount()) * VOXEL_PARTITIONS_COUNT);
+		{
+			TIME_PERF("Voxel accumulation");
+
+			const uint64_t blocksCount = (count + VOXEL_BLOCK_SIZE - 1) / VOXEL_BLOCK_SIZE;
+			threadManager->ParallelFor(blocksCount, [&](uint64_t blockIndex, uint32_t workerIndex)
+			{
+				VoxelTable* workerTables = &tables[static_cast<size_t>(workerIndex) * VOXEL_PARTITIONS_COUNT];
+				const uint64_t end = std::min(count, (blockIndex + 1) * VOXEL_BLOCK_SIZE);
+				VoxelCell batchCells[VOXEL_BATCH_SIZE];
+				uint64_t batchHashes[VOXEL_BATCH_SIZE];
+				for (uint64_t batchBegin = blockIndex * VOXEL_BLOCK_SIZE; batchBegin < end; batchBegin += VOXEL_BATCH_SIZE)
+				{
+					const uint32_t batchSize = static_cast<uint32_t>(std::min<uint64_t>(VOXEL_BATCH_SIZE, end - batchBegin));
+					for (uint32_t batchIndex = 0; batchIndex < batchSize; batchIndex++)
+					{
+						const uint64_t i = batchBegin + batchIndex;
+						const PackedPoint& point = points[i];
+						const float position[3] = {point.position.x, point.position.y, point.position.z};
+						const uint32_t color = point.color.v;
+
+						VoxelCell& cell = batchCells[batchIndex];
+						cell = {
+							quantizer.Encode(point),
+							{position[0], position[1], position[2]},
+							{color & 1023, color >> 10 & 1023, color >> 20 & 1023},
+							point.intensity & 0xFFFF,
+							1,
+							static_cast<uint32_t>(i),
+							0.0f
+						};
+						if (keepsNearest)
+						{
+							for (uint32_t axis = 0; axis < 3; axis++)
+							{
+								const float coordinate = (position[axis] - gridMin[axis]) * cellScale;
+								const float centerOffset = coordinate - std::floor(coordinate) - 0.5f;
+								cell.centerDistance += centerOffset * centerOffset;
+							}
+						}
+
+						batchHashes[batchIndex] = HashVoxel(cell.code);
+						workerTables[batchHashes[batchIndex] >> (64 - VOXEL_PARTITION_BITS)].Prefetch(batchHashes[batchIndex]);
+					}
+
+					for (uint32_t batchIndex = 0; batchIndex < batchSize; batchIndex++)
+					{
+						workerTables[batchHashes[batchIndex] >> (64 - VOXEL_PARTITION_BITS)].Add(batchCells[batchIndex], batchHashes[batchIndex]);
+					}
+				}
+			});
+		}
+
+		// a partition is merged into the largest of its worker tables
+		std::vector<VoxelTable*> partitionTables(VOXEL_PARTITIONS_COUNT);
+		{
+			TIME_PERF("Voxel merge");
+
+			threadManager->ParallelFor(VOXEL_PARTITIONS_COUNT, [&](uint64_t partitionIndex, uint32_t)
+			{
+				VoxelTable* mergedTable = nullptr;
+				for (uint32_t workerIndex = 0; workerIndex < threadManager->GetWorkersCount(); workerIndex++)
+				{
+					VoxelTable& table = tables[workerIndex * VOXEL_PARTITIONS_COUNT + partitionIndex];
+					if (mergedTable == nullptr || table.GetCount() > mergedTable->GetCount())
+					{
+						mergedTable = &table;
+					}
+				}
+				for (uint32_t workerIndex = 0; workerIndex < threadManager->GetWorkersCount(); workerIndex++)
+				{
+					VoxelTable& table = tables[workerIndex * VOXEL_PARTITIONS_COUNT + partitionIndex];
+					if (&table == mergedTable)
+					{
+						continue;
+					}
+					for (const VoxelCell& cell : table.GetCells())
+					{
+						if (cell.code != EMPTY_VOXEL)
+						{
+							mergedTable->Add(cell, HashVoxel(cell.code));
+						}
+					}
+					table.Clear();
+				}
+				partitionTables[partitionIndex] = mergedTable;
+			});
+		}
+
+		std::vector<uint64_t> partitionOffsets(VOXEL_PARTITIONS_COUNT + 1, 0);
+		for (uint32_t partitionIndex = 0; partitionIndex < VOXEL_PARTITIONS_COUNT; partitionIndex++)
+		{
+			partitionOffsets[partitionIndex + 1] = partitionOffsets[partitionIndex] + partitionTables[partitionIndex]->GetCount();
+		}
+		const uint64_t voxelsCount = partitionOffsets[VOXEL_PARTITIONS_COUNT];
+
+		// voxel points come in partition order, then they are put in Morton order like the rest of the pipeline
+		std::vector<PackedPoint> voxelPoints(voxelsCount);
+		std::vector<MortonEntry> entries(voxelsCount);
+		threadManager->ParallelFor(VOXEL_PARTITIONS_COUNT, [&](uint64_t partitionIndex, uint32_t)
+		{
+			uint64_t voxelIndex = partitionOffsets[partitionIndex];
+			for (const VoxelCell& cell : partitionTables[partitionIndex]->GetCells())
+			{
+				if (cell.code != EMPTY_VOXEL)
+				{
+					voxelPoints[voxelIndex] = GetVoxelPoint(cell, points, settings.representative);
+					entries[voxelIndex] = {cell.code, static_cast<uint32_t>(voxelIndex)};
+					voxelIndex++;
+				}
+			}
+			partitionTables[partitionIndex]->Clear();
+		});
+		tables = {};
+
+		RadixSortMortonEntries(entries, quantizer.GetCodeBits());
+		std::vector<PackedPoint> downsampledPoints(voxelsCount);
+		threadManager->ParallelFor((voxelsCount + VOXEL_BLOCK_SIZE - 1) / VOXEL_BLOCK_SIZE, [&](uint64_t blockIndex, uint32_t)
+		{
+			const uint64_t end = std::min(voxelsCount, (blockIndex + 1) * VOXEL_BLOCK_SIZE);
+			for (uint64_t i = blockIndex * VOXEL_BLOCK_SIZE; i < end; i++)
+			{
+				downsampledPoints[i] = voxelPoints[entries[i].index];
+			}
+		});
+
+		Logger::LogFormat("Voxel grid of %f: %llu points to %llu\n", voxelSize, count, voxelsCount);
+		return downsampledPoints;
+	}
+}
@@ -0,0 +1,33 @@
+#ifndef VOXEL_DOWNSAMPLER_H
+#define VOXEL_DOWNSAMPLER_H
+
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace PointCloudViewer
+{
+	// Position an occupied voxel keeps, colour and intensity are always the average of its points
+	enum class VoxelRepresentative
+	{
+		Centroid,
+		// smallest index, the first point in input order
+		First,
+		NearestToCenter
+	};
+
+	struct VoxelDownsampleSettings
+	{
+		// Voxel edge in the units of the positions, grown when the bounds don't fit the 2^21 cells per axis of a Morton code
+		float voxelSize = 0.01f;
+		VoxelRepresentative representative = VoxelRepresentative::Centroid;
+	};
+
+	// Thins the cloud to one point per occupied cubic voxel of the grid anchored at the bounds minimum.
+	// Points are read in blocks on the thread manager workers, each worker accumulates its voxels in its own open addressing
+	// tables keyed by Morton code. Tables are split by hash into partitions, partitions are then merged in parallel.
+	// Voxels come out in Morton order whatever the number of workers.
+	[[nodiscard]] std::vector<PackedPoint> DownsampleVoxelGrid(const std::vector<PackedPoint>& points, const VoxelDownsampleSettings& settings);
+}
+
+#endif // VOXEL_DOWNSAMPLER_H
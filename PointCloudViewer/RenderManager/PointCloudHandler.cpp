@@ -2,78 +2,14 @@
 
 #include "CommonEngineStructs.h"
 #include "IRenderer.h"
-#include "MemoryManager/MemoryManager.h"
-#include "ThreadManager/ThreadManager.h"
+#include "PointCloudLoader/PointDataset.h"
+#include "PointCloudLoader/PointShuffle.h"
+#include "PointCloudLoader/PointTextParser.h"
+#include "Utils/Assert.h"
 #include "Utils/TimeCounter.h"
 
-int char_to_int(char s)
-{
-	return static_cast<int>(s) - 48;
-}
-
-bool is_number(char s)
-{
-	return static_cast<int>(s) >= 48 && static_cast<int>(s) <= 57;
-}
-
-int read_floats(const char* data, float* out, uint64_t& currentPosition, uint64_t endPosition)
-{
-	int floats_read = 0;
-	int sign = 1;
-	int number = 0;
-	bool is_fraction = false;
-	int divider = 1;
-	bool isReadingNumber = false;
-
-	char c = data[currentPosition];
-	currentPosition++;
-
-	while (c != '\n' && currentPosition < endPosition)
-	{
-		if (c == '-')
-		{
-			sign = -1;
-		}
-		else if (is_number(c))
-		{
-			isReadingNumber = true;
-			number = number * 10 + char_to_int(c);
-			if (is_fraction)
-			{
-				divider *= 10;
-			}
-		}
-		else if (c == '.')
-		{
-			is_fraction = true;
-		}
-		else
-		{
-			if (isReadingNumber)
-			{
-				out[floats_read] = static_cast<float>(number * sign) / divider;
-				floats_read += 1;
-			}
-
-			sign = 1;
-			number = 0;
-			is_fraction = false;
-			divider = 1;
-			isReadingNumber = false;
-		}
-
-		c = data[currentPosition];
-		currentPosition++;
-	}
-
-	if (isReadingNumber)
-	{
-		out[floats_read] = static_cast<float>(number * sign) / divider;
-		floats_read += 1;
-	}
-
-	return floats_read;
-}
+// Leaves are culled as a whole, this many points keep the draw calls of a frame in the thousands
+static constexpr uint32_t HIERARCHY_LEAF_POINTS_COUNT = 16 * 1024;
 
 PointCloudViewer::PointCloudHandler::PointCloudHandler()
 {
@@ -94,89 +30,153 @@ PointCloudViewer::PointCloudHandler::PointCloudHandler()
 		.topology = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT
 	};
 	m_graphicsPipeline = std::make_unique<GraphicsPipeline>(args);
+	m_sink = std::make_unique<GpuPointSink>();
+}
 
-	const uint32_t concurrency = ThreadManager::Get()->GetWorkersCount();
-	std::vector<BufferUploadPayload> bufferUploadPayloads(concurrency);
-	std::atomic_uint64_t totalLinesRead = 0;
+PointCloudViewer::PointCloudHandler::~PointCloudHandler()
+{
+	// renderer has stopped and waited for its queue, a reorder waiting for frames would wait forever.
+	// Stopping is set first, a suspend that resets the idle flag after this store sees it.
+	m_isStopping.store(true);
+	m_isPointBufferIdle.store(true);
+	m_isPointBufferIdle.notify_all();
 
+	if (m_loadingThread.joinable())
 	{
-		TIME_PERF_HIGHRES("File read");
+		m_loadingThread.join();
+	}
+}
 
-		FILE* fp;
-		fopen_s(&fp, "Data/test/stgallencathedral_station1_intensity_rgb.txt", "rb");
-		//fopen_s(&fp, "Data/test/test.txt", "rb");
-		fseek(fp, 0L, SEEK_END);
-		uint64_t fileSize = ftell(fp);
-		char* fileData = static_cast<char*>(malloc(fileSize));
-		fseek(fp, 0L, 0);
-		fread(fileData, fileSize, 1, fp);
-		fclose(fp);
+void PointCloudViewer::PointCloudHandler::StartLoading()
+{
+	// a .dataset manifest merges scan stations, any other file is loaded as a single station
+	const std::string path = "test/stgallencathedral_station1_intensity_rgb.txt";
+	//const std::string path = "test/stgallencathedral.dataset";
+	//const std::string path = "test/test.txt";
 
+	ASSERT(!m_loadingThread.joinable());
+	m_loadingThread = std::thread(&PointCloudHandler::LoadPoints, this, path);
+}
 
-		for (uint32_t workerIndex = 0; workerIndex < concurrency; workerIndex++)
-		{
-			ThreadManager::Get()->StartWorker(workerIndex, [fileData, workerIndex, concurrency, fileSize, &totalLinesRead, &bufferUploadPayloads]()
-			{
-				const uint64_t fileChunk = fileSize / concurrency;
-				uint64_t startPosition = workerIndex * fileChunk;
-				if (workerIndex > 0)
-				{
-					char c;
-					do
-					{
-						c = fileData[startPosition];
-						startPosition++;
-					}
-					while (c != '\n' && startPosition != fileSize);
-				}
-				uint64_t endPosition = (workerIndex + 1) * fileChunk;
-				if (workerIndex + 1 == concurrency)
-				{
-					endPosition = fileSize;
-				}
-				else
-				{
-					char c;
-					do
-					{
-						c = fileData[endPosition];
-						endPosition++;
-					}
-					while (c != '\n' && endPosition != fileSize);
-				}
-
-				const MappedAreaHandle mappedHandle = bufferUploadPayloads[workerIndex].m_stagingBuffer->Map();
-				Vertex* bufferData = static_cast<Vertex*>(mappedHandle.GetPtr());
-
-				float numbers[8];
-				int linesRead = 0;
-				uint64_t currentPosition = startPosition;
-				while (read_floats(fileData, numbers, currentPosition, endPosition) == 7)
-				{
-					bufferData[linesRead].position = {numbers[0], numbers[1], numbers[2]};
-					linesRead++;
-				}
-				bufferUploadPayloads[workerIndex].m_dataSize = linesRead * sizeof(Vertex);
-
-				Logger::LogFormat("Lines read: %d\n", linesRead);
-				totalLinesRead.fetch_add(linesRead);
-			});
-		}
-
-		ThreadManager::Get()->WaitAllWorkers();
-		Logger::LogFormat("Total ines read: %d\n", totalLinesRead.load());
-		free(fileData);
+void PointCloudViewer::PointCloudHandler::BeginFrame(uint64_t frameNumber, uint64_t completedFramesCount)
+{
+	if (!m_isDrawingSuspended.load(std::memory_order_acquire))
+	{
+		m_isDrawingPoints = true;
+		return;
 	}
 
+	if (m_isDrawingPoints)
 	{
-		TIME_PERF_HIGHRES("Uploading data");
+		m_isDrawingPoints = false;
+		m_firstSuspendedFrame = frameNumber;
+	}
+	// frames before the first suspended one are the last to read the buffer
+	if (completedFramesCount >= m_firstSuspendedFrame && !m_isPointBufferIdle.load(std::memory_order_relaxed))
+	{
+		m_isPointBufferIdle.store(true, std::memory_order_release);
+		m_isPointBufferIdle.notify_all();
+	}
+}
 
-		m_pointCloudBuffer = std::make_unique<UAVGpuBuffer>(
-		   totalLinesRead.load(),
-		   sizeof(Vertex)
-	   );
-		m_pointsNumber = totalLinesRead.load();
+void PointCloudViewer::PointCloudHandler::LoadPoints(const std::string& path)
+{
+	TIME_PERF_HIGHRES("Loading point cloud");
+
+	const auto loadStartTime = std::chrono::high_resolution_clock::now();
+
+	// shuffle and hierarchy need the whole cloud in system memory and the GPU buffer can't be read back.
+	// A lone station reads it back from its cache after loading, merged stations have no cache of the cloud and keep it while they load.
+	std::vector<DatasetStation> stations = ReadPointDataset(path);
+	const bool isRetained = !PointDatasetLoader::IsLoneStation(stations);
+	RetainingPointSink retainingSink(m_sink.get());
+	PointDatasetLoader loader(std::move(stations), isRetained ? static_cast<IPointSink*>(&retainingSink) : m_sink.get());
+	const uint64_t pointsNumber = loader.Load();
+	m_stats = loader.GetStats();
+	m_isLoaded.store(true, std::memory_order_release);
+	if (IsStopping())
+	{
+		return;
+	}
+
+	const double loadTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - loadStartTime).count();
+	const PointOrigin origin = loader.GetOrigin();
+	Logger::LogFormat("Loaded %llu points, %.3f GB at %.3f GB/s (%s)\n",
+	                  pointsNumber,
+	                  static_cast<double>(loader.GetSourceSize()) / 1e9,
+	                  static_cast<double>(loader.GetSourceSize()) / 1e9 / loadTime,
+	                  PointTextParser::GetInstructionSetName());
+	Logger::LogFormat("Point cloud origin %.3f %.3f %.3f\n", origin.x, origin.y, origin.z);
+	Logger::LogFormat("Bounds %.3f %.3f %.3f - %.3f %.3f %.3f, centroid %.3f %.3f %.3f, intensity %.3f - %.3f\n",
+	                  m_stats.boundsMin[0], m_stats.boundsMin[1], m_stats.boundsMin[2],
+	                  m_stats.boundsMax[0], m_stats.boundsMax[1], m_stats.boundsMax[2],
+	                  m_stats.centroid[0], m_stats.centroid[1], m_stats.centroid[2],
+	                  m_stats.intensityMin, m_stats.intensityMax);
+
+	std::vector<PackedPoint> points = isRetained ? retainingSink.TakePoints() : loader.ReadLoadedPoints();
+	if (points.size() != pointsNumber)
+	{
+		Logger::LogFormat("Loaded points can't be read back from the cache, the cloud stays in load order\n");
+		return;
+	}
+
+	if (loader.IsShuffled())
+	{
+		m_isShuffled.store(true, std::memory_order_release);
+	}
+	else if (IsStopping() || !ShufflePoints(loader, points))
+	{
+		return;
+	}
+
+	if (!IsStopping())
+	{
+		BuildHierarchy(std::move(points));
+	}
+}
+
+bool PointCloudViewer::PointCloudHandler::ShufflePoints(const PointDatasetLoader& loader, std::vector<PackedPoint>& points)
+{
+	TIME_PERF_HIGHRES("Shuffling point cloud");
+
+	PointCloudViewer::ShufflePoints(points);
+	if (!OverwritePoints(points, m_isShuffled))
+	{
+		return false;
+	}
+	loader.StoreShuffledPoints(points);
+	return true;
+}
+
+void PointCloudViewer::PointCloudHandler::BuildHierarchy(std::vector<PackedPoint> points)
+{
+	TIME_PERF_HIGHRES("Building point hierarchy");
+
+	m_hierarchy = PointBvh::Build(points, HIERARCHY_LEAF_POINTS_COUNT);
+	OverwritePoints(points, m_hasHierarchy);
+}
+
+bool PointCloudViewer::PointCloudHandler::OverwritePoints(const std::vector<PackedPoint>& points, std::atomic<bool>& orderFlag)
+{
+	if (!SuspendDrawing())
+	{
+		return false;
+	}
+	m_sink->OverwritePoints(points);
+	orderFlag.store(true, std::memory_order_release);
+	m_isDrawingSuspended.store(false, std::memory_order_release);
+	return true;
+}
 
-		MemoryManager::Get()->LoadDataToBuffer(bufferUploadPayloads, m_pointCloudBuffer->GetBuffer());
+bool PointCloudViewer::PointCloudHandler::SuspendDrawing()
+{
+	// reset before the request and before stopping is checked, the destructor either sees the reset or is seen here
+	m_isPointBufferIdle.store(false);
+	m_isDrawingSuspended.store(true, std::memory_order_release);
+	if (IsStopping())
+	{
+		return false;
 	}
+	m_isPointBufferIdle.wait(false);
+	return !IsStopping();
 }
@@ -1,26 +1,92 @@
 ﻿#ifndef POINTCLOUD_HANDLER_H
 #define POINTCLOUD_HANDLER_H
 
+#include <atomic>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "PointCloudLoader/GpuPointSink.h"
+#include "PointCloudLoader/PointBvh.h"
+#include "PointCloudLoader/PointCloudStats.h"
+#include "PointCloudLoader/PointDataset.h"
+#include "PointCloudLoader/PointOrigin.h"
 #include "ResourceManager/Buffers/UAVGpuBuffer.h"
 #include "ResourceManager/Pipelines/GraphicsPipeline.h"
 
 namespace PointCloudViewer
 {
+	// Loads the point cloud on a thread of its own while the renderer draws whatever is committed so far.
+	// Loaders pass points in progressive rounds, so a growing uniform subset of the cloud shows up first.
+	// Once loaded, the points are shuffled so any prefix of the buffer is a uniform subsample, drawing fewer points is a cheaper LOD.
+	// Shuffled order goes into the cache, the next load of the same cloud skips the shuffle.
+	// Last, the points are regrouped into the leaves of a hierarchy for culling, leaves keep the shuffled order inside them.
+	// A reorder rewrites the whole buffer, frames draw no points while it does and pick up the new order together.
 	class PointCloudHandler
 	{
 	public:
 		PointCloudHandler();
+		~PointCloudHandler();
+
+		// Render resources are created by the render thread during init, loading uploads from another thread after it
+		void StartLoading();
+
+		// Render thread, every frame before anything below is read. Frames are numbered from 0, the first completedFramesCount
+		// of them are done on the GPU.
+		void BeginFrame(uint64_t frameNumber, uint64_t completedFramesCount);
+		// Whether the frame begun last may draw the point buffer
+		[[nodiscard]] bool IsDrawingPoints() const noexcept { return m_isDrawingPoints; }
+
 		[[nodiscard]] GraphicsPipeline* GetGraphicsPipeline() const noexcept { return m_graphicsPipeline.get(); }
-		[[nodiscard]] UAVGpuBuffer* GetPointBuffer() const noexcept { return m_pointCloudBuffer.get(); }
-		[[nodiscard]] uint64_t GetPointsNumber() const noexcept { return m_pointsNumber; }
+		// Points committed so far, read it before the buffer
+		[[nodiscard]] uint64_t GetPointsNumber() const noexcept { return m_sink->GetPointsCount(); }
+		[[nodiscard]] UAVGpuBuffer* GetPointBuffer() const noexcept { return m_sink->GetBuffer(); }
+		// World position the point buffer is relative to, valid once GetPointsNumber isn't zero
+		[[nodiscard]] const PointOrigin& GetOrigin() const noexcept { return m_sink->GetOrigin(); }
+		[[nodiscard]] bool IsLoaded() const noexcept { return m_isLoaded.load(std::memory_order_acquire); }
+		// Valid once IsLoaded
+		[[nodiscard]] const PointCloudStats& GetStats() const noexcept { return m_stats; }
+		// Prefixes of the point buffer are uniform subsamples from now on
+		[[nodiscard]] bool IsShuffled() const noexcept { return m_isShuffled.load(std::memory_order_acquire); }
+		// Buffer is in hierarchy order from now on, prefixes of the leaves are the subsamples instead of prefixes of the buffer
+		[[nodiscard]] bool HasHierarchy() const noexcept { return m_hasHierarchy.load(std::memory_order_acquire); }
+		// Valid once HasHierarchy, bounds are relative to the origin
+		[[nodiscard]] const PointBvh& GetHierarchy() const noexcept { return m_hierarchy; }
 
 	private:
-		std::unique_ptr<UAVGpuBuffer> m_pointCloudBuffer;
+		void LoadPoints(const std::string& path);
+		// Parallel reorder of the loaded cloud, uploaded over the committed points and stored into the cache.
+		// False when the handler stopped before the upload.
+		bool ShufflePoints(const PointDatasetLoader& loader, std::vector<PackedPoint>& points);
+		// Morton-sorted leaves of the shuffled cloud, uploaded over the committed points
+		void BuildHierarchy(std::vector<PackedPoint> points);
+		// Uploads the points over the committed ones while no frame reads the buffer, the flag of the new order is set
+		// before frames draw again. False when the handler stopped, nothing is uploaded then.
+		bool OverwritePoints(const std::vector<PackedPoint>& points, std::atomic<bool>& orderFlag);
+		// Stops frames from drawing points and waits until the ones that drew are done on the GPU.
+		// False when the handler stopped, no frame comes to release the wait then.
+		bool SuspendDrawing();
+		[[nodiscard]] bool IsStopping() const noexcept { return m_isStopping.load(); }
+
+		std::unique_ptr<GpuPointSink> m_sink;
 		std::unique_ptr<GraphicsPipeline> m_graphicsPipeline;
 
-		uint64_t m_pointsNumber = 0;
+		std::thread m_loadingThread;
+		std::atomic<bool> m_isLoaded = false;
+		std::atomic<bool> m_isShuffled = false;
+		std::atomic<bool> m_hasHierarchy = false;
+
+		// set by the destructor, loading skips the stages left
+		std::atomic<bool> m_isStopping = false;
+		std::atomic<bool> m_isDrawingSuspended = false;
+		// set by the render thread once no frame recorded or in flight reads the point buffer
+		std::atomic<bool> m_isPointBufferIdle = false;
+		// render thread only
+		bool m_isDrawingPoints = false;
+		uint64_t m_firstSuspendedFrame = 0;
+		PointCloudStats m_stats;
+		PointBvh m_hierarchy;
 	};
 }
 
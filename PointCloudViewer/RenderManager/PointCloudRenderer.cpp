@@ -1,5 +1,6 @@
 #include "PointCloudRenderer.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "imgui.h"
@@ -7,11 +8,13 @@
 #include "backends/imgui_impl_win32.h"
 
 #include "Utils/Assert.h"
+#include "Utils/Log.h"
 
 #include "Common/CommandQueue.h"
 #include "ResourceManager/Mesh.h"
 #include "Components/Camera.h"
 #include "RenderManager/Tonemapping.h"
+#include "RenderManager/PointPrefetcher.h"
 
 #include "Common/Time.h"
 #include "DescriptorManager/DescriptorManager.h"
@@ -45,6 +48,14 @@ namespace PointCloudViewer
 		}
 	}
 
+	PointCloudRenderer::~PointCloudRenderer()
+	{
+		if (m_replayThread.joinable())
+		{
+			m_replayThread.join();
+		}
+	}
+
 	void PointCloudRenderer::Init()
 	{
 		TIME_PERF("PointCloudRenderer init")
@@ -143,6 +154,8 @@ namespace PointCloudViewer
 	void PointCloudRenderer::Start() const
 	{
 		m_queue->WaitQueueIdle();
+
+		m_pointCloudHandler->StartLoading();
 	}
 
 
@@ -169,6 +182,17 @@ namespace PointCloudViewer
 		m_currentCamera = nullptr;
 	}
 
+	// Points are stored relative to the origin, so the camera is moved into their space rather than the points into the world.
+	// Subtracted in double and narrowed after, a view built around a georeferenced float position carries its half metre steps.
+	static math::vec3 GetOriginRelativePosition(const math::vec3& position, const PointOrigin& origin)
+	{
+		return {
+			static_cast<float>(static_cast<double>(position.x) - origin.x),
+			static_cast<float>(static_cast<double>(position.y) - origin.y),
+			static_cast<float>(static_cast<double>(position.z) - origin.z)
+		};
+	}
+
 	void PointCloudRenderer::PreUpdate()
 	{
 		ImGui_ImplDX12_NewFrame();
@@ -182,6 +206,10 @@ namespace PointCloudViewer
 
 		m_queue->WaitForFence(m_currentFrameIndex);
 
+		// the frame that had this back buffer FRAME_COUNT frames ago is done, so are all before it
+		m_pointCloudHandler->BeginFrame(m_frameNumber, m_frameNumber >= FRAME_COUNT ? m_frameNumber - FRAME_COUNT + 1 : 0);
+		m_frameNumber++;
+
 		m_queue->ResetForFrame(m_currentFrameIndex);
 
 		const auto commandList = m_queue->GetCommandList(m_currentFrameIndex);
@@ -198,6 +226,15 @@ namespace PointCloudViewer
 			.proj = mainCameraProjMatrix
 		};
 
+		// points keep streaming in while loading, count goes first so the buffer and origin read after it cover it
+		const uint64_t pointsNumber = m_pointCloudHandler->GetPointsNumber();
+		const math::vec3 cameraPosition = m_currentCamera->GetGameObject().GetTransform().GetPosition();
+		const math::vec3 pointsCameraPosition = pointsNumber != 0 ? GetOriginRelativePosition(cameraPosition, m_pointCloudHandler->GetOrigin()) : cameraPosition;
+		ViewProjectionMatrixData pointsMatrixVP = {
+			.view = m_currentCamera->GetViewMatrix(pointsCameraPosition),
+			.proj = mainCameraProjMatrix
+		};
+
 		{
 			const DynamicCpuBuffer<EngineData>* engineDataBuffer = EngineDataProvider::Get()->GetEngineDataBuffer();
 
@@ -251,12 +288,33 @@ namespace PointCloudViewer
 			commandList->SetGraphicsRootSignature(pipeline->GetRootSignature().Get());
 			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
 
-			GraphicsUtils::AttachView(commandList, pipeline, "points", m_pointCloudHandler->GetPointBuffer()->GetSRV());
-			GraphicsUtils::ProcessEngineBindings(commandList, pipeline, m_currentFrameIndex, nullptr,
-				&mainCameraMatrixVP);
-
-			commandList->DrawInstanced(
-				m_pointCloudHandler->GetPointsNumber(), 1, 0, 0);
+			if (pointsNumber != 0 && m_pointCloudHandler->IsDrawingPoints())
+			{
+				GraphicsUtils::AttachView(commandList, pipeline, "points", m_pointCloudHandler->GetPointBuffer()->GetSRV());
+				GraphicsUtils::ProcessEngineBindings(commandList, pipeline, m_currentFrameIndex, nullptr,
+					&pointsMatrixVP);
+
+				const uint64_t pointBudget = static_cast<uint64_t>(static_cast<double>(m_pointBudget) * 1e6);
+				if (m_pointCloudHandler->HasHierarchy())
+				{
+					// frustum and camera are taken in the origin-relative space of the hierarchy bounds
+					const PointLodSettings lodSettings = {.pointBudget = pointBudget};
+					const std::vector<PointDrawRange>& ranges = m_lodSelector.Select(
+						m_pointCloudHandler->GetHierarchy(), m_currentCamera->GetFrustum(pointsMatrixVP.view), GetPointLodView(pointsCameraPosition), lodSettings);
+					for (const PointDrawRange& range : ranges)
+					{
+						commandList->DrawInstanced(
+							static_cast<UINT>(range.pointsCount), 1, static_cast<UINT>(range.pointsOffset), 0);
+					}
+				}
+				else
+				{
+					// budget only cuts the vertex count, the prefix is a coarser version of the whole cloud
+					const uint64_t drawnPointsNumber = std::clamp<uint64_t>(pointBudget, 1, pointsNumber);
+					commandList->DrawInstanced(
+						static_cast<UINT>(drawnPointsNumber), 1, 0, 0);
+				}
+			}
 
 			m_colorBuffer->BarrierColorToRead(commandList);
 		}
@@ -303,8 +361,56 @@ namespace PointCloudViewer
 		ASSERT_SUCC(m_swapChain->Present(0, presentFlags));
 	}
 
+	PointLodView PointCloudRenderer::GetPointLodView(const math::vec3& cameraPosition) const
+	{
+		return {
+			.position = {cameraPosition.x, cameraPosition.y, cameraPosition.z},
+			.projectionScale = PointLodSelector::GetProjectionScale(m_currentCamera->GetFovRadians(), GetHeight_f())
+		};
+	}
+
+	void PointCloudRenderer::StartCameraTraceReplay()
+	{
+		if (m_isReplaying.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		if (m_replayThread.joinable())
+		{
+			m_replayThread.join();
+		}
+
+		// the camera belongs to the render thread, the hierarchy and origin don't change once built
+		const CameraTraceProjection projection = {
+			.fovRadians = m_currentCamera->GetFovRadians(),
+			.aspect = m_currentCamera->GetAspect(),
+			.nearPlane = m_currentCamera->GetNear(),
+			.farPlane = m_currentCamera->GetFar()
+		};
+		m_isReplaying.store(true, std::memory_order_release);
+		m_replayThread = std::thread([this, projection]
+		{
+			CameraTrace trace;
+			if (trace.Load(std::filesystem::current_path() / "camera_trace.bin") && !trace.IsEmpty())
+			{
+				PointStreamingReplaySettings settings;
+				for (const bool prefetch : {false, true})
+				{
+					settings.prefetch.lookAheadSteps = prefetch ? PointPrefetchSettings().lookAheadSteps : 0;
+					const PointResidencyStats stats = PointPrefetcher::Replay(
+						m_pointCloudHandler->GetHierarchy(), m_pointCloudHandler->GetOrigin(), trace, projection, settings);
+					const uint64_t requests = std::max<uint64_t>(stats.hits + stats.misses, 1);
+					Logger::LogFormat("Camera trace %s prefetch: %.2f%% hits, %llu misses, %llu evictions, %llu loads, %llu prefetched, %llu prefetch hits\n",
+					                  prefetch ? "with" : "without", 100.0 * static_cast<double>(stats.hits) / static_cast<double>(requests),
+					                  stats.misses, stats.evictions, stats.loads, stats.prefetches, stats.prefetchHits);
+				}
+			}
+			m_isReplaying.store(false, std::memory_order_release);
+		});
+	}
+
 	void PointCloudRenderer::DrawGui(ID3D12GraphicsCommandList* commandList,
-	                                 const ViewProjectionMatrixData* viewProjectionData) const
+	                                 const ViewProjectionMatrixData* viewProjectionData)
 	{
 		// Draw axis gizmo
 		{
@@ -346,13 +452,28 @@ namespace PointCloudViewer
 				0, 0);
 		}
 		float windowPosY = 0;
-		float windowHeight = 100;
+		float windowHeight = 165;
 		ImGui::SetNextWindowPos({0, windowPosY});
 		ImGui::SetNextWindowSize({300, windowHeight});
 		{
 			ImGui::Begin("Stats:");
 			//ImGui::Text("Screen: %dx%d", m_width, m_height);
-			ImGui::Text("Num triangles %d", m_pointCloudHandler->GetPointsNumber());
+			ImGui::Text("Num triangles %llu%s", m_pointCloudHandler->GetPointsNumber(),
+			            !m_pointCloudHandler->IsLoaded() ? " loading" : !m_pointCloudHandler->IsShuffled() ? " shuffling" : "");
+			ImGui::SliderFloat("Point budget", &m_pointBudget, 0.1f, 100.0f, "%.1f M");
+			if (m_pointCloudHandler->HasHierarchy())
+			{
+				ImGui::Text("Drawn %llu of %llu visible, %.1f px", m_lodSelector.GetSelectedPointsCount(), m_lodSelector.GetVisiblePointsCount(),
+				            m_lodSelector.GetScreenError());
+				if (m_isReplaying.load(std::memory_order_acquire))
+				{
+					ImGui::Text("Replaying camera trace");
+				}
+				else if (ImGui::Button("Replay camera trace"))
+				{
+					StartCameraTraceReplay();
+				}
+			}
 			const math::vec3 camPos = m_currentCamera->GetGameObject().GetTransform().GetPosition();
 			ImGui::Text("Camera: %.3f %.3f %.3f", camPos.x, camPos.y, camPos.z);
 			ImGui::End();
@@ -2,8 +2,10 @@
 #define RENDER_MANAGER_H
 
 #include <array>
+#include <atomic>
 #include <set>
 #include <memory>
+#include <thread>
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
@@ -12,6 +14,7 @@
 #include "ColorBuffer.h"
 #include "CommonEngineStructs.h"
 #include "PointCloudHandler.h"
+#include "PointLodSelector.h"
 #include "RenderManager/IRenderer.h"
 #include "Common/CommandQueue.h"
 #include "RenderManager/Tonemapping.h"
@@ -38,7 +41,7 @@ namespace PointCloudViewer
 
 		explicit PointCloudRenderer(HWND windowHandle);
 
-		~PointCloudRenderer() override = default;
+		~PointCloudRenderer() override;
 
 		void Init() override;
 
@@ -50,7 +53,7 @@ namespace PointCloudViewer
 
 		void Update() override;
 
-		void DrawGui(ID3D12GraphicsCommandList* commandList, const ViewProjectionMatrixData* viewProjectionData) const;
+		void DrawGui(ID3D12GraphicsCommandList* commandList, const ViewProjectionMatrixData* viewProjectionData);
 
 		void RegisterCamera(Camera* camera) override;
 
@@ -74,6 +77,13 @@ namespace PointCloudViewer
 			ID3D12Resource* copyResource
 		);
 
+		// Camera position and scale of the LOD selection, the position already in the origin-relative space of the points
+		[[nodiscard]] PointLodView GetPointLodView(const math::vec3& cameraPosition) const;
+
+		// Streams the hierarchy along the recorded camera_trace.bin with and without prefetching on a thread of its own
+		// and logs the hit rates. Does nothing while the previous replay runs.
+		void StartCameraTraceReplay();
+
 	private:
 		static constexpr uint32_t FRAME_COUNT = 3;
 
@@ -85,11 +95,19 @@ namespace PointCloudViewer
 		std::unique_ptr<Tonemapping> m_tonemapping;
 
 		std::unique_ptr<PointCloudHandler> m_pointCloudHandler;
+		// Points drawn each frame, in millions. Before the hierarchy is built it is a prefix of the shuffled buffer.
+		float m_pointBudget = static_cast<float>(PointLodSettings().pointBudget) / 1e6f;
+		PointLodSelector m_lodSelector;
+		// reads the hierarchy of the handler, joined before the handler goes away
+		std::thread m_replayThread;
+		std::atomic<bool> m_isReplaying = false;
 
 		Camera* m_currentCamera;
 
 		std::unique_ptr<CommandQueue> m_queue;
 		uint32_t m_currentFrameIndex;
+		// frames recorded so far
+		uint64_t m_frameNumber = 0;
 
 		uint32_t m_width;
 		uint32_t m_height;
@@ -0,0 +1,103 @@
+#include "PointCuller.h"
+
+#include <algorithm>
+
+namespace PointCloudViewer
+{
+	const std::vector<VisiblePointRange>& PointCuller::Cull(const PointBvh& hierarchy, const Frustum& frustum)
+	{
+		m_level.clear();
+		m_leafRanges.clear();
+		m_ranges.clear();
+		m_testedNodesCount = 0;
+		m_visiblePointsCount = 0;
+		if (hierarchy.IsEmpty())
+		{
+			return m_ranges;
+		}
+
+		const std::vector<InternalNode>& internalNodes = hierarchy.GetInternalNodes();
+		const std::vector<AABB>& internalBounds = hierarchy.GetInternalBounds();
+		const std::vector<AABB>& leafBounds = hierarchy.GetLeafBounds();
+
+		m_level.push_back({0, hierarchy.GetRootType()});
+		while (!m_level.empty())
+		{
+			m_nextLevel.clear();
+			for (size_t batchBegin = 0; batchBegin < m_level.size(); batchBegin += 4)
+			{
+				const uint32_t batchSize = static_cast<uint32_t>(std::min<size_t>(4, m_level.size() - batchBegin));
+
+				FrustumBoxBatch batch;
+				for (uint32_t lane = 0; lane < 4; lane++)
+				{
+					// spare lanes repeat the last node, their results are ignored
+					const NodeReference& node = m_level[batchBegin + std::min(lane, batchSize - 1)];
+					const AABB& bounds = node.type == LEAF_NODE ? leafBounds[node.index] : internalBounds[node.index];
+					batch.minX[lane] = bounds.min.x;
+					batch.minY[lane] = bounds.min.y;
+					batch.minZ[lane] = bounds.min.z;
+					batch.maxX[lane] = bounds.max.x;
+					batch.maxY[lane] = bounds.max.y;
+					batch.maxZ[lane] = bounds.max.z;
+				}
+
+				uint32_t outsideMask;
+				uint32_t insideMask;
+				frustum.TestBoxes(batch, outsideMask, insideMask);
+				m_testedNodesCount += batchSize;
+
+				for (uint32_t lane = 0; lane < batchSize; lane++)
+				{
+					const NodeReference& node = m_level[batchBegin + lane];
+					if (outsideMask >> lane & 1)
+					{
+						continue;
+					}
+					if (node.type == LEAF_NODE)
+					{
+						m_leafRanges.push_back({node.index, node.index});
+					}
+					else if (insideMask >> lane & 1)
+					{
+						LeafRange range;
+						hierarchy.GetSubtreeLeaves(node.index, range.firstLeaf, range.lastLeaf);
+						m_leafRanges.push_back(range);
+					}
+					else
+					{
+						const InternalNode& internalNode = internalNodes[node.index];
+						m_nextLevel.push_back({internalNode.leftNode, internalNode.leftNodeType});
+						m_nextLevel.push_back({internalNode.rightNode, internalNode.rightNodeType});
+					}
+				}
+			}
+			m_level.swap(m_nextLevel);
+		}
+
+		// subtrees don't overlap, so sorted ranges only touch or are apart
+		std::sort(m_leafRanges.begin(), m_leafRanges.end(), [](const LeafRange& a, const LeafRange& b)
+		{
+			return a.firstLeaf < b.firstLeaf;
+		});
+		for (const LeafRange& leafRange : m_leafRanges)
+		{
+			if (!m_ranges.empty() && m_ranges.back().firstLeaf + m_ranges.back().leavesCount == leafRange.firstLeaf)
+			{
+				m_ranges.back().leavesCount += leafRange.lastLeaf - leafRange.firstLeaf + 1;
+			}
+			else
+			{
+				m_ranges.push_back({leafRange.firstLeaf, leafRange.lastLeaf - leafRange.firstLeaf + 1, 0, 0});
+			}
+		}
+		for (VisiblePointRange& range : m_ranges)
+		{
+			const uint32_t lastLeaf = range.firstLeaf + range.leavesCount - 1;
+			range.pointsOffset = hierarchy.GetLeafPointsOffset(range.firstLeaf);
+			range.pointsCount = hierarchy.GetLeafPointsOffset(lastLeaf) + hierarchy.GetLeafPointsCount(lastLeaf) - range.pointsOffset;
+			m_visiblePointsCount += range.pointsCount;
+		}
+		return m_ranges;
+	}
+}
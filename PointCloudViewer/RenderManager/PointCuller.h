@@ -0,0 +1,58 @@
+#ifndef POINT_CULLER_H
+#define POINT_CULLER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Common/Frustum.h"
+#include "PointCloudLoader/PointBvh.h"
+
+namespace PointCloudViewer
+{
+	// Consecutive visible leaves of the hierarchy and the points they cover
+	struct VisiblePointRange
+	{
+		uint32_t firstLeaf;
+		uint32_t leavesCount;
+		uint64_t pointsOffset;
+		uint64_t pointsCount;
+	};
+
+	// Frustum culling of the point hierarchy on the CPU.
+	// The hierarchy is walked level by level, the nodes of a level are tested four at a time.
+	// Subtrees inside the frustum are accepted without going further down, their leaves are a single range already.
+	// Leaves that intersect the frustum are kept whole, the GPU clips their points.
+	class PointCuller
+	{
+	public:
+		// Visible ranges in buffer order, adjacent ranges are merged. Valid until the next call.
+		const std::vector<VisiblePointRange>& Cull(const PointBvh& hierarchy, const Frustum& frustum);
+
+		// Counters of the last call
+		[[nodiscard]] uint32_t GetTestedNodesCount() const noexcept { return m_testedNodesCount; }
+		[[nodiscard]] uint64_t GetVisiblePointsCount() const noexcept { return m_visiblePointsCount; }
+
+	private:
+		struct NodeReference
+		{
+			uint32_t index;
+			uint32_t type;
+		};
+
+		struct LeafRange
+		{
+			uint32_t firstLeaf;
+			uint32_t lastLeaf;
+		};
+
+		std::vector<NodeReference> m_level;
+		std::vector<NodeReference> m_nextLevel;
+		std::vector<LeafRange> m_leafRanges;
+		std::vector<VisiblePointRange> m_ranges;
+
+		uint32_t m_testedNodesCount = 0;
+		uint64_t m_visiblePointsCount = 0;
+	};
+}
+
+#endif // POINT_CULLER_H
@@ -0,0 +1,151 @@
+#include "PointLodSelector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace PointCloudViewer
+{
+	// Bisection steps over the error range, in log space it narrows the error to a fraction of a percent
+	static constexpr uint32_t LOD_BISECTION_STEPS = 24;
+	// Bisection stops once this much of the budget is used
+	static constexpr float LOD_BUDGET_TOLERANCE = 0.99f;
+
+	// Points a leaf needs for gaps of the screen error, density is 1 / error^2
+	static float GetLeafPointsCount(const PointLodLeaf& leaf, float density)
+	{
+		const float spacingRatio = 2.0f * leaf.projectedSize;
+		return std::min(std::max(std::ceil(spacingRatio * spacingRatio * density), 1.0f), static_cast<float>(leaf.pointsCount));
+	}
+
+	// Leaf counts are whole floats, exact for the few points of a leaf. The total is summed in double, a float one
+	// stops counting single points past 2^24, well under a frame budget
+	static double GetPointsCount(const std::vector<PointLodLeaf>& leaves, float density)
+	{
+		double pointsCount = 0.0;
+		for (const PointLodLeaf& leaf : leaves)
+		{
+			pointsCount += GetLeafPointsCount(leaf, density);
+		}
+		return pointsCount;
+	}
+
+	float PointLodSelector::GetProjectionScale(float fovRadians, float screenHeight)
+	{
+		return screenHeight / (2.0f * std::tan(fovRadians * 0.5f));
+	}
+
+	float PointLodSelector::AllocateBudget(std::vector<PointLodLeaf>& leaves, const PointLodSettings& settings)
+	{
+		if (leaves.empty())
+		{
+			return 0.0f;
+		}
+
+		if (leaves.size() > settings.pointBudget)
+		{
+			// the largest leaves on screen keep a point each
+			std::nth_element(leaves.begin(), leaves.begin() + static_cast<std::ptrdiff_t>(settings.pointBudget), leaves.end(), [](const PointLodLeaf& a, const PointLodLeaf& b)
+			{
+				return a.projectedSize > b.projectedSize;
+			});
+			float screenError = 0.0f;
+			for (size_t i = 0; i < leaves.size(); i++)
+			{
+				leaves[i].selectedPointsCount = i < settings.pointBudget ? 1 : 0;
+				screenError = std::max(screenError, i < settings.pointBudget ? 2.0f * leaves[i].projectedSize : 0.0f);
+			}
+			return screenError;
+		}
+
+		float maxError = settings.minPointSpacing;
+		for (const PointLodLeaf& leaf : leaves)
+		{
+			maxError = std::max(maxError, 2.0f * leaf.projectedSize);
+		}
+
+		// the error can't go under the minimal spacing, and at the largest error every leaf takes a single point
+		const double pointBudget = static_cast<double>(settings.pointBudget);
+		float screenError = settings.minPointSpacing;
+		if (GetPointsCount(leaves, 1.0f / (screenError * screenError)) > pointBudget)
+		{
+			float lowError = settings.minPointSpacing;
+			float highError = maxError;
+			for (uint32_t step = 0; step < LOD_BISECTION_STEPS; step++)
+			{
+				const float error = std::sqrt(lowError * highError);
+				const double pointsCount = GetPointsCount(leaves, 1.0f / (error * error));
+				(pointsCount > pointBudget ? lowError : highError) = error;
+				if (pointsCount <= pointBudget && pointsCount >= pointBudget * LOD_BUDGET_TOLERANCE)
+				{
+					break;
+				}
+			}
+			screenError = highError;
+		}
+
+		const float density = 1.0f / (screenError * screenError);
+		for (PointLodLeaf& leaf : leaves)
+		{
+			leaf.selectedPointsCount = static_cast<uint32_t>(GetLeafPointsCount(leaf, density));
+		}
+		return screenError;
+	}
+
+	const std::vector<PointDrawRange>& PointLodSelector::Select(const PointBvh& hierarchy, const Frustum& frustum, const PointLodView& view, const PointLodSettings& settings)
+	{
+		m_leaves.clear();
+		m_ranges.clear();
+
+		const std::vector<AABB>& leafBounds = hierarchy.GetLeafBounds();
+		for (const VisiblePointRange& range : m_pointCuller.Cull(hierarchy, frustum))
+		{
+			for (uint32_t leafIndex = range.firstLeaf; leafIndex < range.firstLeaf + range.leavesCount; leafIndex++)
+			{
+				const AABB& bounds = leafBounds[leafIndex];
+				const float extent[3] = {bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z};
+				const float offset[3] = {
+					(bounds.min.x + bounds.max.x) * 0.5f - view.position[0],
+					(bounds.min.y + bounds.max.y) * 0.5f - view.position[1],
+					(bounds.min.z + bounds.max.z) * 0.5f - view.position[2]
+				};
+				const float radius = 0.5f * std::sqrt(extent[0] * extent[0] + extent[1] * extent[1] + extent[2] * extent[2]);
+				const float distance = std::sqrt(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]);
+
+				// a leaf around the camera counts as if it touched it
+				const float projectedSize = view.projectionScale * radius / std::max(distance, radius);
+				m_leaves.push_back({leafIndex, projectedSize, hierarchy.GetLeafPointsCount(leafIndex), 0});
+			}
+		}
+
+		m_screenError = AllocateBudget(m_leaves, settings);
+
+		// leaves drawn whole merge with their neighbours into a single draw
+		std::sort(m_leaves.begin(), m_leaves.end(), [](const PointLodLeaf& a, const PointLodLeaf& b)
+		{
+			return a.leafIndex < b.leafIndex;
+		});
+		m_selectedPointsCount = 0;
+		bool canExtend = false;
+		for (const PointLodLeaf& leaf : m_leaves)
+		{
+			if (leaf.selectedPointsCount == 0)
+			{
+				canExtend = false;
+				continue;
+			}
+
+			const uint64_t pointsOffset = hierarchy.GetLeafPointsOffset(leaf.leafIndex);
+			if (canExtend && m_ranges.back().pointsOffset + m_ranges.back().pointsCount == pointsOffset)
+			{
+				m_ranges.back().pointsCount += leaf.selectedPointsCount;
+			}
+			else
+			{
+				m_ranges.push_back({pointsOffset, leaf.selectedPointsCount});
+			}
+			canExtend = leaf.selectedPointsCount == leaf.pointsCount;
+			m_selectedPointsCount += leaf.selectedPointsCount;
+		}
+		return m_ranges;
+	}
+}
@@ -0,0 +1,76 @@
+#ifndef POINT_LOD_SELECTOR_H
+#define POINT_LOD_SELECTOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "PointCuller.h"
+
+namespace PointCloudViewer
+{
+	struct PointLodSettings
+	{
+		uint64_t pointBudget = 10'000'000;
+		// Points closer than this on screen add nothing, in pixels
+		float minPointSpacing = 1.0f;
+	};
+
+	// Camera as the selector sees it, in the origin-relative space of the hierarchy
+	struct PointLodView
+	{
+		float position[3];
+		// Pixels covered by a unit length at unit distance, see GetProjectionScale
+		float projectionScale;
+	};
+
+	struct PointDrawRange
+	{
+		uint64_t pointsOffset;
+		uint64_t pointsCount;
+	};
+
+	// A visible leaf with the part of it picked for drawing
+	struct PointLodLeaf
+	{
+		uint32_t leafIndex;
+		// radius of the leaf bounds on screen, in pixels
+		float projectedSize;
+		uint32_t pointsCount;
+		uint32_t selectedPointsCount;
+	};
+
+	// Screen-space error LOD over the leaves of the point hierarchy.
+	// Leaves are culled against the frustum and ranked by projected size, radius over distance scaled to pixels.
+	// Drawing n points of a leaf leaves gaps of about 2 * projectedSize / sqrt(n) pixels between them, the screen-space error.
+	// Budget goes first to the leaf with the largest error, as if points were handed out one by one greedily.
+	// All leaves end up at one common error, so it is found by bisection instead of a heap operation per point.
+	// Every visible leaf draws a prefix of its shuffled points, at least one.
+	class PointLodSelector
+	{
+	public:
+		[[nodiscard]] static float GetProjectionScale(float fovRadians, float screenHeight);
+
+		// Draw ranges in buffer order, valid until the next call
+		const std::vector<PointDrawRange>& Select(const PointBvh& hierarchy, const Frustum& frustum, const PointLodView& view, const PointLodSettings& settings);
+
+		// Picks selectedPointsCount of every leaf, returns the screen-space error reached.
+		// When even one point per leaf is over the budget, leaves with the smallest projected size get none.
+		static float AllocateBudget(std::vector<PointLodLeaf>& leaves, const PointLodSettings& settings);
+
+		// Counters of the last call
+		[[nodiscard]] const std::vector<PointLodLeaf>& GetLeaves() const noexcept { return m_leaves; }
+		[[nodiscard]] uint64_t GetVisiblePointsCount() const noexcept { return m_pointCuller.GetVisiblePointsCount(); }
+		[[nodiscard]] uint64_t GetSelectedPointsCount() const noexcept { return m_selectedPointsCount; }
+		[[nodiscard]] float GetScreenError() const noexcept { return m_screenError; }
+
+	private:
+		PointCuller m_pointCuller;
+		std::vector<PointLodLeaf> m_leaves;
+		std::vector<PointDrawRange> m_ranges;
+
+		uint64_t m_selectedPointsCount = 0;
+		float m_screenError = 0.0f;
+	};
+}
+
+#endif // POINT_LOD_SELECTOR_H
@@ -0,0 +1,78 @@
+#include "PointPrefetcher.h"
+
+#include <utility>
+
+namespace PointCloudViewer
+{
+	void PointPrefetcher::Update(const PointBvh& hierarchy, const CameraTraceSample& pose, const CameraTraceProjection& projection, const PointPrefetchSettings& settings)
+	{
+		m_visibleLeaves.clear();
+		m_prefetchLeaves.clear();
+		m_leafUpdates.resize(hierarchy.GetLeafNodes().size(), 0);
+		m_updateIndex++;
+
+		CollectLeaves(hierarchy, pose, projection, m_visibleLeaves);
+		for (uint32_t step = 1; step <= settings.lookAheadSteps; step++)
+		{
+			const float seconds = settings.lookAheadSeconds * static_cast<float>(step) / static_cast<float>(settings.lookAheadSteps);
+			CollectLeaves(hierarchy, CameraTrace::Predict(pose, seconds), projection, m_prefetchLeaves);
+		}
+	}
+
+	PointResidencyStats PointPrefetcher::Replay(const PointBvh& hierarchy, const PointOrigin& origin, const CameraTrace& trace,
+	                                            const CameraTraceProjection& projection, const PointStreamingReplaySettings& settings)
+	{
+		const uint32_t leavesCount = static_cast<uint32_t>(hierarchy.GetLeafNodes().size());
+		std::vector<uint64_t> leafBytes(leavesCount);
+		for (uint32_t leafIndex = 0; leafIndex < leavesCount; leafIndex++)
+		{
+			leafBytes[leafIndex] = static_cast<uint64_t>(hierarchy.GetLeafPointsCount(leafIndex)) * settings.pointStride;
+		}
+
+		PointResidencyCache cache(std::move(leafBytes), settings.budgetBytes);
+		PointPrefetcher prefetcher;
+		std::vector<uint32_t> uploadingLeaves;
+		std::vector<uint32_t> evictedLeaves;
+		for (const CameraTraceSample& sample : trace.GetSamples())
+		{
+			for (const uint32_t leafIndex : uploadingLeaves)
+			{
+				cache.CompleteLoad(leafIndex);
+			}
+			uploadingLeaves.clear();
+
+			CameraTraceSample pose = sample;
+			pose.position[0] = static_cast<float>(static_cast<double>(sample.position[0]) - origin.x);
+			pose.position[1] = static_cast<float>(static_cast<double>(sample.position[1]) - origin.y);
+			pose.position[2] = static_cast<float>(static_cast<double>(sample.position[2]) - origin.z);
+			prefetcher.Update(hierarchy, pose, projection, settings.prefetch);
+			cache.MarkVisible(prefetcher.GetVisibleLeaves(), prefetcher.GetPrefetchLeaves());
+
+			uint64_t uploadedBytes = 0;
+			uint32_t leafIndex;
+			while (uploadedBytes < settings.uploadBytesPerFrame && cache.PopLoad(leafIndex, evictedLeaves))
+			{
+				uploadingLeaves.push_back(leafIndex);
+				uploadedBytes += cache.GetNodeBytes(leafIndex);
+			}
+		}
+		return cache.GetStats();
+	}
+
+	void PointPrefetcher::CollectLeaves(const PointBvh& hierarchy, const CameraTraceSample& pose, const CameraTraceProjection& projection, std::vector<uint32_t>& leaves)
+	{
+		float viewProjection[4][4];
+		CameraTrace::GetViewProjection(pose.position, pose.rotation, projection, viewProjection);
+		for (const VisiblePointRange& range : m_pointCuller.Cull(hierarchy, Frustum(viewProjection)))
+		{
+			for (uint32_t leafIndex = range.firstLeaf; leafIndex < range.firstLeaf + range.leavesCount; leafIndex++)
+			{
+				if (m_leafUpdates[leafIndex] != m_updateIndex)
+				{
+					m_leafUpdates[leafIndex] = m_updateIndex;
+					leaves.push_back(leafIndex);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef POINT_PREFETCHER_H
+#define POINT_PREFETCHER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "PointCuller.h"
+#include "PointResidencyCache.h"
+#include "Common/CameraTrace.h"
+#include "PointCloudLoader/PointOrigin.h"
+
+namespace PointCloudViewer
+{
+	struct PointPrefetchSettings
+	{
+		// How far ahead the camera pose is extrapolated
+		float lookAheadSeconds = 0.3f;
+		// Poses culled along the way, so a fast turn doesn't skip the nodes in between. 0 turns prefetching off.
+		uint32_t lookAheadSteps = 3;
+	};
+
+	struct PointStreamingReplaySettings
+	{
+		uint64_t budgetBytes = 512ull * 1024 * 1024;
+		// Loads past this wait for the next frame
+		uint64_t uploadBytesPerFrame = 32ull * 1024 * 1024;
+		uint32_t pointStride = sizeof(PackedPoint);
+		PointPrefetchSettings prefetch;
+	};
+
+	// Picks the hierarchy leaves to stream for a camera pose.
+	// Visible leaves come from culling the current pose. The pose is then extrapolated with the camera velocities and the
+	// leaves only those future poses see are prefetch candidates, to be loaded after all the current misses.
+	class PointPrefetcher
+	{
+	public:
+		// Pose is in the origin-relative space of the hierarchy
+		void Update(const PointBvh& hierarchy, const CameraTraceSample& pose, const CameraTraceProjection& projection, const PointPrefetchSettings& settings);
+
+		// Leaves of the last call, the prefetch ones are nearest in time first
+		[[nodiscard]] const std::vector<uint32_t>& GetVisibleLeaves() const noexcept { return m_visibleLeaves; }
+		[[nodiscard]] const std::vector<uint32_t>& GetPrefetchLeaves() const noexcept { return m_prefetchLeaves; }
+
+		// Streams the leaves along a recorded camera path through a residency cache, an upload completes a frame after it is issued
+		static PointResidencyStats Replay(const PointBvh& hierarchy, const PointOrigin& origin, const CameraTrace& trace,
+		                                  const CameraTraceProjection& projection, const PointStreamingReplaySettings& settings);
+
+	private:
+		// Appends the leaves of the pose not collected in this call yet
+		void CollectLeaves(const PointBvh& hierarchy, const CameraTraceSample& pose, const CameraTraceProjection& projection, std::vector<uint32_t>& leaves);
+
+		PointCuller m_pointCuller;
+		std::vector<uint32_t> m_visibleLeaves;
+		std::vector<uint32_t> m_prefetchLeaves;
+
+		// call index a leaf was last collected in
+		std::vector<uint64_t> m_leafUpdates;
+		uint64_t m_updateIndex = 0;
+	};
+}
+
+#endif // POINT_PREFETCHER_H
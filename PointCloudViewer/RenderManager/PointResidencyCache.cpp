@@ -0,0 +1,166 @@
+#include "PointResidencyCache.h"
+
+#include "Utils/Assert.h"
+
+namespace PointCloudViewer
+{
+	PointResidencyCache::PointResidencyCache(std::vector<uint64_t> nodeBytes, uint64_t budgetBytes) :
+		m_budgetBytes(budgetBytes)
+	{
+		m_nodes.resize(nodeBytes.size());
+		for (uint32_t i = 0; i < nodeBytes.size(); i++)
+		{
+			m_nodes[i] = {nodeBytes[i], 0, NO_NODE, NO_NODE, PointResidencyState::Absent, false};
+		}
+	}
+
+	void PointResidencyCache::MarkVisible(const std::vector<uint32_t>& visibleNodes, const std::vector<uint32_t>& prefetchNodes)
+	{
+		m_frameIndex++;
+
+		// loads the camera moved away from aren't worth their upload anymore
+		for (uint32_t i = m_loadQueueHead; i < m_loadQueue.size(); i++)
+		{
+			m_nodes[m_loadQueue[i]].state = PointResidencyState::Absent;
+		}
+		m_loadQueue.clear();
+		m_loadQueueHead = 0;
+
+		for (const uint32_t nodeIndex : visibleNodes)
+		{
+			Request(nodeIndex, true);
+		}
+		m_prefetchQueueBegin = static_cast<uint32_t>(m_loadQueue.size());
+		for (const uint32_t nodeIndex : prefetchNodes)
+		{
+			Request(nodeIndex, false);
+		}
+	}
+
+	bool PointResidencyCache::PopLoad(uint32_t& nodeIndex, std::vector<uint32_t>& evictedNodes)
+	{
+		evictedNodes.clear();
+		if (m_loadQueueHead == m_loadQueue.size())
+		{
+			return false;
+		}
+
+		const uint32_t candidate = m_loadQueue[m_loadQueueHead];
+		const uint64_t bytes = m_nodes[candidate].bytes;
+
+		// evict from the back only while the back wasn't requested this frame, everything in front of it is more recent
+		uint64_t freedBytes = 0;
+		uint32_t evictionEnd = m_back;
+		while (m_usedBytes - freedBytes + bytes > m_budgetBytes)
+		{
+			if (evictionEnd == NO_NODE || m_nodes[evictionEnd].lastRequestedFrame == m_frameIndex || m_nodes[evictionEnd].state != PointResidencyState::Resident)
+			{
+				return false;
+			}
+			freedBytes += m_nodes[evictionEnd].bytes;
+			evictionEnd = m_nodes[evictionEnd].previous;
+		}
+
+		while (m_back != evictionEnd)
+		{
+			const uint32_t evicted = m_back;
+			Unlink(evicted);
+			m_nodes[evicted].state = PointResidencyState::Absent;
+			m_nodes[evicted].prefetched = false;
+			m_usedBytes -= m_nodes[evicted].bytes;
+			evictedNodes.push_back(evicted);
+			m_stats.evictions++;
+		}
+
+		if (m_loadQueueHead >= m_prefetchQueueBegin)
+		{
+			m_nodes[candidate].prefetched = true;
+			m_stats.prefetches++;
+		}
+		m_loadQueueHead++;
+		nodeIndex = candidate;
+		m_nodes[candidate].state = PointResidencyState::Loading;
+		m_usedBytes += bytes;
+		LinkFront(candidate);
+		return true;
+	}
+
+	void PointResidencyCache::CompleteLoad(uint32_t nodeIndex)
+	{
+		Node& node = m_nodes[nodeIndex];
+		ASSERT(node.state == PointResidencyState::Loading);
+		node.state = PointResidencyState::Resident;
+		m_stats.loads++;
+		m_stats.loadedBytes += node.bytes;
+	}
+
+	void PointResidencyCache::Request(uint32_t nodeIndex, bool visible)
+	{
+		Node& node = m_nodes[nodeIndex];
+		if (node.lastRequestedFrame == m_frameIndex)
+		{
+			return;
+		}
+		node.lastRequestedFrame = m_frameIndex;
+
+		switch (node.state)
+		{
+		case PointResidencyState::Resident:
+			if (visible)
+			{
+				m_stats.hits++;
+				m_stats.prefetchHits += node.prefetched ? 1 : 0;
+				node.prefetched = false;
+			}
+			Unlink(nodeIndex);
+			LinkFront(nodeIndex);
+			break;
+		case PointResidencyState::Loading:
+			if (visible)
+			{
+				m_stats.misses++;
+				node.prefetched = false;
+			}
+			Unlink(nodeIndex);
+			LinkFront(nodeIndex);
+			break;
+		case PointResidencyState::Absent:
+			m_stats.misses += visible ? 1 : 0;
+			// a node over the whole budget would evict everything and still not fit
+			if (node.bytes <= m_budgetBytes)
+			{
+				node.state = PointResidencyState::Queued;
+				m_loadQueue.push_back(nodeIndex);
+			}
+			break;
+		case PointResidencyState::Queued:
+			ASSERT(false);
+			break;
+		}
+	}
+
+	void PointResidencyCache::LinkFront(uint32_t nodeIndex)
+	{
+		Node& node = m_nodes[nodeIndex];
+		node.previous = NO_NODE;
+		node.next = m_front;
+		if (m_front != NO_NODE)
+		{
+			m_nodes[m_front].previous = nodeIndex;
+		}
+		m_front = nodeIndex;
+		if (m_back == NO_NODE)
+		{
+			m_back = nodeIndex;
+		}
+	}
+
+	void PointResidencyCache::Unlink(uint32_t nodeIndex)
+	{
+		Node& node = m_nodes[nodeIndex];
+		(node.previous != NO_NODE ? m_nodes[node.previous].next : m_front) = node.next;
+		(node.next != NO_NODE ? m_nodes[node.next].previous : m_back) = node.previous;
+		node.previous = NO_NODE;
+		node.next = NO_NODE;
+	}
+}
@@ -0,0 +1,99 @@
+#ifndef POINT_RESIDENCY_CACHE_H
+#define POINT_RESIDENCY_CACHE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace PointCloudViewer
+{
+	struct PointResidencyStats
+	{
+		// visible nodes that were resident and that weren't, counted every frame they are visible
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		uint64_t loads = 0;
+		uint64_t loadedBytes = 0;
+		// loads issued ahead of visibility, and hits on them before they were ever visible
+		uint64_t prefetches = 0;
+		uint64_t prefetchHits = 0;
+	};
+
+	enum class PointResidencyState : uint8_t
+	{
+		Absent,
+		Queued,
+		Loading,
+		Resident
+	};
+
+	// Decides which hierarchy nodes live in the GPU point buffer, without touching the device.
+	// Every frame the nodes to draw are marked visible, absent ones are queued for loading in the order given.
+	// Nodes expected to become visible soon can be passed along, they are queued after all the visible misses.
+	// A popped load reserves its bytes, making room by evicting the least recently visible resident nodes.
+	// Nodes requested in the current frame are never evicted, a load that doesn't fit waits for the camera to move.
+	// Budget is a fixed pool picked by the caller, the cache never asks the device how much is left.
+	class PointResidencyCache
+	{
+	public:
+		PointResidencyCache(std::vector<uint64_t> nodeBytes, uint64_t budgetBytes);
+
+		// Nodes to draw this frame and nodes to prefetch, most important first. Loads queued in earlier frames are replaced.
+		void MarkVisible(const std::vector<uint32_t>& visibleNodes, const std::vector<uint32_t>& prefetchNodes = {});
+
+		// Next node to upload with the resident nodes to drop first, false when nothing is queued or fits
+		bool PopLoad(uint32_t& nodeIndex, std::vector<uint32_t>& evictedNodes);
+		// Upload of a popped node is done, it can be drawn from now on
+		void CompleteLoad(uint32_t nodeIndex);
+
+		[[nodiscard]] PointResidencyState GetState(uint32_t nodeIndex) const noexcept { return m_nodes[nodeIndex].state; }
+		[[nodiscard]] bool IsResident(uint32_t nodeIndex) const noexcept { return m_nodes[nodeIndex].state == PointResidencyState::Resident; }
+		[[nodiscard]] uint64_t GetNodeBytes(uint32_t nodeIndex) const noexcept { return m_nodes[nodeIndex].bytes; }
+		// Resident and loading nodes
+		[[nodiscard]] uint64_t GetUsedBytes() const noexcept { return m_usedBytes; }
+		[[nodiscard]] uint64_t GetBudgetBytes() const noexcept { return m_budgetBytes; }
+		[[nodiscard]] uint32_t GetQueuedLoadsCount() const noexcept { return static_cast<uint32_t>(m_loadQueue.size()) - m_loadQueueHead; }
+		[[nodiscard]] uint64_t GetFrameIndex() const noexcept { return m_frameIndex; }
+
+		[[nodiscard]] const PointResidencyStats& GetStats() const noexcept { return m_stats; }
+		void ResetStats() { m_stats = {}; }
+
+	private:
+		static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+		struct Node
+		{
+			uint64_t bytes;
+			// last frame the node was visible or prefetched in
+			uint64_t lastRequestedFrame;
+			// neighbours in the recency list of resident and loading nodes
+			uint32_t previous;
+			uint32_t next;
+			PointResidencyState state;
+			// loaded by a prefetch and not visible since
+			bool prefetched;
+		};
+
+		void Request(uint32_t nodeIndex, bool visible);
+		void LinkFront(uint32_t nodeIndex);
+		void Unlink(uint32_t nodeIndex);
+
+		std::vector<Node> m_nodes;
+		// most and least recently visible ends of the recency list
+		uint32_t m_front = NO_NODE;
+		uint32_t m_back = NO_NODE;
+
+		std::vector<uint32_t> m_loadQueue;
+		uint32_t m_loadQueueHead = 0;
+		// queue entries from here on are prefetches
+		uint32_t m_prefetchQueueBegin = 0;
+
+		uint64_t m_budgetBytes;
+		uint64_t m_usedBytes = 0;
+		// frames start at 1, a node that was never requested has 0
+		uint64_t m_frameIndex = 0;
+		PointResidencyStats m_stats;
+	};
+}
+
+#endif // POINT_RESIDENCY_CACHE_H
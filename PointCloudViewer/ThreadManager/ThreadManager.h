@@ -1,8 +1,10 @@
 ﻿#ifndef THREAD_MANAGER_H
 #define THREAD_MANAGER_H
+#include <algorithm>
 #include <thread>
 #include <vector>
 
+#include "WorkStealingQueue.h"
 #include "Common/Singleton.h"
 #include "Utils/Assert.h"
 
@@ -12,8 +14,15 @@ namespace PointCloudViewer
 	class ThreadManager : public Singleton<ThreadManager>
 	{
 	public:
-		ThreadManager(): m_hardwareConcurrency(std::thread::hardware_concurrency() - 2)
+		// two hardware threads are left to the engine and render threads, but loading needs at least two workers
+		ThreadManager(): ThreadManager(std::max(std::thread::hardware_concurrency(), 4u) - 2)
 		{
+		}
+
+		// Fixed amount of workers, for measuring how work scales with them
+		explicit ThreadManager(uint32_t workersCount): m_hardwareConcurrency(workersCount)
+		{
+			ASSERT(workersCount != 0);
 			m_workers.resize(m_hardwareConcurrency);
 		}
 
@@ -44,6 +53,32 @@ namespace PointCloudViewer
 			}
 		}
 
+		// Runs function(taskIndex, workerIndex) for every task on all workers and waits for them.
+		// Tasks are dealt to workers in contiguous ranges, idle workers steal from the others.
+		template <typename Function>
+		void ParallelFor(uint64_t tasksCount, const Function& function)
+		{
+			WorkStealingQueues<uint64_t> queues(m_hardwareConcurrency);
+			for (uint64_t taskIndex = 0; taskIndex < tasksCount; taskIndex++)
+			{
+				queues.Push(static_cast<uint32_t>(taskIndex * m_hardwareConcurrency / tasksCount), taskIndex);
+			}
+
+			for (uint32_t workerIndex = 0; workerIndex < m_hardwareConcurrency; workerIndex++)
+			{
+				StartWorker(workerIndex, [&queues, &function, workerIndex]()
+				{
+					// nothing is pushed after the start, so all queues being empty means the work is done
+					uint64_t taskIndex;
+					while (queues.Pop(workerIndex, taskIndex))
+					{
+						function(taskIndex, workerIndex);
+					}
+				});
+			}
+			WaitAllWorkers();
+		}
+
 		[[nodiscard]] uint32_t GetWorkersCount() const noexcept { return m_hardwareConcurrency; }
 
 	private:
@@ -0,0 +1,93 @@
+#ifndef WORK_STEALING_QUEUE_H
+#define WORK_STEALING_QUEUE_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace PointCloudViewer
+{
+	// Task queue of a single worker. The owner takes the oldest task, thieves take the newest one,
+	// so with tasks pushed in file order owners keep walking forward and thieves rarely touch the same end.
+	template <typename T>
+	class WorkStealingQueue
+	{
+	public:
+		void Push(const T& value)
+		{
+			std::lock_guard lock(m_mutex);
+			m_items.push_back(value);
+		}
+
+		bool Pop(T& value)
+		{
+			std::lock_guard lock(m_mutex);
+			if (m_items.empty())
+			{
+				return false;
+			}
+			value = m_items.front();
+			m_items.pop_front();
+			return true;
+		}
+
+		bool Steal(T& value)
+		{
+			std::lock_guard lock(m_mutex);
+			if (m_items.empty())
+			{
+				return false;
+			}
+			value = m_items.back();
+			m_items.pop_back();
+			return true;
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::deque<T> m_items;
+	};
+
+	// One queue per worker, every worker has its own lock so there is no single point of contention
+	template <typename T>
+	class WorkStealingQueues
+	{
+	public:
+		explicit WorkStealingQueues(uint32_t queuesCount) :
+			m_queues(std::make_unique<WorkStealingQueue<T>[]>(queuesCount)),
+			m_queuesCount(queuesCount)
+		{
+		}
+
+		void Push(uint32_t queueIndex, const T& value)
+		{
+			m_queues[queueIndex].Push(value);
+		}
+
+		// Own queue first, then the rest starting from the neighbour
+		bool Pop(uint32_t queueIndex, T& value)
+		{
+			if (m_queues[queueIndex].Pop(value))
+			{
+				return true;
+			}
+			for (uint32_t i = 1; i < m_queuesCount; i++)
+			{
+				if (m_queues[(queueIndex + i) % m_queuesCount].Steal(value))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		[[nodiscard]] uint32_t GetQueuesCount() const noexcept { return m_queuesCount; }
+
+	private:
+		std::unique_ptr<WorkStealingQueue<T>[]> m_queues;
+		uint32_t m_queuesCount;
+	};
+}
+
+#endif // WORK_STEALING_QUEUE_H
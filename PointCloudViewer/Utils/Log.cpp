@@ -7,11 +7,21 @@
 #define MAX_LOG_SIZE 2048
 
 char g_logData[MAX_LOG_SIZE];
+bool g_isConsoleOutput = false;
+
+static void Output(const char* text)
+{
+	OutputDebugStringA(text);
+	if (g_isConsoleOutput)
+	{
+		fputs(text, stdout);
+	}
+}
 
 void Logger::Log(const char* message)
 {
 	_snprintf_s(g_logData, MAX_LOG_SIZE, MAX_LOG_SIZE, "%s", message);
-	OutputDebugStringA(g_logData);
+	Output(g_logData);
 }
 
 void Logger::LogFormat(const char* format, ...)
@@ -21,7 +31,7 @@ void Logger::LogFormat(const char* format, ...)
 	vsnprintf_s(g_logData, MAX_LOG_SIZE, MAX_LOG_SIZE, format, argptr);
 	va_end(argptr);
 
-	OutputDebugStringA(g_logData);
+	Output(g_logData);
 }
 
 void Logger::LogUintArray(uint32_t* array, size_t size, uint32_t count)
@@ -30,7 +40,12 @@ void Logger::LogUintArray(uint32_t* array, size_t size, uint32_t count)
 	for (size_t i = 0; i < numbers; i++)
 	{
 		_snprintf_s(g_logData, MAX_LOG_SIZE, MAX_LOG_SIZE, "%d ", array[i]);
-		OutputDebugStringA(g_logData);
+		Output(g_logData);
 	}
-	OutputDebugStringA("\n");
+	Output("\n");
+}
+
+void Logger::EnableConsoleOutput()
+{
+	g_isConsoleOutput = true;
 }
@@ -8,5 +8,7 @@ public:
 	static void Log(const char* message);
 	static void LogFormat(const char* format...);
 	static void LogUintArray(uint32_t* array, size_t size, uint32_t count = 1024);
+	// Console applications get every message on stdout too, not only in the debugger
+	static void EnableConsoleOutput();
 };
 #endif // LOG_H
@@ -4,6 +4,7 @@
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#include <shellapi.h>
 
 // The min/max macros conflict with like-named member functions.
 // Only use std::min and std::max defined in <algorithm>.
@@ -17,15 +18,58 @@
 
 #include "WindowHandler.h"
 
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <memory>
 
+#include "DataManager/DataManager.h"
+#include "PointCloudLoader/PointOctreeBuilder.h"
+#include "ThreadManager/ThreadManager.h"
 #include "Utils/Log.h"
 
+// Modes that run without a window and exit, false when the command line has none.
+// --build-octree <path> converts a dataset of the data folder into an octree next to it.
+static bool RunCommandLineMode(int& exitCode)
+{
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (argv == nullptr)
+	{
+		return false;
+	}
+	const bool isBuildingOctree = argc > 2 && wcscmp(argv[1], L"--build-octree") == 0;
+	const std::string path = isBuildingOctree ? std::filesystem::path(argv[2]).string() : "";
+	LocalFree(argv);
+	if (!isBuildingOctree)
+	{
+		return false;
+	}
+
+	// the log goes to the console the viewer was started from, if any
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+	{
+		FILE* stream = nullptr;
+		freopen_s(&stream, "CONOUT$", "w", stdout);
+		Logger::EnableConsoleOutput();
+	}
+
+	PointCloudViewer::ThreadManager threadManager;
+	PointCloudViewer::DataManager dataManager;
+	exitCode = PointCloudViewer::PointOctreeBuilder(path).Build() ? 0 : 1;
+	return true;
+}
+
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine, int nCmdShow)
 {
+	int exitCode;
+	if (RunCommandLineMode(exitCode))
+	{
+		return exitCode;
+	}
+
 	constexpr uint32_t windowWidth = 1280;
 	constexpr uint32_t windowHeight = 720;
 
@@ -0,0 +1,17 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <cstdint>
+
+namespace PointCloudViewer
+{
+	// Parses a synthetic 7 column scanner export held in memory, x y z intensity r g b, with PointTextParser
+	// and with the per-character parser it replaced. Logs GB/s of both, each the best of a few repeats.
+	void RunPointTextParserBenchmark(uint64_t linesCount = 10'000'000);
+
+	// Downsamples a synthetic scan on 1, 2, 4... workers up to the hardware threads, each count with its own ThreadManager.
+	// Logs points/s by worker count for a dense and a sparse grid. Leaves no ThreadManager behind.
+	void RunVoxelDownsamplerBenchmark(uint64_t pointsCount = 10'000'000);
+}
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,150 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "PointCloudLoader/PointTextParser.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		constexpr uint32_t COLUMNS_COUNT = 7;
+		constexpr uint32_t REPEATS_COUNT = 3;
+
+		// Parser the viewer used before PointTextParser, kept as the baseline: integer mantissa, no exponent, float division
+		int LegacyReadFloats(const char* data, float* out, uint64_t& currentPosition, uint64_t endPosition)
+		{
+			int floatsRead = 0;
+			int sign = 1;
+			int number = 0;
+			bool isFraction = false;
+			int divider = 1;
+			bool isReadingNumber = false;
+
+			char c = data[currentPosition];
+			currentPosition++;
+
+			while (c != '\n' && currentPosition < endPosition)
+			{
+				if (c == '-')
+				{
+					sign = -1;
+				}
+				else if (c >= '0' && c <= '9')
+				{
+					isReadingNumber = true;
+					number = number * 10 + (c - '0');
+					if (isFraction)
+					{
+						divider *= 10;
+					}
+				}
+				else if (c == '.')
+				{
+					isFraction = true;
+				}
+				else
+				{
+					if (isReadingNumber)
+					{
+						out[floatsRead] = static_cast<float>(number * sign) / divider;
+						floatsRead += 1;
+					}
+
+					sign = 1;
+					number = 0;
+					isFraction = false;
+					divider = 1;
+					isReadingNumber = false;
+				}
+
+				c = data[currentPosition];
+				currentPosition++;
+			}
+
+			if (isReadingNumber)
+			{
+				out[floatsRead] = static_cast<float>(number * sign) / divider;
+				floatsRead += 1;
+			}
+
+			return floatsRead;
+		}
+
+		std::string GenerateScannerExport(uint64_t linesCount)
+		{
+			std::string text;
+			text.reserve(linesCount * 48);
+
+			std::mt19937 generator(1);
+			char line[128];
+			for (uint64_t i = 0; i < linesCount; i++)
+			{
+				const int length = snprintf(line, sizeof(line), "%.3f %.3f %.3f %d %d %d %d\n",
+				                            static_cast<double>(generator() % 2'000'000) / 100.0 - 10000.0,
+				                            static_cast<double>(generator() % 100'000) / 7.0,
+				                            -static_cast<double>(generator() % 1000) / 1000.0,
+				                            static_cast<int>(generator() % 4096) - 2048,
+				                            static_cast<int>(generator() % 256), static_cast<int>(generator() % 256), static_cast<int>(generator() % 256));
+				text.append(line, length);
+			}
+			return text;
+		}
+
+		// Best time of the repeats, parse returns the lines of all columns so neither parser is optimised away
+		template <typename ParseFunction>
+		double MeasureBestTime(const char* name, ParseFunction parse)
+		{
+			double bestTime = 0.0;
+			for (uint32_t repeat = 0; repeat < REPEATS_COUNT; repeat++)
+			{
+				const auto startTime = std::chrono::steady_clock::now();
+				const uint64_t linesCount = parse();
+				const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+				bestTime = repeat == 0 ? time : std::min(bestTime, time);
+				Logger::LogFormat("%s: %llu lines in %.3f s\n", name, linesCount, time);
+			}
+			return bestTime;
+		}
+	}
+
+	void RunPointTextParserBenchmark(uint64_t linesCount)
+	{
+		Logger::LogFormat("Point text parser benchmark: generating %llu lines\n", linesCount);
+		const std::string text = GenerateScannerExport(linesCount);
+		const double size = static_cast<double>(text.size()) / 1e9;
+
+		const double parserTime = MeasureBestTime(PointTextParser::GetInstructionSetName(), [&text]
+		{
+			const char* cursor = text.data();
+			const char* end = text.data() + text.size();
+			double values[PointTextParser::MAX_VALUES_PER_LINE];
+			uint64_t parsedLinesCount = 0;
+			while (cursor < end)
+			{
+				parsedLinesCount += PointTextParser::ReadLine(cursor, end, values) == COLUMNS_COUNT;
+			}
+			return parsedLinesCount;
+		});
+
+		const double legacyTime = MeasureBestTime("Legacy", [&text]
+		{
+			float values[PointTextParser::MAX_VALUES_PER_LINE];
+			uint64_t position = 0;
+			uint64_t parsedLinesCount = 0;
+			while (LegacyReadFloats(text.data(), values, position, text.size()) == COLUMNS_COUNT)
+			{
+				parsedLinesCount++;
+			}
+			return parsedLinesCount;
+		});
+
+		Logger::LogFormat("Point text parser benchmark: %.3f GB, %s %.3f GB/s, legacy %.3f GB/s, %.2fx\n",
+		                  size, PointTextParser::GetInstructionSetName(), size / parserTime, size / legacyTime, legacyTime / parserTime);
+	}
+}
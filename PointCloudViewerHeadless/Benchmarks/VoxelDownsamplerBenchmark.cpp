@@ -0,0 +1,59 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "PointCloudLoader/PointBvhBenchmark.h"
+#include "PointCloudLoader/VoxelDownsampler.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		constexpr uint32_t REPEATS_COUNT = 3;
+		// a few points per voxel over the 10M points of the default scan, and about a voxel per point
+		constexpr float VOXEL_SIZES[] = {0.2f, 0.05f};
+	}
+
+	void RunVoxelDownsamplerBenchmark(uint64_t pointsCount)
+	{
+		const uint32_t maxWorkersCount = std::max(std::thread::hardware_concurrency(), 2u);
+		std::vector<PackedPoint> points;
+		{
+			ThreadManager threadManager(maxWorkersCount);
+			Logger::LogFormat("Voxel downsampler benchmark: generating %llu points\n", pointsCount);
+			points = GenerateBenchmarkScan(pointsCount);
+		}
+
+		// powers of two, then all hardware threads
+		std::vector<uint32_t> workersCounts;
+		for (uint32_t workersCount = 1; workersCount < maxWorkersCount; workersCount *= 2)
+		{
+			workersCounts.push_back(workersCount);
+		}
+		workersCounts.push_back(maxWorkersCount);
+
+		for (const uint32_t workersCount : workersCounts)
+		{
+			ThreadManager threadManager(workersCount);
+			for (const float voxelSize : VOXEL_SIZES)
+			{
+				double bestTime = 0.0;
+				uint64_t voxelsCount = 0;
+				for (uint32_t repeat = 0; repeat < REPEATS_COUNT; repeat++)
+				{
+					const auto startTime = std::chrono::steady_clock::now();
+					voxelsCount = DownsampleVoxelGrid(points, {voxelSize, VoxelRepresentative::Centroid}).size();
+					const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+					bestTime = repeat == 0 ? time : std::min(bestTime, time);
+				}
+				Logger::LogFormat("Voxel downsampler benchmark: %u workers, voxels of %.2f, %llu points to %llu voxels in %.3f s, %.1f M points/s\n",
+				                  workersCount, voxelSize, pointsCount, voxelsCount, bestTime, static_cast<double>(pointsCount) / bestTime / 1e6);
+			}
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#include "ResourceManager/Buffers/Buffer.h"
+
+#include <utility>
+
+#include "Utils/Assert.h"
+
+// The headless target has no device. Point block pools there only hand out system memory, the upload heap
+// branch of the pool is linked but never taken, these stand in for the device buffer code it refers to.
+namespace PointCloudViewer
+{
+	MappedAreaHandle::~MappedAreaHandle()
+	{
+		ASSERT(m_buffer == nullptr);
+	}
+
+	MappedAreaHandle::MappedAreaHandle(MappedAreaHandle&& other) noexcept
+	{
+		Move(std::move(other));
+	}
+
+	MappedAreaHandle& MappedAreaHandle::operator=(MappedAreaHandle&& other) noexcept
+	{
+		Move(std::move(other));
+		return *this;
+	}
+
+	void* MappedAreaHandle::GetPtr() const noexcept
+	{
+		return m_bufferPtr;
+	}
+
+	void MappedAreaHandle::Move(MappedAreaHandle&& other)
+	{
+		m_buffer = other.m_buffer;
+		m_bufferPtr = other.m_bufferPtr;
+
+		other.m_buffer = nullptr;
+		other.m_bufferPtr = nullptr;
+	}
+
+	Buffer::Buffer(uint64_t size, D3D12_RESOURCE_STATES usage, D3D12_HEAP_TYPE properties, D3D12_RESOURCE_FLAGS flags) :
+		m_sizeInBytes(size),
+		m_currentResourceState(usage)
+	{
+		ASSERT(false);
+	}
+
+	MappedAreaHandle Buffer::Map() const
+	{
+		ASSERT(false);
+		return {};
+	}
+}
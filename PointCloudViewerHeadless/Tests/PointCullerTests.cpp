@@ -0,0 +1,152 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "TestCamera.h"
+#include "TestUtils.h"
+#include "PointCloudLoader/PointBvh.h"
+#include "PointCloudLoader/PointBvhBenchmark.h"
+#include "RenderManager/PointCuller.h"
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		constexpr uint32_t FRUSTA_COUNT = 300;
+		// relative to the magnitude of the plane equation terms, far above float rounding and far below any real gap
+		constexpr double DECISION_TOLERANCE = 1e-5;
+
+		// Box is within rounding of a plane's outside or inside threshold, float tests may classify it either way
+		bool IsNearDecision(const Frustum& frustum, const AABB& bounds)
+		{
+			const double boxMin[3] = {bounds.min.x, bounds.min.y, bounds.min.z};
+			const double boxMax[3] = {bounds.max.x, bounds.max.y, bounds.max.z};
+			for (uint32_t planeIndex = 0; planeIndex < Frustum::PLANES_COUNT; planeIndex++)
+			{
+				const float* plane = frustum.GetPlane(planeIndex);
+				double distance = plane[3];
+				double radius = 0.0;
+				double magnitude = std::abs(plane[3]);
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					distance += plane[axis] * (boxMin[axis] + boxMax[axis]) * 0.5;
+					radius += std::abs(plane[axis]) * (boxMax[axis] - boxMin[axis]) * 0.5;
+					magnitude += std::abs(plane[axis]) * (std::abs(boxMin[axis]) + std::abs(boxMax[axis]));
+				}
+				const double tolerance = magnitude * DECISION_TOLERANCE;
+				if (std::abs(distance + radius) <= tolerance || std::abs(distance - radius) <= tolerance)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		FrustumTest TestLeaf(const Frustum& frustum, const AABB& bounds)
+		{
+			const float boxMin[3] = {bounds.min.x, bounds.min.y, bounds.min.z};
+			const float boxMax[3] = {bounds.max.x, bounds.max.y, bounds.max.z};
+			return frustum.TestBox(boxMin, boxMax);
+		}
+
+		// Culls the hierarchy with random frusta and compares the leaves of the ranges with a scalar test of every leaf.
+		// Batched SIMD tests of the leaves are compared with the scalar ones on the way.
+		void TestHierarchy(uint64_t pointsCount, uint32_t leafPointsCount, std::mt19937& generator)
+		{
+			std::vector<PackedPoint> points = GenerateBenchmarkScan(pointsCount);
+			const PointBvh hierarchy = PointBvh::Build(points, leafPointsCount);
+			const std::vector<AABB>& leafBounds = hierarchy.GetLeafBounds();
+			const uint32_t leavesCount = static_cast<uint32_t>(leafBounds.size());
+
+			PointCuller culler;
+			std::vector<bool> isLeafCulledVisible(leavesCount);
+			uint64_t visibleLeavesCount = 0;
+			uint64_t leafMismatchesCount = 0;
+			uint64_t batchMismatchesCount = 0;
+			uint64_t nearDecisionsCount = 0;
+			for (uint32_t frustumIndex = 0; frustumIndex < FRUSTA_COUNT; frustumIndex++)
+			{
+				const Frustum frustum = GenerateTestCamera(generator).GetFrustum();
+				const std::vector<VisiblePointRange>& ranges = culler.Cull(hierarchy, frustum);
+
+				std::fill(isLeafCulledVisible.begin(), isLeafCulledVisible.end(), false);
+				uint64_t rangesPointsCount = 0;
+				for (size_t rangeIndex = 0; rangeIndex < ranges.size(); rangeIndex++)
+				{
+					const VisiblePointRange& range = ranges[rangeIndex];
+					TEST_CHECK(range.leavesCount > 0 && range.firstLeaf + range.leavesCount <= leavesCount);
+					// in buffer order with a gap between, touching ranges are merged
+					TEST_CHECK(rangeIndex == 0 || ranges[rangeIndex - 1].firstLeaf + ranges[rangeIndex - 1].leavesCount < range.firstLeaf);
+
+					uint64_t leavesPointsCount = 0;
+					for (uint32_t leafIndex = range.firstLeaf; leafIndex < range.firstLeaf + range.leavesCount && leafIndex < leavesCount; leafIndex++)
+					{
+						isLeafCulledVisible[leafIndex] = true;
+						leavesPointsCount += hierarchy.GetLeafPointsCount(leafIndex);
+					}
+					TEST_CHECK(range.pointsOffset == hierarchy.GetLeafPointsOffset(range.firstLeaf));
+					TEST_CHECK(range.pointsCount == leavesPointsCount);
+					rangesPointsCount += range.pointsCount;
+				}
+				TEST_CHECK(culler.GetVisiblePointsCount() == rangesPointsCount);
+
+				for (uint32_t leafIndex = 0; leafIndex < leavesCount; leafIndex++)
+				{
+					const bool isVisible = TestLeaf(frustum, leafBounds[leafIndex]) != FrustumTest::Outside;
+					visibleLeavesCount += isVisible;
+					if (isVisible != isLeafCulledVisible[leafIndex])
+					{
+						const bool isNearDecision = IsNearDecision(frustum, leafBounds[leafIndex]);
+						nearDecisionsCount += isNearDecision;
+						leafMismatchesCount += !isNearDecision;
+					}
+				}
+
+				for (uint32_t batchBegin = 0; batchBegin < leavesCount; batchBegin += 4)
+				{
+					FrustumBoxBatch batch;
+					for (uint32_t lane = 0; lane < 4; lane++)
+					{
+						const AABB& bounds = leafBounds[std::min(batchBegin + lane, leavesCount - 1)];
+						batch.minX[lane] = bounds.min.x;
+						batch.minY[lane] = bounds.min.y;
+						batch.minZ[lane] = bounds.min.z;
+						batch.maxX[lane] = bounds.max.x;
+						batch.maxY[lane] = bounds.max.y;
+						batch.maxZ[lane] = bounds.max.z;
+					}
+					uint32_t outsideMask;
+					uint32_t insideMask;
+					frustum.TestBoxes(batch, outsideMask, insideMask);
+
+					for (uint32_t lane = 0; lane < 4 && batchBegin + lane < leavesCount; lane++)
+					{
+						const FrustumTest batchTest = outsideMask >> lane & 1 ? FrustumTest::Outside : insideMask >> lane & 1 ? FrustumTest::Inside : FrustumTest::Intersecting;
+						if (batchTest != TestLeaf(frustum, leafBounds[batchBegin + lane]) && !IsNearDecision(frustum, leafBounds[batchBegin + lane]))
+						{
+							batchMismatchesCount++;
+						}
+					}
+				}
+			}
+
+			Logger::LogFormat("Culler, %llu points in %u leaves: %llu of %llu leaves visible over %u frusta, %llu mismatches, %llu near a plane\n",
+			                  pointsCount, leavesCount, visibleLeavesCount, static_cast<uint64_t>(leavesCount) * FRUSTA_COUNT, FRUSTA_COUNT,
+			                  leafMismatchesCount, nearDecisionsCount);
+			TEST_CHECK(leafMismatchesCount == 0);
+			TEST_CHECK(batchMismatchesCount == 0);
+		}
+	}
+
+	void RunPointCullerTests()
+	{
+		std::mt19937 generator(5);
+		// a lone leaf at the root, a partial last leaf and a deep hierarchy
+		TestHierarchy(100, PointBvh::DEFAULT_LEAF_POINTS_COUNT, generator);
+		TestHierarchy(100'003, PointBvh::DEFAULT_LEAF_POINTS_COUNT, generator);
+		TestHierarchy(1'000'000, 64, generator);
+	}
+}
@@ -0,0 +1,171 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "TestCamera.h"
+#include "TestUtils.h"
+#include "PointCloudLoader/PointBvh.h"
+#include "PointCloudLoader/PointBvhBenchmark.h"
+#include "RenderManager/PointLodSelector.h"
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		constexpr uint32_t ALLOCATIONS_COUNT = 2000;
+		constexpr uint32_t SELECTIONS_COUNT = 200;
+		constexpr float SCREEN_HEIGHT = 1080.0f;
+		// bisection stops within a percent of the budget, discrete leaf counts can land a little lower
+		constexpr double MIN_BUDGET_USE = 0.95;
+
+		// Checks one allocation: the budget holds, every leaf gets a point while the budget allows it,
+		// larger leaves on screen never get fewer points and leaves not drawn whole are at the returned error
+		void CheckAllocation(const std::vector<PointLodLeaf>& leaves, const PointLodSettings& settings, float screenError)
+		{
+			uint64_t selectedPointsCount = 0;
+			uint64_t pointsCount = 0;
+			bool isEveryLeafSelected = true;
+			bool isWithinError = true;
+			for (const PointLodLeaf& leaf : leaves)
+			{
+				selectedPointsCount += leaf.selectedPointsCount;
+				pointsCount += leaf.pointsCount;
+				isEveryLeafSelected &= leaf.selectedPointsCount >= 1;
+				TEST_CHECK(leaf.selectedPointsCount <= leaf.pointsCount);
+				if (leaf.selectedPointsCount > 0 && leaf.selectedPointsCount < leaf.pointsCount)
+				{
+					// one percent over for the ceil of the points count done in floats
+					isWithinError &= 2.0f * leaf.projectedSize / std::sqrt(static_cast<float>(leaf.selectedPointsCount)) <= screenError * 1.01f;
+				}
+			}
+			TEST_CHECK(selectedPointsCount <= settings.pointBudget);
+			TEST_CHECK(isWithinError);
+
+			if (leaves.size() <= settings.pointBudget)
+			{
+				TEST_CHECK(isEveryLeafSelected);
+				// nothing visible reports no error at all
+				TEST_CHECK(leaves.empty() || screenError >= settings.minPointSpacing);
+				// short of the budget only when the error can't go lower
+				const bool isBudgetUsed = static_cast<double>(selectedPointsCount) >= MIN_BUDGET_USE * static_cast<double>(settings.pointBudget);
+				TEST_CHECK(isBudgetUsed || selectedPointsCount == pointsCount || screenError <= settings.minPointSpacing * 1.01f);
+			}
+			else
+			{
+				TEST_CHECK(selectedPointsCount == settings.pointBudget);
+			}
+
+			std::vector<PointLodLeaf> sortedLeaves = leaves;
+			std::sort(sortedLeaves.begin(), sortedLeaves.end(), [](const PointLodLeaf& a, const PointLodLeaf& b)
+			{
+				return a.projectedSize > b.projectedSize;
+			});
+			bool isMonotonic = true;
+			for (size_t i = 1; i < sortedLeaves.size(); i++)
+			{
+				const PointLodLeaf& larger = sortedLeaves[i - 1];
+				const PointLodLeaf& smaller = sortedLeaves[i];
+				isMonotonic &= larger.selectedPointsCount >= std::min(smaller.selectedPointsCount, larger.pointsCount);
+			}
+			TEST_CHECK(isMonotonic);
+		}
+
+		// Random leaves from a few pixels to most of the screen, budgets from under one point per leaf to over all points
+		void TestAllocateBudget()
+		{
+			std::mt19937 generator(3);
+			std::uniform_real_distribution<float> logSize(std::log(0.05f), std::log(600.0f));
+			std::uniform_real_distribution<float> logBudget(std::log(0.5f), std::log(300.0f));
+			for (uint32_t allocationIndex = 0; allocationIndex < ALLOCATIONS_COUNT; allocationIndex++)
+			{
+				std::vector<PointLodLeaf> leaves(generator() % 2000 + 1);
+				for (uint32_t leafIndex = 0; leafIndex < leaves.size(); leafIndex++)
+				{
+					// most leaves are full, the last one of a hierarchy is partial
+					const uint32_t pointsCount = generator() % 8 == 0 ? generator() % 256 + 1 : 256;
+					leaves[leafIndex] = {leafIndex, std::exp(logSize(generator)), pointsCount, 0};
+				}
+
+				PointLodSettings settings;
+				settings.pointBudget = static_cast<uint64_t>(static_cast<float>(leaves.size()) * std::exp(logBudget(generator)));
+				settings.minPointSpacing = generator() % 2 == 0 ? 1.0f : 0.25f;
+				const float screenError = PointLodSelector::AllocateBudget(leaves, settings);
+				CheckAllocation(leaves, settings, screenError);
+			}
+
+			std::vector<PointLodLeaf> noLeaves;
+			TEST_CHECK(PointLodSelector::AllocateBudget(noLeaves, PointLodSettings()) == 0.0f);
+		}
+
+		// Ranges must be the selected prefixes of the visible leaves in buffer order, prefixes that touch merged into one
+		void TestSelect()
+		{
+			std::vector<PackedPoint> points = GenerateBenchmarkScan(1'000'003);
+			const PointBvh hierarchy = PointBvh::Build(points);
+
+			std::mt19937 generator(9);
+			PointLodSelector selector;
+			std::vector<PointDrawRange> expectedRanges;
+			const uint64_t budgets[] = {10, 1'000, 30'000, 300'000, 10'000'000};
+			for (uint32_t selectionIndex = 0; selectionIndex < SELECTIONS_COUNT; selectionIndex++)
+			{
+				const TestCamera camera = GenerateTestCamera(generator);
+				PointLodView view;
+				std::copy(std::begin(camera.position), std::end(camera.position), view.position);
+				view.projectionScale = PointLodSelector::GetProjectionScale(camera.projection.fovRadians, SCREEN_HEIGHT);
+				PointLodSettings settings;
+				settings.pointBudget = budgets[selectionIndex % std::size(budgets)];
+
+				const std::vector<PointDrawRange>& ranges = selector.Select(hierarchy, camera.GetFrustum(), view, settings);
+				const std::vector<PointLodLeaf>& leaves = selector.GetLeaves();
+				CheckAllocation(leaves, settings, selector.GetScreenError());
+
+				uint64_t visibleLeavesPointsCount = 0;
+				uint64_t selectedPointsCount = 0;
+				expectedRanges.clear();
+				for (size_t leafIndex = 0; leafIndex < leaves.size(); leafIndex++)
+				{
+					const PointLodLeaf& leaf = leaves[leafIndex];
+					TEST_CHECK(leafIndex == 0 || leaves[leafIndex - 1].leafIndex < leaf.leafIndex);
+					TEST_CHECK(leaf.pointsCount == hierarchy.GetLeafPointsCount(leaf.leafIndex));
+					visibleLeavesPointsCount += leaf.pointsCount;
+					selectedPointsCount += leaf.selectedPointsCount;
+					if (leaf.selectedPointsCount == 0)
+					{
+						continue;
+					}
+
+					const uint64_t pointsOffset = hierarchy.GetLeafPointsOffset(leaf.leafIndex);
+					if (!expectedRanges.empty() && expectedRanges.back().pointsOffset + expectedRanges.back().pointsCount == pointsOffset)
+					{
+						expectedRanges.back().pointsCount += leaf.selectedPointsCount;
+					}
+					else
+					{
+						expectedRanges.push_back({pointsOffset, leaf.selectedPointsCount});
+					}
+				}
+				TEST_CHECK(visibleLeavesPointsCount == selector.GetVisiblePointsCount());
+				TEST_CHECK(selectedPointsCount == selector.GetSelectedPointsCount());
+
+				bool isMatching = ranges.size() == expectedRanges.size();
+				for (size_t rangeIndex = 0; isMatching && rangeIndex < ranges.size(); rangeIndex++)
+				{
+					isMatching = ranges[rangeIndex].pointsOffset == expectedRanges[rangeIndex].pointsOffset &&
+						ranges[rangeIndex].pointsCount == expectedRanges[rangeIndex].pointsCount;
+				}
+				TEST_CHECK(isMatching);
+			}
+		}
+	}
+
+	void RunPointLodSelectorTests()
+	{
+		TestAllocateBudget();
+		TestSelect();
+		Logger::LogFormat("LOD selector: %u allocations, %u selections\n", ALLOCATIONS_COUNT, SELECTIONS_COUNT);
+	}
+}
@@ -0,0 +1,102 @@
+#include "Tests.h"
+
+#include <vector>
+
+#include "TestUtils.h"
+#include "RenderManager/PointResidencyCache.h"
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		constexpr uint64_t NODE_BYTES = 100;
+		constexpr uint64_t BUDGET_BYTES = 3 * NODE_BYTES;
+
+		// Frame of a scripted camera: the nodes it sees and prefetches, and the loads issued after marking them
+		struct ScriptedFrame
+		{
+			std::vector<uint32_t> visibleNodes;
+			std::vector<uint32_t> prefetchNodes;
+			// nodes the frame pops in order, and the nodes each pop evicts
+			std::vector<uint32_t> loadedNodes;
+			std::vector<std::vector<uint32_t>> evictedNodes;
+			// loads stay in flight past the frame when false
+			bool completesLoads = true;
+		};
+
+		// Six nodes, three fit the budget, the last one is over the whole budget.
+		// The recency list is least recently visible first, evictions take from there.
+		const std::vector<ScriptedFrame> SCRIPT = {
+			// cold start: three misses, all fit
+			{{0, 1, 2}, {}, {0, 1, 2}, {{}, {}, {}}},
+			{{0, 1, 2}, {}, {}, {}},
+			// 0 is the least recently visible
+			{{3}, {}, {3}, {{0}}},
+			{{0, 3}, {}, {0}, {{1}}},
+			// four nodes over a three node budget, all resident ones are visible so the miss waits
+			{{0, 1, 2, 3}, {}, {}, {}},
+			// 1 is queued again, 0 is now behind 2 and 3
+			{{1}, {}, {1}, {{0}}},
+			// prefetches queue after the visible misses and evict like them
+			{{1}, {4}, {4}, {{2}}},
+			// a hit on the prefetched node, the node over the budget misses and is never queued
+			{{4, 5}, {}, {}, {}},
+			// a load left in flight
+			{{0}, {}, {0}, {{3}}, false},
+			// loading nodes are misses and can't be evicted, 1 is the oldest resident node
+			{{0, 2}, {}, {2}, {{1}}},
+		};
+	}
+
+	void RunPointResidencyCacheTests()
+	{
+		PointResidencyCache cache({NODE_BYTES, NODE_BYTES, NODE_BYTES, NODE_BYTES, NODE_BYTES, BUDGET_BYTES + 1}, BUDGET_BYTES);
+
+		std::vector<uint32_t> pendingLoads;
+		std::vector<uint32_t> evictedNodes;
+		for (const ScriptedFrame& frame : SCRIPT)
+		{
+			cache.MarkVisible(frame.visibleNodes, frame.prefetchNodes);
+
+			for (size_t loadIndex = 0; loadIndex < frame.loadedNodes.size(); loadIndex++)
+			{
+				uint32_t nodeIndex;
+				const bool isPopped = cache.PopLoad(nodeIndex, evictedNodes);
+				TEST_CHECK_DESC(isPopped, "load of a scripted frame");
+				TEST_CHECK(!isPopped || nodeIndex == frame.loadedNodes[loadIndex]);
+				TEST_CHECK(!isPopped || evictedNodes == frame.evictedNodes[loadIndex]);
+				TEST_CHECK(cache.GetUsedBytes() <= cache.GetBudgetBytes());
+				pendingLoads.push_back(nodeIndex);
+			}
+
+			// whatever is still queued doesn't fit
+			uint32_t nodeIndex;
+			TEST_CHECK(!cache.PopLoad(nodeIndex, evictedNodes));
+
+			if (frame.completesLoads)
+			{
+				for (const uint32_t loadedNode : pendingLoads)
+				{
+					cache.CompleteLoad(loadedNode);
+				}
+				pendingLoads.clear();
+			}
+		}
+
+		TEST_CHECK(cache.GetState(1) == PointResidencyState::Absent);
+		TEST_CHECK(cache.GetState(5) == PointResidencyState::Absent);
+		TEST_CHECK(cache.IsResident(0) && cache.IsResident(2) && cache.IsResident(4));
+		TEST_CHECK(cache.GetUsedBytes() == BUDGET_BYTES);
+
+		const PointResidencyStats& stats = cache.GetStats();
+		Logger::LogFormat("Residency cache: %llu hits, %llu misses, %llu evictions, %llu loads, %llu prefetches, %llu prefetch hits\n",
+		                  stats.hits, stats.misses, stats.evictions, stats.loads, stats.prefetches, stats.prefetchHits);
+		TEST_CHECK(stats.hits == 9);
+		TEST_CHECK(stats.misses == 11);
+		TEST_CHECK(stats.evictions == 6);
+		TEST_CHECK(stats.loads == 9);
+		TEST_CHECK(stats.loadedBytes == 9 * NODE_BYTES);
+		TEST_CHECK(stats.prefetches == 1);
+		TEST_CHECK(stats.prefetchHits == 1);
+	}
+}
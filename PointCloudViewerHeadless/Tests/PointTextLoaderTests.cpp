@@ -0,0 +1,168 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "TestUtils.h"
+#include "DataManager/MappedFile.h"
+#include "PointCloudLoader/PointSink.h"
+#include "PointCloudLoader/PointTextLoader.h"
+#include "ThreadManager/ThreadManager.h"
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		constexpr uint32_t LINES_COUNT = 20'000;
+		// first chunk density is extrapolated to the whole file, lines vary in length
+		constexpr uint32_t MIN_ESTIMATE_LINES_COUNT = 100;
+		constexpr double MIN_ESTIMATE_RATIO = 0.8;
+		constexpr double MAX_ESTIMATE_RATIO = 1.3;
+		// positions are stored as floats relative to the origin
+		constexpr double BOUNDS_TOLERANCE = 0.01;
+
+		struct GeneratedFile
+		{
+			uint64_t pointsCount = 0;
+			uint64_t size = 0;
+			uint64_t minLineLength = UINT64_MAX;
+			uint64_t maxLineLength = 0;
+			double boundsMin[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+			double boundsMax[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+		};
+
+		// x y z intensity r g b lines at a UTM-sized offset, with a header and a short line the loader skips
+		GeneratedFile GenerateFile(const std::filesystem::path& path)
+		{
+			std::mt19937 generator(11);
+			std::uniform_real_distribution<double> offset(0.0, 100.0);
+			std::ofstream stream(path, std::ios::binary);
+			GeneratedFile file;
+
+			const std::string header = "// x y z intensity r g b\n";
+			const std::string shortLine = "1.0 2.0 3.0\n";
+			stream << header;
+			file.size += header.size();
+
+			char line[256];
+			for (uint32_t lineIndex = 0; lineIndex < LINES_COUNT; lineIndex++)
+			{
+				const double position[3] = {5'400'000.0 + offset(generator), 300'000.0 + offset(generator), offset(generator) * 0.3};
+				const int decimalsCount = static_cast<int>(generator() % 4) + 1;
+				const int length = std::snprintf(line, sizeof(line), "%.*f %.*f %.*f %d %u %u %u\n",
+				                                 decimalsCount, position[0], decimalsCount, position[1], decimalsCount, position[2],
+				                                 static_cast<int>(generator() % 4096) - 2048, generator() % 256, generator() % 256, generator() % 256);
+				stream.write(line, length);
+				file.size += length;
+				file.minLineLength = std::min<uint64_t>(file.minLineLength, length);
+				file.maxLineLength = std::max<uint64_t>(file.maxLineLength, length);
+
+				// bounds of the values as written, not as generated
+				double writtenPosition[3];
+				std::sscanf(line, "%lf %lf %lf", &writtenPosition[0], &writtenPosition[1], &writtenPosition[2]);
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					file.boundsMin[axis] = std::min(file.boundsMin[axis], writtenPosition[axis]);
+					file.boundsMax[axis] = std::max(file.boundsMax[axis], writtenPosition[axis]);
+				}
+				file.pointsCount++;
+
+				if (lineIndex == LINES_COUNT / 2)
+				{
+					stream << shortLine;
+					file.size += shortLine.size();
+				}
+			}
+			return file;
+		}
+
+		struct LoaderCase
+		{
+			uint64_t chunkSize;
+			uint32_t ringSize;
+			uint32_t pointsPerBlock;
+			bool isProgressive;
+		};
+
+		void TestLoad(const MappedFile& mappedFile, const GeneratedFile& file, const LoaderCase& loaderCase)
+		{
+			NullPointSink sink(loaderCase.pointsPerBlock);
+			PointTextLoaderSettings settings;
+			settings.chunkSize = loaderCase.chunkSize;
+			settings.ringSize = loaderCase.ringSize;
+			settings.isProgressive = loaderCase.isProgressive;
+			PointTextLoader loader(&mappedFile, &sink, settings);
+			const uint64_t pointsCount = loader.Load();
+
+			TEST_CHECK(pointsCount == file.pointsCount);
+			TEST_CHECK(sink.GetPointsCount() == file.pointsCount);
+			TEST_CHECK(loader.GetStats().pointsCount == file.pointsCount);
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				TEST_CHECK(std::abs(loader.GetStats().boundsMin[axis] - file.boundsMin[axis]) <= BOUNDS_TOLERANCE);
+				TEST_CHECK(std::abs(loader.GetStats().boundsMax[axis] - file.boundsMax[axis]) <= BOUNDS_TOLERANCE);
+			}
+
+			// a point per byte at most, close to the real count once the first chunk holds enough lines
+			const uint64_t estimatedPointsCount = sink.GetEstimatedPointsCount();
+			TEST_CHECK(estimatedPointsCount <= file.size * 2);
+			if (loaderCase.chunkSize >= MIN_ESTIMATE_LINES_COUNT * file.maxLineLength)
+			{
+				TEST_CHECK(static_cast<double>(estimatedPointsCount) >= MIN_ESTIMATE_RATIO * static_cast<double>(file.pointsCount));
+				TEST_CHECK(static_cast<double>(estimatedPointsCount) <= MAX_ESTIMATE_RATIO * static_cast<double>(file.pointsCount));
+			}
+
+			// a batch per chunk with points, a chunk shorter than any line owns one line at most
+			const uint64_t chunksCount = (file.size + loaderCase.chunkSize - 1) / loaderCase.chunkSize;
+			TEST_CHECK(sink.GetBatchesCount() >= 1 && sink.GetBatchesCount() <= chunksCount);
+			if (loaderCase.chunkSize < file.minLineLength)
+			{
+				TEST_CHECK(sink.GetBatchesCount() == file.pointsCount);
+			}
+
+			// pool never frees, its size is the peak of live blocks: the blocks of the chunks in the ring
+			const uint32_t ringSize = loaderCase.ringSize != 0 ? loaderCase.ringSize : (ThreadManager::Get()->GetWorkersCount() - 1) * 4;
+			const uint64_t maxChunkPointsCount = std::min(loaderCase.chunkSize / file.minLineLength + 1, file.pointsCount);
+			const uint64_t maxChunkBlocksCount = (maxChunkPointsCount + loaderCase.pointsPerBlock - 1) / loaderCase.pointsPerBlock;
+			const uint64_t blocksCount = sink.GetBlockPool()->GetAllocatedBlocksCount();
+			TEST_CHECK(blocksCount <= ringSize * maxChunkBlocksCount);
+
+			Logger::LogFormat("Text loader, %llu byte chunks, ring of %u, %u points per block: %llu points in %llu batches, %llu estimated, %llu blocks\n",
+			                  loaderCase.chunkSize, ringSize, loaderCase.pointsPerBlock, pointsCount, sink.GetBatchesCount(),
+			                  estimatedPointsCount, blocksCount);
+		}
+	}
+
+	void RunPointTextLoaderTests()
+	{
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "PointTextLoaderTests.txt";
+		const GeneratedFile file = GenerateFile(path);
+		{
+			const MappedFile mappedFile(path.string());
+			TEST_CHECK(mappedFile.IsValid() && mappedFile.GetSize() == file.size);
+
+			const LoaderCase loaderCases[] = {
+				// the whole file in a chunk, default ring
+				{4ull * 1024ull * 1024ull, 0, PointBlockPool::DEFAULT_POINTS_PER_BLOCK, true},
+				// ring of one, the reader waits for every chunk to be consumed
+				{64 * 1024, 1, 1024, false},
+				{4096, 2, 64, true},
+				// chunks many blocks long through a ring of one
+				{1000, 1, 4, false},
+				// chunks shorter than a line, about every other one owns no line start
+				{file.minLineLength / 2, 3, PointBlockPool::DEFAULT_POINTS_PER_BLOCK, true},
+			};
+			for (const LoaderCase& loaderCase : loaderCases)
+			{
+				TestLoad(mappedFile, file, loaderCase);
+			}
+		}
+		std::filesystem::remove(path);
+	}
+}
@@ -0,0 +1,221 @@
+#include "Tests.h"
+
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestUtils.h"
+#include "PointCloudLoader/PointTextParser.h"
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		// past the SIMD safe distance of the parser, so a padded number takes the vector path
+		constexpr uint32_t SIMD_PADDING_SIZE = 128;
+		constexpr uint32_t NUMBER_ITERATIONS_COUNT = 500'000;
+		constexpr uint32_t LINE_ITERATIONS_COUNT = 20'000;
+		constexpr uint32_t LOGGED_MISMATCHES_COUNT = 10;
+
+		// Numbers at the edges of the fast paths, of the double and float ranges and with more digits than the mantissa holds
+		const char* const EDGE_CASE_NUMBERS[] = {
+			"0", "-0", "1.5e3", "+2.25", "1.", ".25", "0.5E+2", "-123.456e-7", "5400000.123",
+			"1e22", "1e23", "9007199254740992", "9007199254740993", "7.3177701707893310e+15",
+			"2.2250738585072011e-308", "2.2250738585072014e-308", "4.9e-324", "2.4703282292062328e-324", "1e-400", "1e400",
+			"1.7976931348623157e308", "1.7976931348623159e308",
+			"3.4028235e38", "3.4028236e38", "1.17549435e-38", "1.4e-45", "7.0064923e-46",
+			"123456789012345678901234567890", "0.000000000000000000000000000001234567890123456789",
+			"179769313486231580793728971405303415079934132710037826936173778980444968292764750946649017977587207096330286416692887910946555547851940402630657488671505820681908902000708383676273854845817711531764475730270069855571366959622842914819860834936475292719074168444365510704342711559699508093042880177904174497791.9999999999999999999999999999999999999999999999999999999999999999999999"
+		};
+
+		class NumberChecker
+		{
+		public:
+			// Parses the number alone and padded, both must match strtod/strtof bit for bit and stop where strtod does
+			void Check(const std::string& number)
+			{
+				char* referenceEnd;
+				const double reference = std::strtod(number.c_str(), &referenceEnd);
+				const float referenceFloat = std::strtof(number.c_str(), nullptr);
+				const uint64_t referenceLength = referenceEnd - number.c_str();
+
+				const std::string padded = number + std::string(SIMD_PADDING_SIZE, ' ');
+				for (const std::string* text : {&number, &padded})
+				{
+					const char* cursor = text->data();
+					double value = 0.0;
+					const bool isParsed = PointTextParser::ParseDouble(cursor, text->data() + text->size(), value);
+					if (!isParsed || std::bit_cast<uint64_t>(value) != std::bit_cast<uint64_t>(reference) ||
+						static_cast<uint64_t>(cursor - text->data()) != referenceLength)
+					{
+						LogMismatch("double", number, value, reference);
+					}
+
+					const char* floatCursor = text->data();
+					float floatValue = 0.0f;
+					PointTextParser::ParseFloat(floatCursor, text->data() + text->size(), floatValue);
+					if (std::bit_cast<uint32_t>(floatValue) != std::bit_cast<uint32_t>(referenceFloat))
+					{
+						LogMismatch("float", number, floatValue, referenceFloat);
+					}
+				}
+				m_checksCount++;
+			}
+
+			[[nodiscard]] uint64_t GetChecksCount() const noexcept { return m_checksCount; }
+			[[nodiscard]] uint64_t GetMismatchesCount() const noexcept { return m_mismatchesCount; }
+
+		private:
+			void LogMismatch(const char* type, const std::string& number, double value, double reference)
+			{
+				if (m_mismatchesCount++ < LOGGED_MISMATCHES_COUNT)
+				{
+					Logger::LogFormat("%s %.80s: %.17g, strtod %.17g\n", type, number.c_str(), value, reference);
+				}
+			}
+
+			uint64_t m_checksCount = 0;
+			uint64_t m_mismatchesCount = 0;
+		};
+
+		double RandomDouble(std::mt19937_64& generator)
+		{
+			double value;
+			do
+			{
+				value = std::bit_cast<double>(generator());
+			}
+			while (!std::isfinite(value));
+			return value;
+		}
+
+		void TestNumbers()
+		{
+			NumberChecker checker;
+			for (const char* number : EDGE_CASE_NUMBERS)
+			{
+				checker.Check(number);
+			}
+
+			std::mt19937_64 generator(7);
+			char number[512];
+			for (uint32_t i = 0; i < NUMBER_ITERATIONS_COUNT; i++)
+			{
+				// any double with a shortened mantissa, rounding of the shortened ones lands near halfway points
+				snprintf(number, sizeof(number), "%.*e", static_cast<int>(generator() % 20 + 1), RandomDouble(generator));
+				checker.Check(number);
+				// scanner-like fixed point numbers
+				snprintf(number, sizeof(number), "%.*f", static_cast<int>(generator() % 12),
+				         static_cast<double>(generator() % 100'000'000'000ull) / static_cast<double>(1 + generator() % 100'000));
+				checker.Check(number);
+				// 19 digit mantissas over the whole exponent range, subnormals and overflow included
+				snprintf(number, sizeof(number), "%llue%d", generator() % 10'000'000'000'000'000'000ull, static_cast<int>(generator() % 700) - 350);
+				checker.Check(number);
+				// floats printed short, the float path must not round twice through double
+				const float floatValue = std::bit_cast<float>(static_cast<uint32_t>(generator()));
+				if (std::isfinite(floatValue))
+				{
+					snprintf(number, sizeof(number), "%.*g", static_cast<int>(generator() % 12 + 1), floatValue);
+					checker.Check(number);
+				}
+			}
+
+			Logger::LogFormat("Numbers: %llu checked, %llu mismatches\n", checker.GetChecksCount(), checker.GetMismatchesCount());
+			TEST_CHECK(checker.GetMismatchesCount() == 0);
+		}
+
+		// Random lines of numbers with mixed separators, text headers and CRLF ends, read with ReadLine against strtod
+		void TestLines()
+		{
+			const char* const separators[] = {" ", ",", "\t", " , ", ";  ", "   "};
+
+			std::mt19937_64 generator(11);
+			uint64_t linesCount = 0;
+			uint64_t mismatchesCount = 0;
+			char number[512];
+			for (uint32_t iteration = 0; iteration < LINE_ITERATIONS_COUNT; iteration++)
+			{
+				std::string text;
+				std::vector<std::vector<double>> expectedLines;
+				const uint32_t textLinesCount = generator() % 20 + 1;
+				for (uint32_t lineIndex = 0; lineIndex < textLinesCount; lineIndex++)
+				{
+					std::vector<double>& expected = expectedLines.emplace_back();
+					if (generator() % 10 == 0)
+					{
+						text += "# header x y z\t";
+					}
+
+					const uint32_t valuesCount = generator() % PointTextParser::MAX_VALUES_PER_LINE;
+					for (uint32_t valueIndex = 0; valueIndex < valuesCount; valueIndex++)
+					{
+						const double sign = generator() % 2 == 0 ? 1.0 : -1.0;
+						switch (generator() % 5)
+						{
+						case 0:
+							snprintf(number, sizeof(number), "%.*e", static_cast<int>(generator() % 22), RandomDouble(generator));
+							break;
+						case 1:
+							snprintf(number, sizeof(number), "%.*f", static_cast<int>(generator() % 18),
+							         sign * static_cast<double>(generator() % 10'000'000'000ull) / static_cast<double>(1 + generator() % 1000));
+							break;
+						case 2:
+							snprintf(number, sizeof(number), "%lld", static_cast<long long>(sign) * static_cast<long long>(generator() % 100'000'000'000'000'000ull));
+							break;
+						case 3:
+							snprintf(number, sizeof(number), "%s%llu.%llu", sign > 0.0 ? "+" : "", generator() % 100'000'000'000'000'000ull, generator());
+							break;
+						default:
+							snprintf(number, sizeof(number), ".%llu", generator() % 1'000'000);
+							break;
+						}
+						expected.push_back(std::strtod(number, nullptr));
+						text += number;
+						text += separators[generator() % std::size(separators)];
+					}
+					text += generator() % 2 == 0 ? "\r\n" : "\n";
+				}
+
+				// with padding the lines go through the SIMD path, without it the last ones go through the scalar tail
+				for (const std::string& readText : {text + std::string(SIMD_PADDING_SIZE, '\n'), text})
+				{
+					const char* cursor = readText.data();
+					for (const std::vector<double>& expected : expectedLines)
+					{
+						double values[PointTextParser::MAX_VALUES_PER_LINE];
+						const uint32_t valuesCount = PointTextParser::ReadLine(cursor, readText.data() + readText.size(), values);
+						bool isMatching = valuesCount == expected.size();
+						for (uint32_t i = 0; isMatching && i < valuesCount; i++)
+						{
+							isMatching = std::bit_cast<uint64_t>(values[i]) == std::bit_cast<uint64_t>(expected[i]);
+						}
+						linesCount++;
+
+						if (!isMatching)
+						{
+							if (mismatchesCount++ < LOGGED_MISMATCHES_COUNT)
+							{
+								Logger::LogFormat("Line %llu of iteration %u: %u values, expected %llu\n", linesCount, iteration, valuesCount, static_cast<uint64_t>(expected.size()));
+							}
+							break;
+						}
+					}
+				}
+			}
+
+			Logger::LogFormat("Lines: %llu read, %llu mismatches\n", linesCount, mismatchesCount);
+			TEST_CHECK(mismatchesCount == 0);
+		}
+	}
+
+	void RunPointTextParserTests()
+	{
+		Logger::LogFormat("Point text parser tests, %s\n", PointTextParser::GetInstructionSetName());
+		TestNumbers();
+		TestLines();
+	}
+}
@@ -0,0 +1,40 @@
+#include "TestCamera.h"
+
+#include <cmath>
+
+namespace PointCloudViewer
+{
+	Frustum TestCamera::GetFrustum() const
+	{
+		float viewProjection[4][4];
+		CameraTrace::GetViewProjection(position, rotation, projection, viewProjection);
+		return Frustum(viewProjection);
+	}
+
+	TestCamera GenerateTestCamera(std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> position(-20.0f, 120.0f);
+		std::normal_distribution<float> rotation(0.0f, 1.0f);
+		std::uniform_real_distribution<float> fov(0.2f, 2.0f);
+		std::uniform_real_distribution<float> farPlane(5.0f, 300.0f);
+
+		TestCamera camera;
+		for (float& coordinate : camera.position)
+		{
+			coordinate = position(generator);
+		}
+		// normalized gaussian quaternions are uniform over rotations
+		float length = 0.0f;
+		for (float& component : camera.rotation)
+		{
+			component = rotation(generator);
+			length += component * component;
+		}
+		for (float& component : camera.rotation)
+		{
+			component /= std::sqrt(length);
+		}
+		camera.projection = {fov(generator), 16.0f / 9.0f, 0.1f, farPlane(generator)};
+		return camera;
+	}
+}
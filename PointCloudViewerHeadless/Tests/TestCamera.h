@@ -0,0 +1,26 @@
+#ifndef TEST_CAMERA_H
+#define TEST_CAMERA_H
+
+#include <random>
+
+#include "Common/CameraTrace.h"
+#include "Common/Frustum.h"
+
+namespace PointCloudViewer
+{
+	// Camera pose and perspective for tests that look at the synthetic scan of GenerateBenchmarkScan
+	struct TestCamera
+	{
+		float position[3];
+		// quaternion, x y z w
+		float rotation[4];
+		CameraTraceProjection projection;
+
+		[[nodiscard]] Frustum GetFrustum() const;
+	};
+
+	// Random camera in and around the scan's 100m room, with any orientation, field of view and depth range
+	[[nodiscard]] TestCamera GenerateTestCamera(std::mt19937& generator);
+}
+
+#endif // TEST_CAMERA_H
@@ -0,0 +1,23 @@
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include <cstdint>
+
+#include "Utils/Log.h"
+
+namespace PointCloudViewer
+{
+	// Failed checks of the whole run, a failed check is logged and the run goes on to report the rest
+	inline uint32_t g_failedChecksCount = 0;
+}
+
+#define TEST_CHECK(expr) \
+if (expr) {} else {\
+	Logger::LogFormat("Check failed: %s %s:%d\n", #expr, __FILE__, __LINE__);\
+	PointCloudViewer::g_failedChecksCount++;}
+#define TEST_CHECK_DESC(expr, message) \
+if (expr) {} else {\
+	Logger::LogFormat("Check failed: %s %s %s:%d\n", message, #expr, __FILE__, __LINE__);\
+	PointCloudViewer::g_failedChecksCount++;}
+
+#endif // TEST_UTILS_H
@@ -0,0 +1,15 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+namespace PointCloudViewer
+{
+	// Every suite is deterministic, failures go to g_failedChecksCount
+	void RunPointTextParserTests();
+	void RunPointTextLoaderTests();
+	void RunPointCullerTests();
+	void RunPointLodSelectorTests();
+	void RunPointResidencyCacheTests();
+	void RunVoxelDownsamplerTests();
+}
+
+#endif // TESTS_H
@@ -0,0 +1,177 @@
+#include "Tests.h"
+
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+#include "PointCloudLoader/MortonSort.h"
+#include "PointCloudLoader/PointBvhBenchmark.h"
+#include "PointCloudLoader/VoxelDownsampler.h"
+
+namespace PointCloudViewer
+{
+	namespace
+	{
+		// several blocks of the downsampler, so voxels are split across workers and merged
+		constexpr uint64_t POINTS_COUNT = 300'003;
+		// centroids are summed in another order than the reference's, float results may round the other way
+		constexpr float CENTROID_TOLERANCE = 1e-4f;
+		constexpr float CENTER_DISTANCE_TOLERANCE = 1e-6f;
+
+		struct ReferenceVoxel
+		{
+			double positionSum[3] = {};
+			uint64_t colorSum[3] = {};
+			uint64_t intensitySum = 0;
+			uint32_t pointsCount = 0;
+			uint32_t firstIndex = 0;
+			uint32_t nearestIndex = 0;
+			float nearestDistance = 0.0f;
+		};
+
+		// Same grid as the downsampler: anchored at the bounds minimum with the voxel size as the Morton cell
+		MortonQuantizer GetVoxelQuantizer(const std::vector<PackedPoint>& points, float voxelSize)
+		{
+			const MortonQuantizer boundsQuantizer = MortonQuantizer::FromPoints(points);
+			const float* boundsMin = boundsQuantizer.GetBoundsMin();
+			const float gridSize = voxelSize * static_cast<float>(1u << MortonQuantizer::MAX_BITS_PER_AXIS);
+			const float gridMin[3] = {boundsMin[0], boundsMin[1], boundsMin[2]};
+			const float gridMax[3] = {gridMin[0] + gridSize, gridMin[1] + gridSize, gridMin[2] + gridSize};
+			return MortonQuantizer(gridMin, gridMax);
+		}
+
+		float GetCenterDistance(const PackedPoint& point, const MortonQuantizer& quantizer)
+		{
+			const float position[3] = {point.position.x, point.position.y, point.position.z};
+			const float cellScale = 1.0f / quantizer.GetCellSize();
+			float distance = 0.0f;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				const float coordinate = (position[axis] - quantizer.GetBoundsMin()[axis]) * cellScale;
+				const float centerOffset = coordinate - std::floor(coordinate) - 0.5f;
+				distance += centerOffset * centerOffset;
+			}
+			return distance;
+		}
+
+		bool IsSamePosition(const PackedPoint& point, const PackedPoint& other)
+		{
+			return point.position.x == other.position.x && point.position.y == other.position.y && point.position.z == other.position.z;
+		}
+
+		// One pass over the points into an ordered map, map order of the codes is the Morton order of the result
+		std::map<uint64_t, ReferenceVoxel> DownsampleReference(const std::vector<PackedPoint>& points, const MortonQuantizer& quantizer)
+		{
+			std::map<uint64_t, ReferenceVoxel> voxels;
+			for (uint32_t i = 0; i < points.size(); i++)
+			{
+				const PackedPoint& point = points[i];
+				ReferenceVoxel& voxel = voxels[quantizer.Encode(point)];
+				const float distance = GetCenterDistance(point, quantizer);
+				if (voxel.pointsCount == 0)
+				{
+					voxel.firstIndex = i;
+					voxel.nearestIndex = i;
+					voxel.nearestDistance = distance;
+				}
+				else if (distance < voxel.nearestDistance)
+				{
+					voxel.nearestIndex = i;
+					voxel.nearestDistance = distance;
+				}
+
+				const float position[3] = {point.position.x, point.position.y, point.position.z};
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					voxel.positionSum[axis] += position[axis];
+					voxel.colorSum[axis] += point.color.v >> axis * 10 & 1023;
+				}
+				voxel.intensitySum += point.intensity & 0xFFFF;
+				voxel.pointsCount++;
+			}
+			return voxels;
+		}
+
+		void TestDownsample(const std::vector<PackedPoint>& points, float voxelSize)
+		{
+			const MortonQuantizer quantizer = GetVoxelQuantizer(points, voxelSize);
+			const std::map<uint64_t, ReferenceVoxel> referenceVoxels = DownsampleReference(points, quantizer);
+
+			for (const VoxelRepresentative representative : {VoxelRepresentative::Centroid, VoxelRepresentative::First, VoxelRepresentative::NearestToCenter})
+			{
+				const std::vector<PackedPoint> voxelPoints = DownsampleVoxelGrid(points, {voxelSize, representative});
+				TEST_CHECK(voxelPoints.size() == referenceVoxels.size());
+				if (voxelPoints.size() != referenceVoxels.size())
+				{
+					continue;
+				}
+
+				uint64_t positionMismatchesCount = 0;
+				uint64_t attributeMismatchesCount = 0;
+				uint64_t voxelIndex = 0;
+				for (const auto& [code, voxel] : referenceVoxels)
+				{
+					const PackedPoint& point = voxelPoints[voxelIndex++];
+					// points in Morton order, each inside its own voxel
+					positionMismatchesCount += quantizer.Encode(point) != code;
+
+					switch (representative)
+					{
+					case VoxelRepresentative::Centroid:
+						{
+							const float position[3] = {point.position.x, point.position.y, point.position.z};
+							for (uint32_t axis = 0; axis < 3; axis++)
+							{
+								const double centroid = voxel.positionSum[axis] / static_cast<double>(voxel.pointsCount);
+								positionMismatchesCount += std::abs(position[axis] - static_cast<float>(centroid)) > CENTROID_TOLERANCE;
+							}
+							break;
+						}
+					case VoxelRepresentative::First:
+						positionMismatchesCount += !IsSamePosition(point, points[voxel.firstIndex]);
+						break;
+					case VoxelRepresentative::NearestToCenter:
+						// ties within rounding may keep another point, just as near
+						positionMismatchesCount += !IsSamePosition(point, points[voxel.nearestIndex]) &&
+							std::abs(GetCenterDistance(point, quantizer) - voxel.nearestDistance) > CENTER_DISTANCE_TOLERANCE;
+						break;
+					}
+
+					// averages rounded to the nearest
+					const uint64_t halfCount = voxel.pointsCount / 2;
+					for (uint32_t channel = 0; channel < 3; channel++)
+					{
+						attributeMismatchesCount += (point.color.v >> channel * 10 & 1023) != (voxel.colorSum[channel] + halfCount) / voxel.pointsCount;
+					}
+					attributeMismatchesCount += point.intensity != (voxel.intensitySum + halfCount) / voxel.pointsCount;
+				}
+
+				Logger::LogFormat("Voxel grid of %.2f, representative %d: %llu points to %llu voxels, %llu position and %llu attribute mismatches\n",
+				                  voxelSize, static_cast<int>(representative), static_cast<uint64_t>(points.size()),
+				                  static_cast<uint64_t>(voxelPoints.size()), positionMismatchesCount, attributeMismatchesCount);
+				TEST_CHECK(positionMismatchesCount == 0);
+				TEST_CHECK(attributeMismatchesCount == 0);
+			}
+		}
+	}
+
+	void RunVoxelDownsamplerTests()
+	{
+		std::vector<PackedPoint> points = GenerateBenchmarkScan(POINTS_COUNT);
+		std::mt19937 generator(13);
+		for (PackedPoint& point : points)
+		{
+			point.color.v = generator() & 0x3FFFFFFF | 3u << 30;
+			point.intensity = generator() & 0xFFFF;
+		}
+
+		// dozens of points per voxel, and about a voxel per point
+		TestDownsample(points, 2.0f);
+		TestDownsample(points, 0.1f);
+
+		std::vector<PackedPoint> noPoints;
+		TEST_CHECK(DownsampleVoxelGrid(noPoints, {}).empty());
+	}
+}
@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Benchmarks/Benchmarks.h"
+#include "DataManager/DataManager.h"
+#include "DataManager/FileReadBenchmark.h"
+#include "PointCloudLoader/PointBvhBenchmark.h"
+#include "PointCloudLoader/PointNeighbourBenchmark.h"
+#include "Tests/TestUtils.h"
+#include "Tests/Tests.h"
+#include "ThreadManager/ThreadManager.h"
+#include "Utils/Log.h"
+
+// Console entry point for the parts of the viewer that need no window or GPU: tests and benchmarks.
+// Exits with a nonzero code when a test fails or the mode is unknown.
+int main(int argc, char** argv)
+{
+	Logger::EnableConsoleOutput();
+	const std::string mode = argc > 1 ? argv[1] : "";
+
+	// runs its own thread managers, ahead of the shared one they would replace
+	if (mode == "--benchmark-voxel")
+	{
+		if (argc > 2)
+		{
+			PointCloudViewer::RunVoxelDownsamplerBenchmark(std::strtoull(argv[2], nullptr, 10));
+		}
+		else
+		{
+			PointCloudViewer::RunVoxelDownsamplerBenchmark();
+		}
+		return 0;
+	}
+
+	// hierarchy builds and synthetic scans run on its workers
+	PointCloudViewer::ThreadManager threadManager;
+
+	if (mode == "--test")
+	{
+		PointCloudViewer::RunPointTextParserTests();
+		PointCloudViewer::RunPointTextLoaderTests();
+		PointCloudViewer::RunPointCullerTests();
+		PointCloudViewer::RunPointLodSelectorTests();
+		PointCloudViewer::RunPointResidencyCacheTests();
+		PointCloudViewer::RunVoxelDownsamplerTests();
+
+		Logger::LogFormat("%u checks failed\n", PointCloudViewer::g_failedChecksCount);
+		return PointCloudViewer::g_failedChecksCount == 0 ? 0 : 1;
+	}
+
+	if (mode == "--benchmark-parse")
+	{
+		if (argc > 2)
+		{
+			PointCloudViewer::RunPointTextParserBenchmark(std::strtoull(argv[2], nullptr, 10));
+		}
+		else
+		{
+			PointCloudViewer::RunPointTextParserBenchmark();
+		}
+		return 0;
+	}
+
+	if (mode == "--benchmark-bvh")
+	{
+		if (argc > 2)
+		{
+			PointCloudViewer::RunPointBvhBenchmark(std::strtoull(argv[2], nullptr, 10));
+		}
+		else
+		{
+			PointCloudViewer::RunPointBvhBenchmark();
+		}
+		return 0;
+	}
+
+	if (mode == "--benchmark-neighbours")
+	{
+		if (argc > 2)
+		{
+			PointCloudViewer::RunPointNeighbourBenchmark(std::strtoull(argv[2], nullptr, 10));
+		}
+		else
+		{
+			PointCloudViewer::RunPointNeighbourBenchmark();
+		}
+		return 0;
+	}
+
+	if (mode == "--benchmark-file-read" && argc > 2)
+	{
+		// paths are relative to the data folder of the working directory, like in the viewer
+		PointCloudViewer::DataManager dataManager;
+		if (argc > 3)
+		{
+			PointCloudViewer::RunFileReadBenchmark(argv[2], static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)));
+		}
+		else
+		{
+			PointCloudViewer::RunFileReadBenchmark(argv[2]);
+		}
+		return 0;
+	}
+
+	Logger::Log("Usage: PointCloudViewerHeadless <mode>\n"
+		"  --test                      run every test suite\n"
+		"  --benchmark-parse [lines]   ascii parser against the legacy one on a synthetic export\n"
+		"  --benchmark-bvh [points]    hierarchy build of a synthetic scan\n"
+		"  --benchmark-neighbours [points]\n"
+		"                              kNN and radius queries over a synthetic scan\n"
+		"  --benchmark-voxel [points]  voxel grid downsampling of a synthetic scan by worker count\n"
+		"  --benchmark-file-read <path> [rounds]\n"
+		"                              async reader, fread and mapping on a file of the data folder\n");
+	return mode.empty() || mode == "--help" ? 0 : 1;
+}